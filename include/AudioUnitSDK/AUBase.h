@@ -13,6 +13,7 @@
 #include <AudioUnitSDK/AUBuffer.h>
 #include <AudioUnitSDK/AUInputElement.h>
 #include <AudioUnitSDK/AUOutputElement.h>
+#include <AudioUnitSDK/AUParameterEventList.h>
 #include <AudioUnitSDK/AUPlugInDispatch.h>
 #include <AudioUnitSDK/AUScopeElement.h>
 #include <AudioUnitSDK/AUThreadSafeList.h>
@@ -34,6 +35,7 @@
 // std
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <thread>
@@ -138,6 +140,15 @@ public:
 	virtual OSStatus SetParameter(AudioUnitParameterID inID, AudioUnitScope inScope,
 		AudioUnitElement inElement, AudioUnitParameterValue inValue, UInt32 inBufferOffsetInFrames);
 
+	/// Get or set many parameters at once, e.g. to sync a control surface: the instance's mutex
+	/// is taken once, each run of items with the same scope and element resolves the element
+	/// once, and looks up the run's parameters together. Stop at the first invalid scope or
+	/// element, or when getting, parameter, or when setting, value which is not finite
+	/// (kAudioUnitErr_InvalidParameterValue). Not for the render thread. Subclasses which
+	/// override GetParameter() or SetParameter() should override these too.
+	virtual OSStatus GetParameters(AUParameterItem* ioItems, UInt32 inNumItems);
+	virtual OSStatus SetParameters(const AUParameterItem* inItems, UInt32 inNumItems);
+
 	[[nodiscard]] virtual bool CanScheduleParameters() const = 0;
 	virtual OSStatus ScheduleParameter(
 		const AudioUnitParameterEvent* inParameterEvent, UInt32 inNumEvents);
@@ -264,8 +275,10 @@ public:
 
 	/// Will only be called after StreamFormatWritable has succeeded. Default implementation
 	/// requires non-interleaved native-endian 32-bit float, any sample rate, any number of
-	/// channels; override when other formats are supported.  A subclass's override can choose to
-	/// always return true and trap invalid formats in ChangeStreamFormat.
+	/// channels. Elements which use a conversion stage (AUIOElement::SetUsesPlanarConversion)
+	/// also accept interleaved or non-interleaved Int16, packed Int24, Float32 and Float64. A
+	/// subclass's override can choose to always return true and trap invalid formats in
+	/// ChangeStreamFormat.
 	virtual bool ValidFormat(AudioUnitScope inScope, AudioUnitElement inElement,
 		const AudioStreamBasicDescription& inNewFormat);
 
@@ -365,11 +378,53 @@ public:
 		mUsesFixedBlockSize = inUsesFixedBlockSize;
 	}
 
+	/// The allocator for the I/O buffers of this instance; BufferAllocator::instance() by default.
+	[[nodiscard]] BufferAllocator& GetBufferAllocator() const
+	{
+		return mBufferAllocator != nullptr ? *mBufferAllocator : BufferAllocator::instance();
+	}
+
+	/// Sets a per-instance allocator, e.g. a PooledBufferAllocator arena shared by a group of
+	/// instances. Must be called before initialization; the allocator must outlive the instance.
+	void SetBufferAllocator(BufferAllocator* inAllocator)
+	{
+		ausdk::ThrowExceptionIf(mHasBegunInitializing, kAudioUnitErr_Initialized);
+		mBufferAllocator = inAllocator;
+	}
+
+	/// When enabled, a unit with several output busses renders the bus whose pull triggers a
+	/// render directly into the caller's buffers, instead of into the bus's cache followed by a
+	/// copy. The other busses still render into their caches. If the same bus is pulled again
+	/// for the same time stamp, its result is copied from the buffers supplied by the first pull
+	/// (or, if the pull supplies null buffers, those buffers are returned), which the caller must
+	/// therefore keep valid for the rest of the render cycle.
+	/// Render() overrides must not call PrepareBuffer() on an output for which
+	/// AUOutputElement::RenderedInPlaceAt() is true.
+	void SetZeroCopyOutputs(bool inZeroCopy) noexcept { mZeroCopyOutputs = inZeroCopy; }
+
+	[[nodiscard]] bool ZeroCopyOutputs() const noexcept { return mZeroCopyOutputs; }
+
+	/// Counts of the work done by DoRender to deliver output busses to the caller.
+	struct OutputCopyStatistics {
+		UInt64 mBusRenders{ 0 };         ///< number of DoRender calls
+		UInt64 mZeroCopyBusRenders{ 0 }; ///< of which rendered into the caller's buffers
+		UInt64 mBytesCopied{ 0 };        ///< total bytes copied from output caches
+		UInt64 mLastBytesCopied{ 0 };    ///< bytes copied by the most recent DoRender
+	};
+
+	/// May be called from any thread.
+	[[nodiscard]] OutputCopyStatistics GetOutputCopyStatistics() const noexcept;
+
+	void ResetOutputCopyStatistics() noexcept;
+
 	[[nodiscard]] virtual bool InRenderThread() const
 	{
 		return std::this_thread::get_id() == mRenderThreadID;
 	}
 
+	/// Advanced by each render; see AUParameterTable.
+	[[nodiscard]] const AURenderEpoch& GetRenderEpoch() const noexcept { return mRenderEpoch; }
+
 	/// Says whether an input is connected or has a callback.
 	bool HasInput(AudioUnitElement inElement)
 	{
@@ -502,6 +557,10 @@ protected:
 
 	virtual void DeallocateIOBuffers();
 
+	/// Called after ReallocateBuffers() during initialization when the buffer allocator's page
+	/// touch policy is PrefaultOnInitialize. Override to also prefault buffers the subclass owns.
+	virtual void PrefaultIOBuffers();
+
 	static void FillInParameterName(
 		AudioUnitParameterInfo& ioInfo, CFStringRef inName, bool inShouldRelease)
 	{
@@ -557,24 +616,65 @@ private:
 		const AudioTimeStamp& inTimeStamp, UInt32 inBusNumber, AUOutputElement& theOutput,
 		UInt32 inNumberFrames, AudioBufferList& ioData)
 	{
-		if (ioData.mBuffers[0].mData == nullptr ||
-			(theOutput.WillAllocateBuffer() && Outputs().GetNumberOfElements() > 1)) {
+		const Float64 sampleTime = inTimeStamp.mSampleTime;
+		const bool alreadyRendered = sampleTime == mCurrentRenderTime.mSampleTime;
+		bool keepBufferList = false;
+		if (alreadyRendered && theOutput.RenderedInPlaceAt(sampleTime)) {
+			// pulled again: the buffer list still refers to the first pull's buffers, into which
+			// this bus was rendered for this time stamp
+			keepBufferList = true;
+		} else if (ioData.mBuffers[0].mData == nullptr) {
 			// will render into cache buffer
+			theOutput.SetRenderedInPlace(std::nullopt);
 			theOutput.PrepareBuffer(inNumberFrames);
-		} else {
+		} else if (!theOutput.WillAllocateBuffer() || Outputs().GetNumberOfElements() <= 1) {
 			// will render into caller's buffer
 			theOutput.SetBufferList(ioData);
+		} else if (mZeroCopyOutputs && !alreadyRendered) {
+			// this pull renders the unit: this bus goes to the caller's buffer, the others to
+			// their caches
+			PrepareOtherOutputs(theOutput, inNumberFrames);
+			theOutput.SetBufferList(ioData);
+			theOutput.SetRenderedInPlace(sampleTime);
+			keepBufferList = true;
+			IncrementCounter(mZeroCopyBusRenders, 1);
+		} else {
+			// will render into cache buffer
+			theOutput.SetRenderedInPlace(std::nullopt);
+			theOutput.PrepareBuffer(inNumberFrames);
 		}
 		AUSDK_Require_noerr(RenderBus(ioActionFlags, inTimeStamp, inBusNumber, inNumberFrames));
+		theOutput.CommitPlanarBuffer();
+		if (theOutput.IsBufferListKnownSilent()) {
+			ioActionFlags |= kAudioUnitRenderAction_OutputIsSilence;
+		}
+		size_t bytesCopied = 0;
 		if (ioData.mBuffers[0].mData == nullptr) {
 			theOutput.CopyBufferListTo(ioData);
+			// the caller may write through the pointers, e.g. a downstream unit rendering in
+			// place, so the silence reported above holds for this render only
+			theOutput.MarkBufferListModified();
 		} else {
-			theOutput.CopyBufferContentsTo(ioData);
-			theOutput.InvalidateBufferList();
+			bytesCopied = theOutput.CopyBufferContentsTo(ioData);
+			if (!keepBufferList) {
+				theOutput.InvalidateBufferList();
+			}
 		}
+		IncrementCounter(mBusRenders, 1);
+		IncrementCounter(mBytesCopied, bytesCopied);
+		mLastBytesCopied.store(bytesCopied, std::memory_order_relaxed);
 		return noErr;
 	}
 
+	// single writer, so no read-modify-write is needed
+	static void IncrementCounter(std::atomic<UInt64>& ioCounter, UInt64 inAmount) noexcept
+	{
+		ioCounter.store(ioCounter.load(std::memory_order_relaxed) + inAmount,
+			std::memory_order_relaxed);
+	}
+
+	void PrepareOtherOutputs(const AUOutputElement& inRenderedInPlace, UInt32 inNumberFrames);
+
 	bool HasIcon();
 
 	[[nodiscard]] std::string CreateLoggingString() const;
@@ -604,7 +704,62 @@ protected:
 
 	// Scheduled parameter implementation:
 
-	using ParameterEventList = std::vector<AudioUnitParameterEvent>;
+	/// No longer a std::vector; see AUParameterEventList for the operations it keeps.
+	using ParameterEventList = AUParameterEventList;
+
+	static constexpr UInt32 kDefaultParameterEventCapacity = AUParameterEventList::kDefaultCapacity;
+
+	/// The number of events ScheduleParameter() can queue per render cycle. The default capacity
+	/// is available from construction; DoInitialize() allocates any other, keeping the events
+	/// already scheduled, so set this before initializing.
+	void SetParameterEventCapacity(UInt32 inCapacity) noexcept
+	{
+		mParameterEventCapacity = inCapacity;
+	}
+	[[nodiscard]] UInt32 GetParameterEventCapacity() const noexcept
+	{
+		return mParameterEventCapacity;
+	}
+
+	/// What ScheduleParameter() does with events beyond the capacity.
+	void SetParameterEventOverflowPolicy(ParameterEventList::EOverflowPolicy inPolicy) noexcept
+	{
+		mParamEventList.SetOverflowPolicy(inPolicy);
+	}
+
+	/// The number of scheduled events lost to overflow.
+	[[nodiscard]] UInt64 GetDroppedParameterEventCount() const noexcept
+	{
+		return mParamEventList.DroppedEventCount();
+	}
+	void ResetDroppedParameterEventCount() noexcept { mParamEventList.ResetDroppedEventCount(); }
+
+	/// The number of scheduled events merged into an earlier one for the same parameter on
+	/// overflow; see ParameterEventList::EOverflowPolicy::CoalesceByParameter.
+	[[nodiscard]] UInt64 GetCoalescedParameterEventCount() const noexcept
+	{
+		return mParamEventList.CoalescedEventCount();
+	}
+	void ResetCoalescedParameterEventCount() noexcept
+	{
+		mParamEventList.ResetCoalescedEventCount();
+	}
+
+	/// Quantizes the slices made by ProcessForScheduledParams() to multiples of inFrames, so that
+	/// no more than one slice starts per inFrames. Events are applied at the start of the quantum
+	/// containing them, up to inFrames - 1 early; several immediate events for a parameter within
+	/// one quantum coalesce to the last. 0 or 1 (the default) slices at every event.
+	void SetMinimumSliceFrames(UInt32 inFrames) noexcept { mMinimumSliceFrames = inFrames; }
+	[[nodiscard]] UInt32 GetMinimumSliceFrames() const noexcept { return mMinimumSliceFrames; }
+
+	/// Whether ramp starts and ends divide the buffer into slices (the default). Units whose DSP
+	/// reads ramps sample-accurately with AUElement::FillParameterValues() can turn this off, so
+	/// that only immediate events divide it.
+	void SetSplitsSlicesAtRamps(bool inFlag) noexcept { mSplitsSlicesAtRamps = inFlag; }
+	[[nodiscard]] bool SplitsSlicesAtRamps() const noexcept { return mSplitsSlicesAtRamps; }
+
+	/// During ProcessScheduledSlice(), the first frame of the slice within the buffer; else 0.
+	[[nodiscard]] UInt32 CurrentSliceStartFrame() const noexcept { return mCurrentSliceStartFrame; }
 
 	// Usually, you won't override this method.  You only need to call this if your DSP code
 	// is prepared to handle scheduled immediate and ramped parameter changes.
@@ -679,6 +834,7 @@ private:
 	const UInt32 mInitNumInputEls;
 	const UInt32 mInitNumOutputEls;
 	const UInt32 mInitNumGroupEls;
+	AURenderEpoch mRenderEpoch; // outlives the elements, whose parameter tables refer to it
 	std::array<AUScope, kNumScopes> mScopes;
 	AUThreadSafeList<RenderCallback> mRenderCallbacks;
 	bool mRenderCallbacksTouched{ false };
@@ -695,8 +851,22 @@ private:
 #endif
 	AUPreset mCurrentPreset{ -1, nullptr };
 	bool mUsesFixedBlockSize{ false };
+	BufferAllocator* mBufferAllocator{ nullptr };
+	bool mZeroCopyOutputs{ false };
+	// OutputCopyStatistics; only written by the render thread
+	std::atomic<UInt64> mBusRenders{ 0 };
+	std::atomic<UInt64> mZeroCopyBusRenders{ 0 };
+	std::atomic<UInt64> mBytesCopied{ 0 };
+	std::atomic<UInt64> mLastBytesCopied{ 0 };
 
 	ParameterEventList mParamEventList;
+	UInt32 mParameterEventCapacity{ kDefaultParameterEventCapacity };
+	// ProcessForScheduledParams() scratch, reserved with mParamEventList
+	std::vector<UInt32> mParamBreakpoints;
+	std::vector<const AudioUnitParameterEvent*> mActiveParamRamps;
+	UInt32 mMinimumSliceFrames{ 0 };
+	bool mSplitsSlicesAtRamps{ true };
+	UInt32 mCurrentSliceStartFrame{ 0 };
 	PropertyListeners mPropertyListeners;
 	bool mBuffersAllocated{ false };
 	const std::string mLogString;
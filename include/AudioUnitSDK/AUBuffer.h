@@ -10,9 +10,14 @@
 // clang-format on
 #include <AudioUnitSDK/AUUtility.h>
 
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstring>
+#include <mutex>
 #include <optional>
+#include <utility>
+#include <vector>
 
 namespace ausdk {
 
@@ -54,10 +59,149 @@ public:
 	BufferAllocator& operator=(const BufferAllocator&) = delete;
 	BufferAllocator& operator=(BufferAllocator&&) = delete;
 
+	static constexpr UInt32 kDefaultBufferAlignment = 64;
+
 	// N.B. Must return zeroed memory aligned to at least 16 bytes.
 	virtual AllocatedBuffer* Allocate(
 		UInt32 numberBuffers, UInt32 maxBytesPerBuffer, UInt32 reservedFlags);
 	virtual void Deallocate(AllocatedBuffer* allocatedBuffer);
+
+	/// Sets the alignment of each buffer within an allocation: a power of 2 from 16 to 4096.
+	/// Buffers whose size is a multiple of 1 KB are additionally padded by one alignment unit, so
+	/// that corresponding samples of different channels do not map to the same cache set.
+	/// Affects subsequent allocations only.
+	void SetBufferAlignment(UInt32 inAlignment);
+	[[nodiscard]] UInt32 GetBufferAlignment() const noexcept { return mBufferAlignment; }
+
+	/// How the zeroed memory returned by Allocate becomes resident.
+	enum class EPageTouchPolicy {
+		/// Zeroed, and so touched, during allocation.
+		EagerZero,
+		/// Zero-filled on demand by the system; AUBase touches the pages after allocating the
+		/// I/O buffers in DoInitialize, off the render thread.
+		PrefaultOnInitialize,
+		/// Zero-filled on demand by the system; pages fault in on first use, which may be on the
+		/// render thread.
+		LazyFirstTouch
+	};
+
+	void SetPageTouchPolicy(EPageTouchPolicy inPolicy) noexcept { mPageTouchPolicy = inPolicy; }
+	[[nodiscard]] EPageTouchPolicy GetPageTouchPolicy() const noexcept { return mPageTouchPolicy; }
+
+	static constexpr int kAnyNUMANode = -1;
+
+	/// Sample regions of at least this many bytes are backed by large pages (huge pages on
+	/// Linux, superpages on macOS) where the system provides them, falling back to ordinary
+	/// heap memory otherwise. 0, the default, disables large pages.
+	void SetLargePageThreshold(size_t inMinimumBytes) noexcept
+	{
+		mLargePageThreshold = inMinimumBytes;
+	}
+	[[nodiscard]] size_t GetLargePageThreshold() const noexcept { return mLargePageThreshold; }
+
+	/// Binds large-page regions to a NUMA node (Linux only). Allocation happens off the render
+	/// thread, so obtain the node by calling CurrentThreadNUMANode() on the render thread.
+	void SetPreferredNUMANode(int inNode) noexcept { mPreferredNUMANode = inNode; }
+	[[nodiscard]] int GetPreferredNUMANode() const noexcept { return mPreferredNUMANode; }
+
+	/// The NUMA node of the CPU running the calling thread, or kAnyNUMANode if unknown.
+	[[nodiscard]] static int CurrentThreadNUMANode() noexcept;
+
+protected:
+	/// Returns the distance between the starts of consecutive buffers, including padding.
+	[[nodiscard]] UInt32 BufferStride(UInt32 numberBuffers, UInt32 maxBytesPerBuffer) const;
+
+	/// Allocates zeroed memory for sample data, aligned to GetBufferAlignment(), honoring the
+	/// large page settings and the page touch policy.
+	void* AllocateZeroedRegion(size_t bytes);
+	/// Frees memory obtained from AllocateZeroedRegion.
+	void FreeRegion(void* region) noexcept;
+
+	/// Maps at least ioBytes of large pages for AllocateZeroedRegion, updating ioBytes to the
+	/// mapped length, or returns nullptr if the system provides none, in which case ordinary
+	/// pages are used. An override must return an anonymous mapping, which is freed with munmap.
+	virtual void* MapLargePages(size_t& ioBytes) noexcept;
+
+private:
+	UInt32 mBufferAlignment{ kDefaultBufferAlignment };
+	EPageTouchPolicy mPageTouchPolicy{ EPageTouchPolicy::EagerZero };
+	size_t mLargePageThreshold{ 0 };
+	int mPreferredNUMANode{ kAnyNUMANode };
+
+	std::mutex mMappedRegionsMutex;
+	// mapped regions and their sizes, in order of address
+	std::vector<std::pair<void*, size_t>> mMappedRegions;
+};
+
+/*!
+	@class	PooledBufferAllocator
+	@brief	BufferAllocator which recycles memory blocks in power-of-two size classes.
+
+	The AllocatedBuffer header and its sample storage share one contiguous block. Deallocated
+	blocks are kept on a free list per size class and reused by later allocations, so that
+	buffer reallocation cycles (e.g. SetMaxFramesPerSlice) across many instances do not churn the
+	heap. Each PooledBufferAllocator is an independent arena; see AUBase::SetBufferAllocator().
+
+	Define AUSDK_POOLED_BUFFER_ALLOCATOR to 1 to have BufferAllocator::instance() return a
+	shared PooledBufferAllocator.
+*/
+class PooledBufferAllocator : public BufferAllocator {
+public:
+	struct Statistics {
+		UInt64 mAllocations{ 0 };   ///< total number of Allocate calls
+		UInt64 mDeallocations{ 0 }; ///< total number of Deallocate calls
+		UInt64 mPoolHits{ 0 };      ///< allocations satisfied by a recycled block
+		UInt64 mBlocksInUse{ 0 };
+		UInt64 mBlocksCached{ 0 };
+		UInt64 mBytesInUse{ 0 };     ///< size-class bytes of the blocks in use
+		UInt64 mBytesRequested{ 0 }; ///< bytes actually needed by the blocks in use
+		UInt64 mBytesCached{ 0 };    ///< bytes held on the free lists
+
+		/// The fraction of in-use bytes lost to size-class rounding.
+		[[nodiscard]] double InternalFragmentation() const noexcept
+		{
+			return mBytesInUse > 0
+					   ? static_cast<double>(mBytesInUse - mBytesRequested) /
+							 static_cast<double>(mBytesInUse)
+					   : 0.0;
+		}
+	};
+
+	PooledBufferAllocator() = default;
+	~PooledBufferAllocator() override;
+
+	PooledBufferAllocator(const PooledBufferAllocator&) = delete;
+	PooledBufferAllocator(PooledBufferAllocator&&) = delete;
+	PooledBufferAllocator& operator=(const PooledBufferAllocator&) = delete;
+	PooledBufferAllocator& operator=(PooledBufferAllocator&&) = delete;
+
+	AllocatedBuffer* Allocate(
+		UInt32 numberBuffers, UInt32 maxBytesPerBuffer, UInt32 reservedFlags) override;
+	void Deallocate(AllocatedBuffer* allocatedBuffer) override;
+
+	[[nodiscard]] Statistics GetStatistics() const;
+
+	/// Returns all cached blocks to the system.
+	void Trim();
+
+private:
+	// Size classes run from 256 bytes to 1 GB; larger blocks bypass the pool.
+	static constexpr size_t kMinSizeClassShift = 8;
+	static constexpr size_t kNumSizeClasses = 23;
+
+	struct FreeBlock {
+		FreeBlock* mNext;
+	};
+
+	static size_t SizeClassIndex(size_t blockSize) noexcept;
+	static size_t SizeClassBytes(size_t index) noexcept
+	{
+		return size_t(1) << (index + kMinSizeClassShift);
+	}
+
+	mutable std::mutex mMutex;
+	std::array<FreeBlock*, kNumSizeClasses> mFreeLists{};
+	Statistics mStatistics;
 };
 
 /*!
@@ -117,46 +261,143 @@ public:
 				reinterpret_cast<std::byte*>(&abl)));                             // NOLINT
 	}
 
-	void CopyBufferContentsTo(AudioBufferList& destabl) const
-	{
-		ausdk::ThrowExceptionIf(mPtrState == EPtrState::Invalid, -1);
-		const auto& srcabl = mBuffers->mAudioBufferList;
-		const AudioBuffer* srcbuf = srcabl.mBuffers; // NOLINT
-		AudioBuffer* destbuf = destabl.mBuffers;     // NOLINT
-
-		for (UInt32 i = 0; i < destabl.mNumberBuffers; ++i, ++srcbuf, ++destbuf) { // NOLINT
-			if (i >=
-				srcabl.mNumberBuffers) { // duplicate last source to additional outputs [4341137]
-				--srcbuf;                // NOLINT
-			}
-			if (destbuf->mData != srcbuf->mData) {
-				memmove(destbuf->mData, srcbuf->mData, srcbuf->mDataByteSize);
-			}
-			destbuf->mDataByteSize = srcbuf->mDataByteSize;
-		}
-	}
+	/// Copies the sample data to destabl's buffers, duplicating the last source buffer to any
+	/// additional destination buffers. Buffers which already alias their source are skipped,
+	/// sources known to be silent are zero-filled rather than read, and large copies bypass the
+	/// cache (see AUSDK_NONTEMPORAL_STORE_THRESHOLD). Returns the number of bytes copied.
+	size_t CopyBufferContentsTo(AudioBufferList& destabl) const;
 
-	void Allocate(const AudioStreamBasicDescription& format, UInt32 nFrames);
+	/// Allocates from the given allocator, or from BufferAllocator::instance() if null. The
+	/// memory is returned to the same allocator on deallocation.
+	void Allocate(const AudioStreamBasicDescription& format, UInt32 nFrames,
+		BufferAllocator* allocator = nullptr);
 
 	void Deallocate();
 
 	// AudioBufferList utilities
-	static void ZeroBuffer(AudioBufferList& abl)
-	{
-		AudioBuffer* buf = abl.mBuffers;                         // NOLINT
-		for (UInt32 i = 0; i < abl.mNumberBuffers; ++i, ++buf) { // NOLINT
-			memset(buf->mData, 0, buf->mDataByteSize);
-		}
-	}
+	/// Zeroes every buffer; large lists bypass the cache (see AUSDK_NONTEMPORAL_STORE_THRESHOLD).
+	static void ZeroBuffer(AudioBufferList& abl);
+
+	/// Zeroes the current buffers and records that they are silent. Buffers in the list's own
+	/// memory which are still known to be silent are not written again.
+	void Silence();
+
+	/// Records that the list's own memory may have been written. Code which writes into prepared
+	/// buffers after a Silence() must call this, or a later Silence() may skip them.
+	void MarkModified() noexcept;
+	void MarkModified(UInt32 index) noexcept;
+
+	/// True if the current buffer at index is in the list's own memory, and has not been
+	/// modified since it was last silenced.
+	[[nodiscard]] bool IsKnownSilent(UInt32 index) const noexcept;
+
+	/// True if all the current buffers are known to be silent.
+	[[nodiscard]] bool IsKnownSilent() const noexcept;
 
 	[[nodiscard]] UInt32 GetAllocatedFrames() const noexcept { return mAllocatedFrames; }
 
+	/// Writes to every page of the allocated sample memory, so that it is resident before
+	/// rendering. The contents are unchanged.
+	void PrefaultPages() noexcept;
+
+	/// True if the current buffers all start at a multiple of alignment (a power of 2), so that
+	/// kernels may use aligned loads and stores. Buffers allocated by a BufferAllocator are
+	/// aligned to its GetBufferAlignment(); external buffers may not be.
+	[[nodiscard]] bool IsAligned(size_t alignment) const noexcept
+	{
+		return mPtrState != EPtrState::Invalid &&
+			   ABL::IsAligned(mBuffers->mAudioBufferList, alignment);
+	}
+
 private:
+	[[nodiscard]] const std::byte* OwnBufferData(UInt32 index) const noexcept;
+
 	EPtrState mPtrState{ EPtrState::Invalid };
 	AllocatedBuffer* mBuffers = nullptr; // only valid between Allocate and Deallocate
+	BufferAllocator* mAllocator = nullptr; // the allocator which produced mBuffers
 
 	UInt32 mAllocatedStreams{ 0 };
 	UInt32 mAllocatedFrames{ 0 };
+	std::vector<UInt32> mSilentBytes; // per stream: the number of leading bytes known to be zero
+};
+
+/*!
+	@class	AUScratchArena
+	@brief	Render-thread scratch memory shared by all audio unit instances in a process.
+
+	In a serial graph only one unit renders at a time on a given thread, so buffers which are only
+	needed for the duration of a render call (such as the buffers into which an input is pulled)
+	need not be owned by each unit. An arena is claimed by a thread when it enters the outermost
+	AUBase::DoRender (or DoProcess/DoProcessMultiple) and released when that call returns; each
+	nested render, e.g. of an upstream unit pulled via a connection, releases on exit what it
+	borrowed on entry.
+
+	Arenas are created by Reserve(), which must be called off the render thread. A thread which
+	finds no free arena renders without one, and elements which asked for shared scratch buffers
+	fall back to their private buffers, faulting them in; so reserve at least one arena per
+	concurrent render thread, including AUWorkerPool workers, each large enough for the scratch
+	needs of the deepest pull chain.
+*/
+class AUScratchArena {
+public:
+	/// The alignment of the memory returned by Allocate().
+	static constexpr size_t kAlignment = BufferAllocator::kDefaultBufferAlignment;
+
+	/// Ensures that at least inNumberOfArenas arenas of at least inBytesPerArena bytes exist.
+	/// Arenas are never freed; when the capacity grows, smaller arenas are no longer handed out.
+	/// Throws kAudio_MemFullError if the number of arenas would exceed kMaximumArenas.
+	static void Reserve(size_t inBytesPerArena, UInt32 inNumberOfArenas);
+
+	/// The capacity of the arenas handed out to render threads; 0 until Reserve() is called.
+	[[nodiscard]] static size_t Capacity() noexcept;
+
+	/// The arena claimed by the calling thread's current render, or null.
+	[[nodiscard]] static AUScratchArena* Current() noexcept;
+
+	/// The number of bytes Allocate() consumes for a request of inBytes.
+	[[nodiscard]] static constexpr size_t AllocationSize(size_t inBytes) noexcept
+	{
+		return (inBytes + kAlignment - 1) & ~(kAlignment - 1);
+	}
+
+	/// Returns uninitialized memory which remains valid until the innermost enclosing Scope
+	/// ends, or null if the arena is exhausted. Render thread only; never blocks.
+	[[nodiscard]] void* Allocate(size_t inBytes) noexcept;
+
+	/// Claims an arena for the calling thread (if it does not already hold one) and releases
+	/// everything allocated within the scope when destroyed.
+	class Scope {
+	public:
+		Scope() noexcept;
+		~Scope() noexcept;
+
+		Scope(const Scope&) = delete;
+		Scope(Scope&&) = delete;
+		Scope& operator=(const Scope&) = delete;
+		Scope& operator=(Scope&&) = delete;
+
+	private:
+		AUScratchArena* const mArena;
+		const size_t mMark;
+	};
+
+	static constexpr UInt32 kMaximumArenas = 64;
+
+	AUScratchArena(const AUScratchArena&) = delete;
+	AUScratchArena(AUScratchArena&&) = delete;
+	AUScratchArena& operator=(const AUScratchArena&) = delete;
+	AUScratchArena& operator=(AUScratchArena&&) = delete;
+
+private:
+	explicit AUScratchArena(size_t inCapacity);
+	~AUScratchArena() = default;
+
+	static AUScratchArena* Claim() noexcept;
+
+	std::byte* const mStorage;
+	const size_t mCapacity;
+	size_t mUsed{ 0 };
+	std::atomic<bool> mClaimed{ false };
 };
 
 } // namespace ausdk
@@ -0,0 +1,117 @@
+/*!
+	@file		AudioUnitSDK/AUChannelLanes.h
+	@copyright	© 2000-2023 Apple Inc. All rights reserved.
+*/
+#ifndef AudioUnitSDK_AUChannelLanes_h
+#define AudioUnitSDK_AUChannelLanes_h
+
+// clang-format off
+#include <AudioUnitSDK/AUConfig.h> // must come first
+// clang-format on
+
+#include <algorithm>
+
+namespace ausdk {
+
+// Vector sizes are spelled out, since a dependent vector_size attribute isn't portable.
+template <UInt32 Lanes>
+struct AUChannelLanesVector;
+
+template <>
+struct AUChannelLanesVector<4> {
+	using Type = float __attribute__((vector_size(16)));
+};
+
+template <>
+struct AUChannelLanesVector<8> {
+	using Type = float __attribute__((vector_size(32)));
+};
+
+template <>
+struct AUChannelLanesVector<16> {
+	using Type = float __attribute__((vector_size(64)));
+};
+
+/*!
+	@class	AUChannelLanes
+	@brief	Transposes up to Lanes planar channels into one SIMD vector per frame, and back.
+
+	A recursive filter cannot be vectorized along time, but it can across channels: with each
+	channel in a lane, one vector operation advances every channel by a frame. An
+	AUMultiChannelKernel processes the stream in groups of Lanes channels, packing a block of
+	frames into a buffer of Vectors, filtering it, and unpacking the result; see
+	GetGroupCount(). Lanes is 4, 8 or 16, i.e. 16, 32 or 64 bytes per vector.
+*/
+template <UInt32 Lanes>
+class AUChannelLanes {
+	static_assert(Lanes == 4 || Lanes == 8 || Lanes == 16, "AUChannelLanes: 4, 8 or 16 lanes");
+
+public:
+	using Vector = typename AUChannelLanesVector<Lanes>::Type;
+
+	static constexpr UInt32 kLanes = Lanes;
+
+	/// The number of groups of Lanes channels, the last possibly partial, in inNumChannels.
+	[[nodiscard]] static constexpr UInt32 GetGroupCount(UInt32 inNumChannels) noexcept
+	{
+		return (inNumChannels + Lanes - 1) / Lanes;
+	}
+
+	/// The number of channels in group inGroup of inNumChannels.
+	[[nodiscard]] static constexpr UInt32 GetGroupChannels(
+		UInt32 inNumChannels, UInt32 inGroup) noexcept
+	{
+		return std::min(inNumChannels - inGroup * Lanes, Lanes);
+	}
+
+	/// Writes frames [inFirstFrame, inFirstFrame + inNumFrames) of the inNumChannels (at most
+	/// Lanes) channels in inChannels to outPacked, one Vector per frame; unused lanes are zero.
+	static void Pack(const Float32* const* inChannels, UInt32 inNumChannels, UInt32 inFirstFrame,
+		UInt32 inNumFrames, Vector* outPacked) noexcept
+	{
+		if (inNumChannels == Lanes) {
+			// a constant trip count, which the compiler unrolls into a transpose
+			for (UInt32 frame = 0; frame < inNumFrames; ++frame) {
+				Vector values;
+				for (UInt32 lane = 0; lane < Lanes; ++lane) {
+					values[lane] = inChannels[lane][inFirstFrame + frame]; // NOLINT ptr math
+				}
+				outPacked[frame] = values; // NOLINT ptr math
+			}
+			return;
+		}
+		for (UInt32 frame = 0; frame < inNumFrames; ++frame) {
+			Vector values{};
+			for (UInt32 lane = 0; lane < inNumChannels; ++lane) {
+				values[lane] = inChannels[lane][inFirstFrame + frame]; // NOLINT ptr math
+			}
+			outPacked[frame] = values; // NOLINT ptr math
+		}
+	}
+
+	/// The inverse of Pack(): writes lanes [0, inNumChannels) of inNumFrames Vectors to frames
+	/// [inFirstFrame, inFirstFrame + inNumFrames) of outChannels.
+	static void Unpack(const Vector* inPacked, UInt32 inNumFrames, Float32* const* outChannels,
+		UInt32 inNumChannels, UInt32 inFirstFrame) noexcept
+	{
+		if (inNumChannels == Lanes) {
+			for (UInt32 frame = 0; frame < inNumFrames; ++frame) {
+				const Vector values = inPacked[frame]; // NOLINT ptr math
+				for (UInt32 lane = 0; lane < Lanes; ++lane) {
+					outChannels[lane][inFirstFrame + frame] = values[lane]; // NOLINT ptr math
+				}
+			}
+			return;
+		}
+		for (UInt32 frame = 0; frame < inNumFrames; ++frame) {
+			const Vector values = inPacked[frame]; // NOLINT ptr math
+			for (UInt32 lane = 0; lane < inNumChannels; ++lane) {
+				outChannels[lane][inFirstFrame + frame] = values[lane]; // NOLINT ptr math
+			}
+		}
+	}
+};
+
+} // namespace ausdk
+
+#endif // AudioUnitSDK_AUChannelLanes_h
@@ -106,5 +106,30 @@ enum { noErr = 0 };
 #endif
 #endif // !defined(AUSDK_HAVE_MUSIC_DEVICE)
 
+// -------------------------------------------------------------------------------------------------
+#pragma mark -
+#pragma mark Buffer allocation
+
+// When nonzero, BufferAllocator::instance() returns a PooledBufferAllocator.
+#if !defined(AUSDK_POOLED_BUFFER_ALLOCATOR)
+#define AUSDK_POOLED_BUFFER_ALLOCATOR 0
+#endif // !defined(AUSDK_POOLED_BUFFER_ALLOCATOR)
+
+// AUBufferList copies and fills totalling at least this many bytes use non-temporal stores,
+// which bypass the cache. 0 disables them.
+#if !defined(AUSDK_NONTEMPORAL_STORE_THRESHOLD)
+#define AUSDK_NONTEMPORAL_STORE_THRESHOLD (256 * 1024)
+#endif // !defined(AUSDK_NONTEMPORAL_STORE_THRESHOLD)
+
+// -------------------------------------------------------------------------------------------------
+#pragma mark -
+#pragma mark Real-time safety
+
+// When nonzero, AURealtimeGuard records allocations, locks and blocking system calls made inside
+// render calls. For debug and profiling builds only: it replaces the global allocation functions.
+#if !defined(AUSDK_REALTIME_GUARD)
+#define AUSDK_REALTIME_GUARD 0
+#endif // !defined(AUSDK_REALTIME_GUARD)
+
 
 #endif /* AUConfig_h */
@@ -10,13 +10,18 @@
 // clang-format on
 #include <AudioUnitSDK/AUBase.h>
 #include <AudioUnitSDK/AUSilentTimeout.h>
+#include <AudioUnitSDK/AUSmoothedParameter.h>
 #include <AudioUnitSDK/AUUtility.h>
+#include <AudioUnitSDK/AUWorkerPool.h>
 
+#include <atomic>
 #include <memory>
+#include <vector>
 
 namespace ausdk {
 
 class AUKernelBase;
+class AUMultiChannelKernel;
 
 /*!
 	@class	AUEffectBase
@@ -56,6 +61,12 @@ public:
 	// it can override NewKernel to create a mono processing object per channel.  Otherwise,
 	// don't override NewKernel, and instead, override ProcessBufferLists.
 	virtual std::unique_ptr<AUKernelBase> NewKernel() { return {}; }
+
+	// If your unit processes N to N channels and would rather see all of them at once, e.g. to
+	// share coefficients between channels or vectorize across them, override
+	// NewMultiChannelKernel instead. When it returns a kernel, NewKernel is not called.
+	virtual std::unique_ptr<AUMultiChannelKernel> NewMultiChannelKernel() { return {}; }
+
 	OSStatus ProcessBufferLists(AudioUnitRenderActionFlags& ioActionFlags,
 		const AudioBufferList& inBuffer, AudioBufferList& outBuffer,
 		UInt32 inFramesToProcess) override;
@@ -79,12 +90,39 @@ public:
 		return Globals()->GetParameter(paramID);
 	}
 
+	/// Writes a global parameter's values for the slice being processed; see
+	/// AUElement::FillParameterValues().
+	void FillParameterValues(AudioUnitParameterID paramID, AudioUnitParameterValue* outValues,
+		UInt32 inNumValues, UInt32 inFrameStep = 1)
+	{
+		Globals()->FillParameterValues(
+			paramID, outValues, inNumValues, CurrentSliceStartFrame(), inFrameStep);
+	}
+
 	[[nodiscard]] bool CanScheduleParameters() const override { return true; }
 
 	// This is used for the property value - to reflect to the UI if an effect is bypassed
-	[[nodiscard]] bool IsBypassEffect() const noexcept { return mBypassEffect; }
+	[[nodiscard]] bool IsBypassEffect() const noexcept
+	{
+		return mBypassEffect.load(std::memory_order_relaxed);
+	}
+
+	/// May be called from any thread; Render() picks up the change. When it processes again
+	/// after a full bypass, Render() calls BypassEnded() first.
+	virtual void SetBypassEffect(bool inFlag)
+	{
+		mBypassEffect.store(inFlag, std::memory_order_relaxed);
+	}
 
-	virtual void SetBypassEffect(bool inFlag) { mBypassEffect = inFlag; }
+	/// The length of the crossfade between the processed and the bypassed signal when the
+	/// bypass changes. Only during a crossfade does a bypassed unit run its kernels; in place,
+	/// it also copies the input to a buffer allocated by Initialize(). The default, 0, switches
+	/// at once. Takes effect at the next Initialize().
+	void SetBypassCrossfadeFrames(UInt32 inFrames) noexcept { mBypassCrossfadeFrames = inFrames; }
+	[[nodiscard]] UInt32 GetBypassCrossfadeFrames() const noexcept
+	{
+		return mBypassCrossfadeFrames;
+	}
 
 	void SetParamHasSampleRateDependency(bool inFlag) noexcept { mParamSRDep = inFlag; }
 	[[nodiscard]] bool GetParamHasSampleRateDependency() const noexcept { return mParamSRDep; }
@@ -99,12 +137,53 @@ public:
 	OSStatus ProcessScheduledSlice(void* inUserData, UInt32 inStartFrameInBuffer,
 		UInt32 inSliceFramesToProcess, UInt32 inTotalBufferFrames) override;
 
+	/// Counts of the slices into which scheduled parameter events divided renders; see
+	/// AUBase::SetMinimumSliceFrames().
+	struct SliceStatistics {
+		UInt64 mScheduledRenders{ 0 }; ///< renders with scheduled parameter events
+		UInt64 mSlices{ 0 };           ///< ProcessScheduledSlice() calls
+		UInt64 mLastRenderSlices{ 0 }; ///< slices in the most recent scheduled render
+		UInt64 mSliceHostTime{ 0 };    ///< host time spent in ProcessScheduledSlice(), if known
+	};
+
+	/// May be called from any thread.
+	[[nodiscard]] SliceStatistics GetSliceStatistics() const noexcept;
+
+	void ResetSliceStatistics() noexcept;
+
 	[[nodiscard]] bool ProcessesInPlace() const noexcept { return mProcessesInPlace; }
 	void SetProcessesInPlace(bool inProcessesInPlace) noexcept
 	{
 		mProcessesInPlace = inProcessesInPlace;
 	}
 
+	/// The number of threads, including the render thread, across which the per-channel kernels
+	/// run; see AUWorkerPool. The default, 1, runs them in turn on the render thread. Use more
+	/// for heavy per-channel DSP on many channels; the kernels must then not share mutable
+	/// state. Takes effect at the next Initialize().
+	void SetKernelThreads(UInt32 inNumThreads) noexcept { mKernelThreads = inNumThreads; }
+	[[nodiscard]] UInt32 GetKernelThreads() const noexcept { return mKernelThreads; }
+
+	/// Lets the kernels sleep through silence. Once the input has been silent for longer than
+	/// GetLatency() + GetTailTime(), renders skip ProcessBufferLists() and flag the output
+	/// silent, rewriting it only if it isn't known to be silent already. The kernels wake, see
+	/// WakeKernels(), at the first render with non-silent input or scheduled parameter events.
+	/// Off by default: a unit which under-reports its tail time would have the tail cut off.
+	void SetKernelSleepEnabled(bool inEnabled) noexcept { mKernelSleepEnabled = inEnabled; }
+	[[nodiscard]] bool IsKernelSleepEnabled() const noexcept { return mKernelSleepEnabled; }
+
+	/// Counts of the work skipped by sleeping kernels; see SetKernelSleepEnabled().
+	struct SleepStatistics {
+		UInt64 mSleepingRenders{ 0 }; ///< renders which skipped ProcessBufferLists()
+		UInt64 mSkippedFrames{ 0 };   ///< frames in those renders
+		UInt64 mWakes{ 0 };           ///< WakeKernels() calls
+	};
+
+	/// May be called from any thread.
+	[[nodiscard]] SleepStatistics GetSleepStatistics() const noexcept;
+
+	void ResetSleepStatistics() noexcept;
+
 	using KernelList = std::vector<std::unique_ptr<AUKernelBase>>;
 
 protected:
@@ -119,6 +198,22 @@ protected:
 		return (index < mKernelList.size()) ? mKernelList[index].get() : nullptr;
 	}
 	[[nodiscard]] const KernelList& GetKernelList() const noexcept { return mKernelList; }
+	[[nodiscard]] AUMultiChannelKernel* GetMultiChannelKernel() const noexcept
+	{
+		return mMultiChannelKernel.get();
+	}
+
+	/// Called by Render() before it processes again after the kernels have slept. Resets the
+	/// kernels, whose state froze when they stopped; override to also reset DSP state kept
+	/// elsewhere, e.g. by a subclass which overrides ProcessBufferLists().
+	virtual void WakeKernels();
+
+	/// Called by Render() before it processes again after the unit has been fully bypassed. The
+	/// default calls Reset(kAudioUnitScope_Global, 0), as turning kAudioUnitProperty_BypassEffect
+	/// off always has. Note for subclasses: this now happens on the render thread, not in
+	/// SetProperty(); a unit whose Reset() is not safe to call during render should override
+	/// this to reset only its DSP state.
+	virtual void BypassEnded();
 
 	bool IsInputSilent(AudioUnitRenderActionFlags inActionFlags, UInt32 inFramesToProcess)
 	{
@@ -139,8 +234,32 @@ protected:
 #endif
 
 private:
+	// Processes one channel with its kernel, if it has one; returns whether the output is silent.
+	bool ProcessKernel(UInt32 inChannel, const AudioBufferList& inBuffer,
+		AudioBufferList& outBuffer, UInt32 inFramesToProcess, bool inSilentInput);
+	void ResetKernels();
+	// Mixes inDry into ioWet, moving mBypassFadePosition towards inTarget.
+	void CrossfadeBypass(const AudioBufferList& inDry, AudioBufferList& ioWet,
+		UInt32 inFramesToProcess, UInt32 inTarget) noexcept;
+
 	KernelList mKernelList;
-	bool mBypassEffect{ false };
+	std::unique_ptr<AUWorkerPool> mKernelWorkers; // with SetKernelThreads(), while initialized
+	std::vector<UInt8> mKernelSilence;            // each kernel's result, when run on workers
+	UInt32 mKernelThreads{ 1 };
+	bool mKernelSleepEnabled{ false };
+	bool mKernelsAsleep{ false };   // only used by the render thread
+	bool mKernelsBypassed{ false }; // only used by the render thread
+	std::unique_ptr<AUMultiChannelKernel> mMultiChannelKernel;
+	// the multi-channel kernel's channel pointers, sized by MaintainKernels()
+	std::vector<const Float32*> mKernelSources;
+	std::vector<Float32*> mKernelDests;
+	std::atomic<bool> mBypassEffect{ false };
+	UInt32 mBypassCrossfadeFrames{ 0 };
+	// only used by the render thread, and Initialize()
+	UInt32 mBypassFadeFrames{ 0 };   // mBypassCrossfadeFrames, as of Initialize()
+	UInt32 mBypassFadePosition{ 0 }; // from 0, processed, to mBypassFadeFrames, bypassed
+	bool mBypassFading{ false };     // while Render() processes for a crossfade
+	AUBufferList mBypassDryBuffer;
 	bool mParamSRDep{ false };
 	bool mProcessesInPlace;
 	AUSilentTimeout mSilentTimeout;
@@ -151,6 +270,15 @@ private:
 	bool mOnlyOneKernel;
 #endif
 	UInt32 mBytesPerFrame = 0;
+	// SliceStatistics; only written by the render thread
+	std::atomic<UInt64> mScheduledRenders{ 0 };
+	std::atomic<UInt64> mSlices{ 0 };
+	std::atomic<UInt64> mLastRenderSlices{ 0 };
+	std::atomic<UInt64> mSliceHostTime{ 0 };
+	// SleepStatistics; only written by the render thread
+	std::atomic<UInt64> mSleepingRenders{ 0 };
+	std::atomic<UInt64> mSkippedFrames{ 0 };
+	std::atomic<UInt64> mWakes{ 0 };
 };
 
 
@@ -185,6 +313,29 @@ public:
 		return mAudioUnit.GetParameter(paramID);
 	}
 
+	/// A global parameter resolved once, e.g. in the kernel's constructor, for reads without a
+	/// lookup.
+	AUParameterHandle GetParameterHandle(AudioUnitParameterID paramID)
+	{
+		return mAudioUnit.Globals()->GetParameterHandle(paramID);
+	}
+
+	/// A smoothed view of a global parameter, without a lookup per read. Make it once, e.g. in
+	/// the kernel's constructor, and call its Process() or Advance() once per block.
+	AUSmoothedParameter MakeSmoothedParameter(AudioUnitParameterID paramID,
+		AUSmoothedParameter::ESmoothing inSmoothing, UInt32 inSmoothingFrames)
+	{
+		return { *mAudioUnit.Globals(), paramID, inSmoothing, inSmoothingFrames };
+	}
+
+	/// Writes a parameter's per-sample (or, with a larger inFrameStep, per-block) values for the
+	/// frames being processed, following any scheduled ramp.
+	void FillParameterValues(AudioUnitParameterID paramID, AudioUnitParameterValue* outValues,
+		UInt32 inNumValues, UInt32 inFrameStep = 1)
+	{
+		mAudioUnit.FillParameterValues(paramID, outValues, inNumValues, inFrameStep);
+	}
+
 	void SetChannelNum(UInt32 inChan) noexcept { mChannelNum = inChan; }
 	[[nodiscard]] UInt32 GetChannelNum() const noexcept { return mChannelNum; }
 
@@ -193,6 +344,73 @@ protected:
 	UInt32 mChannelNum = 0;   // NOLINT protected
 };
 
+
+/*!
+	@class	AUMultiChannelKernel
+	@brief	Base class for a signal-processing "kernel" that performs DSP on all channels of an
+			audio stream in one call; see AUEffectBase::NewMultiChannelKernel().
+
+	Unlike a set of AUKernelBase objects, it can compute coefficients once for every channel,
+	and vectorize across channels, e.g. with AUChannelLanes.
+*/
+class AUMultiChannelKernel {
+public:
+	explicit AUMultiChannelKernel(AUEffectBase& inAudioUnit) : mAudioUnit(inAudioUnit) {}
+
+	AUMultiChannelKernel(const AUMultiChannelKernel&) = delete;
+	AUMultiChannelKernel(AUMultiChannelKernel&&) = delete;
+	AUMultiChannelKernel& operator=(const AUMultiChannelKernel&) = delete;
+	AUMultiChannelKernel& operator=(AUMultiChannelKernel&&) = delete;
+
+	virtual ~AUMultiChannelKernel() = default;
+
+	virtual void Reset() {}
+
+	/// Called by AUEffectBase::Initialize() before any Process(), e.g. to size per-channel
+	/// state. An override must call this.
+	virtual void SetNumberOfChannels(UInt32 inNumChannels) { mNumChannels = inNumChannels; }
+	[[nodiscard]] UInt32 GetNumberOfChannels() const noexcept { return mNumChannels; }
+
+	/// inSources and inDests hold GetNumberOfChannels() pointers, which alias when the unit
+	/// processes in place. ioSilence is true on entry if every input channel is silent; set it
+	/// to false unless every output channel is.
+	virtual void Process(const Float32* const* /*inSources*/, Float32* const* /*inDests*/,
+		UInt32 /*inFramesToProcess*/, bool& /*ioSilence*/) = 0;
+
+	Float64 GetSampleRate() { return mAudioUnit.GetSampleRate(); }
+
+	AudioUnitParameterValue GetParameter(AudioUnitParameterID paramID)
+	{
+		return mAudioUnit.GetParameter(paramID);
+	}
+
+	/// See AUKernelBase::GetParameterHandle().
+	AUParameterHandle GetParameterHandle(AudioUnitParameterID paramID)
+	{
+		return mAudioUnit.Globals()->GetParameterHandle(paramID);
+	}
+
+	/// See AUKernelBase::MakeSmoothedParameter().
+	AUSmoothedParameter MakeSmoothedParameter(AudioUnitParameterID paramID,
+		AUSmoothedParameter::ESmoothing inSmoothing, UInt32 inSmoothingFrames)
+	{
+		return { *mAudioUnit.Globals(), paramID, inSmoothing, inSmoothingFrames };
+	}
+
+	/// See AUKernelBase::FillParameterValues().
+	void FillParameterValues(AudioUnitParameterID paramID, AudioUnitParameterValue* outValues,
+		UInt32 inNumValues, UInt32 inFrameStep = 1)
+	{
+		mAudioUnit.FillParameterValues(paramID, outValues, inNumValues, inFrameStep);
+	}
+
+protected:
+	AUEffectBase& mAudioUnit; // NOLINT protected
+
+private:
+	UInt32 mNumChannels = 0;
+};
+
 } // namespace ausdk
 
 #endif // AudioUnitSDK_AUEffectBase_h
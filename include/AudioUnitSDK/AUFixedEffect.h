@@ -0,0 +1,138 @@
+/*!
+	@file		AudioUnitSDK/AUFixedEffect.h
+	@copyright	© 2000-2023 Apple Inc. All rights reserved.
+*/
+#ifndef AudioUnitSDK_AUFixedEffect_h
+#define AudioUnitSDK_AUFixedEffect_h
+
+// clang-format off
+#include <AudioUnitSDK/AUConfig.h> // must come first
+// clang-format on
+#include <AudioUnitSDK/AUEffectBase.h>
+
+#include <algorithm>
+#include <array>
+
+namespace ausdk {
+
+/*!
+	@class	AUFixedEffect
+	@brief	An effect whose channel count, largest block and in-place processing are fixed at
+			compile time.
+
+	The unit accepts Channels channels on its input and output, and its DSP, ProcessBlock(),
+	sees all of them at once, in arrays of constant size, and never more than MaxBlock frames:
+	longer renders are divided into blocks. A render of exactly MaxBlock frames goes to
+	ProcessFixedBlock() instead, whose loops can have a constant trip count; implement both
+	with one inline function to let the compiler unroll and vectorize it for that case. When
+	the host sets UsesFixedBlockSize() and a MaxFramesPerSlice of MaxBlock (the default), every
+	render takes that path, except for the slices of renders with scheduled parameter events.
+
+	With InPlace false, the sources and destinations never overlap. With InPlace true, they
+	overlap unless the input or output needs format conversion. The host can't change it.
+*/
+template <UInt32 Channels, UInt32 MaxBlock, bool InPlace>
+class AUFixedEffect : public AUEffectBase {
+	static_assert(Channels > 0 && MaxBlock > 0, "AUFixedEffect: no channels or frames");
+
+public:
+	static constexpr UInt32 kChannels = Channels;
+	static constexpr UInt32 kMaxBlock = MaxBlock;
+	static constexpr bool kInPlace = InPlace;
+
+	using Sources = std::array<const Float32*, Channels>;
+	using Dests = std::array<Float32*, Channels>;
+
+	explicit AUFixedEffect(AudioComponentInstance audioUnit) : AUEffectBase(audioUnit, InPlace)
+	{
+		SetMaxFramesPerSlice(MaxBlock);
+	}
+
+	/// Processes inFramesToProcess frames, at most kMaxBlock, of every channel. ioSilence is
+	/// true on entry if the input is silent; set it to false unless the output is.
+	virtual void ProcessBlock(const Sources& inSources, const Dests& inDests,
+		UInt32 inFramesToProcess, bool& ioSilence) = 0;
+
+	/// Processes exactly kMaxBlock frames; by default, calls ProcessBlock().
+	virtual void ProcessFixedBlock(const Sources& inSources, const Dests& inDests, bool& ioSilence)
+	{
+		ProcessBlock(inSources, inDests, MaxBlock, ioSilence);
+	}
+
+	UInt32 SupportedNumChannels(const AUChannelInfo** outInfo) override
+	{
+		static constexpr AUChannelInfo kChannelInfo{ .inChannels = Channels,
+			.outChannels = Channels };
+		if (outInfo != nullptr) {
+			*outInfo = &kChannelInfo;
+		}
+		return 1;
+	}
+
+	OSStatus GetPropertyInfo(AudioUnitPropertyID inID, AudioUnitScope inScope,
+		AudioUnitElement inElement, UInt32& outDataSize, bool& outWritable) override
+	{
+		const OSStatus result =
+			AUEffectBase::GetPropertyInfo(inID, inScope, inElement, outDataSize, outWritable);
+		if (result == noErr && inScope == kAudioUnitScope_Global &&
+			inID == kAudioUnitProperty_InPlaceProcessing) {
+			outWritable = false;
+		}
+		return result;
+	}
+
+	OSStatus SetProperty(AudioUnitPropertyID inID, AudioUnitScope inScope,
+		AudioUnitElement inElement, const void* inData, UInt32 inDataSize) override
+	{
+		if (inScope == kAudioUnitScope_Global && inID == kAudioUnitProperty_InPlaceProcessing) {
+			AUSDK_Require(inDataSize >= sizeof(UInt32), kAudioUnitErr_InvalidPropertyValue);
+			const bool inPlace = *static_cast<const UInt32*>(inData) != 0;
+			AUSDK_Require(inPlace == InPlace, kAudioUnitErr_PropertyNotWritable);
+			return noErr;
+		}
+		return AUEffectBase::SetProperty(inID, inScope, inElement, inData, inDataSize);
+	}
+
+	// Render() has already checked ShouldBypassEffect(), and Initialize() the channel count.
+	OSStatus ProcessBufferLists(AudioUnitRenderActionFlags& ioActionFlags,
+		const AudioBufferList& inBuffer, AudioBufferList& outBuffer,
+		UInt32 inFramesToProcess) override
+	{
+		Sources sources{};
+		Dests dests{};
+		for (UInt32 channel = 0; channel < Channels; ++channel) {
+			sources[channel] =
+				static_cast<const Float32*>(inBuffer.mBuffers[channel].mData); // NOLINT
+			dests[channel] = static_cast<Float32*>(outBuffer.mBuffers[channel].mData); // NOLINT
+		}
+
+		const bool silentInput = IsInputSilent(ioActionFlags, inFramesToProcess);
+		bool silentOutput = true; // unless a block isn't
+		if (inFramesToProcess == MaxBlock) {
+			silentOutput = silentInput;
+			ProcessFixedBlock(sources, dests, silentOutput);
+		} else {
+			for (UInt32 offset = 0; offset < inFramesToProcess; offset += MaxBlock) {
+				bool blockSilence = silentInput;
+				ProcessBlock(sources, dests, std::min(MaxBlock, inFramesToProcess - offset),
+					blockSilence);
+				silentOutput = silentOutput && blockSilence;
+				for (UInt32 channel = 0; channel < Channels; ++channel) {
+					sources[channel] += MaxBlock; // NOLINT ptr math
+					dests[channel] += MaxBlock;   // NOLINT ptr math
+				}
+			}
+		}
+
+		if (silentOutput) {
+			ioActionFlags |= kAudioUnitRenderAction_OutputIsSilence;
+		} else {
+			ioActionFlags &= ~kAudioUnitRenderAction_OutputIsSilence;
+		}
+		return noErr;
+	}
+};
+
+} // namespace ausdk
+
+#endif // AudioUnitSDK_AUFixedEffect_h
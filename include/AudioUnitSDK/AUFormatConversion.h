@@ -0,0 +1,79 @@
+/*!
+	@file		AudioUnitSDK/AUFormatConversion.h
+	@copyright	© 2000-2023 Apple Inc. All rights reserved.
+*/
+#ifndef AudioUnitSDK_AUFormatConversion_h
+#define AudioUnitSDK_AUFormatConversion_h
+
+// clang-format off
+#include <AudioUnitSDK/AUConfig.h> // must come first
+// clang-format on
+#include <AudioUnitSDK/AUUtility.h>
+
+namespace ausdk::FormatConversion {
+
+/// Dither added when reducing Float32 to an integer sample format.
+enum class EDither : UInt8 {
+	None,        ///< round to nearest
+	Rectangular, ///< uniform noise of 1 LSB peak-to-peak
+	Triangular   ///< TPDF noise of 2 LSB peak-to-peak; decorrelates the error from the signal
+};
+
+/*!
+	@class	Ditherer
+	@brief	Dither setting and noise generator state for one stream.
+*/
+class Ditherer {
+public:
+	explicit Ditherer(EDither inMode = EDither::None) noexcept : mMode{ inMode } {}
+
+	[[nodiscard]] EDither Mode() const noexcept { return mMode; }
+	void SetMode(EDither inMode) noexcept { mMode = inMode; }
+
+	/// Returns the next noise sample, in units of the output's least significant bit.
+	float Next() noexcept
+	{
+		if (mMode == EDither::Rectangular) {
+			return Uniform() - 0.5f; // NOLINT magic number
+		}
+		if (mMode == EDither::Triangular) {
+			return Uniform() - Uniform();
+		}
+		return 0.0f;
+	}
+
+private:
+	// [0, 1) from a 32-bit linear congruential generator; plenty for dither.
+	float Uniform() noexcept
+	{
+		mState = mState * 1664525u + 1013904223u;                       // NOLINT magic number
+		return static_cast<float>(mState >> 8u) * (1.0f / 16777216.0f); // NOLINT magic number
+	}
+
+	EDither mMode;
+	UInt32 mState{ 0x2545F491u }; // NOLINT magic number
+};
+
+/// True if an element in this stream format can present its data to kernels as planar Float32
+/// via an AUIOElement conversion stage: native-endian packed linear PCM of signed 16- or
+/// 24-bit integers, or 32- or 64-bit floats, interleaved or not, which is not already
+/// ASBD::IsCommonFloat32.
+[[nodiscard]] bool IsConvertible(const AudioStreamBasicDescription& format) noexcept;
+
+/// The format seen by kernels: non-interleaved Float32, at the format's rate and channel count.
+[[nodiscard]] AudioStreamBasicDescription PlanarFormat(
+	const AudioStreamBasicDescription& format) noexcept;
+
+/// Converts nFrames of data in inFormat to Float32 in outPlanar, which must have a buffer of at
+/// least nFrames samples for each channel.
+void ToPlanar(const AudioStreamBasicDescription& inFormat, const AudioBufferList& inInterleaved,
+	AudioBufferList& outPlanar, UInt32 nFrames);
+
+/// Converts nFrames of planar Float32 into outInterleaved, in outFormat. Integer samples are
+/// rounded to nearest after adding the ditherer's noise, if any, and clipped.
+void FromPlanar(const AudioBufferList& inPlanar, const AudioStreamBasicDescription& outFormat,
+	AudioBufferList& outInterleaved, UInt32 nFrames, Ditherer* ioDitherer = nullptr);
+
+} // namespace ausdk::FormatConversion
+
+#endif // AudioUnitSDK_AUFormatConversion_h
@@ -29,6 +29,10 @@ public:
 	// AUElement override
 	OSStatus SetStreamFormat(const AudioStreamBasicDescription& fmt) override;
 	[[nodiscard]] bool NeedsBufferSpace() const override { return IsCallback(); }
+
+	/// Input buffers are only used while rendering, so they may come from the AUScratchArena.
+	using AUIOElement::SetBufferAllocation;
+
 	void SetConnection(const AudioUnitConnection& conn);
 	void SetInputCallback(AURenderCallback proc, void* refCon);
 	[[nodiscard]] bool IsActive() const noexcept { return mInputType != EInputType::NoInput; }
@@ -127,6 +127,14 @@ protected:
 
 	void PerformEvents(const AudioTimeStamp& inTimeStamp);
 
+	// Off by default. When on, Render() treats an output as written only while a group has
+	// sounding notes (see SynthGroupElement::HasSoundingNotes()), so that an idle instrument
+	// neither re-zeroes its outputs each render nor copies their silence, and reports it with
+	// kAudioUnitRenderAction_OutputIsSilence. An override of Render() which adds to the outputs,
+	// e.g. a reverb or release tail, must call MarkBufferListModified() on them.
+	void SetTracksSilentOutputs(bool inFlag) { mTracksSilentOutputs = inFlag; }
+	bool TracksSilentOutputs() const { return mTracksSilentOutputs; }
+
 	OSStatus SendPedalEvent(
 		MusicDeviceGroupID inGroupID, UInt32 inEventType, UInt32 inOffsetSampleFrame);
 
@@ -162,6 +170,7 @@ private:
 	UInt32 mNoteSize;
 	ausdk::AUScope mPartScope;
 	const UInt32 mInitNumPartEls;
+	bool mTracksSilentOutputs{ false };
 };
 
 #endif /* AUInstrumentBase_hpp */
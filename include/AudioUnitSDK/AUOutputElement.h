@@ -12,6 +12,8 @@
 #include <AudioUnitSDK/AUScopeElement.h>
 #include <AudioUnitSDK/AUUtility.h>
 
+#include <optional>
+
 namespace ausdk {
 
 class AUBase;
@@ -32,6 +34,21 @@ public:
 	// AUElement override
 	OSStatus SetStreamFormat(const AudioStreamBasicDescription& desc) override;
 	[[nodiscard]] bool NeedsBufferSpace() const override { return true; }
+
+	/// Records that the element's buffer list references a caller's buffers, into which it was
+	/// rendered for the given sample time (see AUBase::SetZeroCopyOutputs()); nullopt clears it.
+	void SetRenderedInPlace(std::optional<Float64> inSampleTime) noexcept
+	{
+		mRenderedInPlaceTime = inSampleTime;
+	}
+
+	[[nodiscard]] bool RenderedInPlaceAt(Float64 inSampleTime) const noexcept
+	{
+		return mRenderedInPlaceTime == inSampleTime;
+	}
+
+private:
+	std::optional<Float64> mRenderedInPlaceTime;
 };
 
 } // namespace ausdk
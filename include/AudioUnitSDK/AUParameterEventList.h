@@ -0,0 +1,130 @@
+/*!
+	@file		AudioUnitSDK/AUParameterEventList.h
+	@copyright	© 2000-2023 Apple Inc. All rights reserved.
+*/
+#ifndef AudioUnitSDK_AUParameterEventList_h
+#define AudioUnitSDK_AUParameterEventList_h
+
+// clang-format off
+#include <AudioUnitSDK/AUConfig.h> // must come first
+// clang-format on
+
+#include <AudioToolbox/AUComponent.h>
+
+#include <atomic>
+#include <vector>
+
+namespace ausdk {
+
+/*!
+	@class	AUParameterEventList
+	@brief	The parameter events scheduled for the next render cycle.
+
+	Storage for kDefaultCapacity events is allocated at construction, and resized by Reserve(),
+	normally from AUBase::DoInitialize(); Push() never allocates. Events are kept contiguous, in
+	arrival order, so they can be sorted and iterated in place. When the list is full, Push()
+	follows the overflow policy; events merged into another and events lost are counted
+	separately.
+
+	This replaces the std::vector<AudioUnitParameterEvent> which AUBase::ParameterEventList
+	used to be. Iteration, size(), empty(), clear() and push_back() are kept; subclasses which
+	used other vector operations, such as insert(), erase() or indexing, must iterate instead.
+*/
+class AUParameterEventList {
+public:
+	enum class EOverflowPolicy : UInt8 {
+		DropOldest,          ///< discard the earliest event pushed
+		CoalesceByParameter, ///< replace the latest event for the same parameter, else drop
+		ReportError          ///< drop the new event; Push() returns kAudio_MemFullError
+	};
+
+	using value_type = AudioUnitParameterEvent;
+	using iterator = AudioUnitParameterEvent*;
+	using const_iterator = const AudioUnitParameterEvent*;
+
+	static constexpr UInt32 kDefaultCapacity = 256;
+
+	AUParameterEventList() { Reserve(kDefaultCapacity); }
+
+	AUParameterEventList(const AUParameterEventList&) = delete;
+	AUParameterEventList(AUParameterEventList&&) = delete;
+	AUParameterEventList& operator=(const AUParameterEventList&) = delete;
+	AUParameterEventList& operator=(AUParameterEventList&&) = delete;
+	~AUParameterEventList() = default;
+
+	/// Allocates room for inCapacity events, keeping the pending events; if there are more than
+	/// inCapacity, the oldest are dropped. Not real-time safe.
+	void Reserve(UInt32 inCapacity);
+
+	[[nodiscard]] UInt32 Capacity() const noexcept { return mCapacity; }
+
+	void SetOverflowPolicy(EOverflowPolicy inPolicy) noexcept { mOverflowPolicy = inPolicy; }
+	[[nodiscard]] EOverflowPolicy GetOverflowPolicy() const noexcept { return mOverflowPolicy; }
+
+	/// Appends an event, applying the overflow policy if the list is full. Real-time safe.
+	OSStatus Push(const AudioUnitParameterEvent& inEvent) noexcept;
+
+	/// As Push(), for code written against std::vector.
+	void push_back(const AudioUnitParameterEvent& inEvent) noexcept { Push(inEvent); }
+
+	void clear() noexcept
+	{
+		mBegin = 0;
+		mEnd = 0;
+	}
+
+	[[nodiscard]] bool empty() const noexcept { return mBegin == mEnd; }
+	[[nodiscard]] size_t size() const noexcept { return mEnd - mBegin; }
+
+	iterator begin() noexcept { return mStorage.data() + mBegin; } // NOLINT ptr math
+	iterator end() noexcept { return mStorage.data() + mEnd; }     // NOLINT ptr math
+	[[nodiscard]] const_iterator begin() const noexcept
+	{
+		return mStorage.data() + mBegin; // NOLINT ptr math
+	}
+	[[nodiscard]] const_iterator end() const noexcept
+	{
+		return mStorage.data() + mEnd; // NOLINT ptr math
+	}
+
+	/// The number of events discarded because the list was full.
+	[[nodiscard]] UInt64 DroppedEventCount() const noexcept
+	{
+		return mDroppedEvents.load(std::memory_order_relaxed);
+	}
+	void ResetDroppedEventCount() noexcept { mDroppedEvents.store(0, std::memory_order_relaxed); }
+
+	/// The number of events which replaced an earlier event for the same parameter, under
+	/// EOverflowPolicy::CoalesceByParameter, because the list was full.
+	[[nodiscard]] UInt64 CoalescedEventCount() const noexcept
+	{
+		return mCoalescedEvents.load(std::memory_order_relaxed);
+	}
+	void ResetCoalescedEventCount() noexcept
+	{
+		mCoalescedEvents.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	static void Increment(std::atomic<UInt64>& ioCount) noexcept
+	{
+		ioCount.store(ioCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+	void CountDropped() noexcept { Increment(mDroppedEvents); }
+	void CountCoalesced() noexcept { Increment(mCoalescedEvents); }
+
+	// Twice the capacity, so that dropping the oldest event only moves the window forward;
+	// the window is moved back to the start when it reaches the end, at most once every
+	// mCapacity pushes.
+	std::vector<AudioUnitParameterEvent> mStorage;
+	UInt32 mCapacity{ 0 };
+	size_t mBegin{ 0 };
+	size_t mEnd{ 0 };
+	EOverflowPolicy mOverflowPolicy{ EOverflowPolicy::DropOldest };
+	std::atomic<UInt64> mDroppedEvents{ 0 };   // only written by the scheduling thread
+	std::atomic<UInt64> mCoalescedEvents{ 0 }; // likewise
+};
+
+} // namespace ausdk
+
+#endif // AudioUnitSDK_AUParameterEventList_h
@@ -0,0 +1,58 @@
+/*!
+	@file		AudioUnitSDK/AUParameterRamp.h
+	@copyright	© 2000-2023 Apple Inc. All rights reserved.
+*/
+#ifndef AudioUnitSDK_AUParameterRamp_h
+#define AudioUnitSDK_AUParameterRamp_h
+
+// clang-format off
+#include <AudioUnitSDK/AUConfig.h> // must come first
+// clang-format on
+
+#include <AudioToolbox/AUComponent.h>
+
+namespace ausdk {
+
+/*!
+	@class	AUParameterRamp
+	@brief	The state of one parameter's ramp through the buffer being rendered.
+
+	Frames are counted from the start of the buffer, as in AudioUnitParameterEvent. Before the
+	ramp the value is its start value, after it the end value.
+*/
+class AUParameterRamp {
+public:
+	enum class ECurve : UInt8 {
+		Linear,     ///< equal steps in value
+		Exponential ///< equal ratios; linear when the end values are zero or differ in sign
+	};
+
+	[[nodiscard]] ECurve GetCurve() const noexcept { return mCurve; }
+	void SetCurve(ECurve inCurve) noexcept { mCurve = inCurve; }
+
+	/// Starts the ramp described by a kParameterEvent_Ramped event.
+	void Start(const AudioUnitParameterEvent& inEvent) noexcept;
+	void Stop() noexcept { mActive = false; }
+	[[nodiscard]] bool IsActive() const noexcept { return mActive; }
+
+	[[nodiscard]] AudioUnitParameterValue ValueAt(SInt64 inFrame) const noexcept;
+
+	/// Writes the values at inCount frames, inFrameStep apart, the first at inFirstFrame: the
+	/// per-sample values of a slice with a step of 1, or one value per block.
+	void Fill(AudioUnitParameterValue* outValues, UInt32 inCount, SInt64 inFirstFrame,
+		UInt32 inFrameStep = 1) const noexcept;
+
+private:
+	[[nodiscard]] bool IsExponential() const noexcept;
+
+	AudioUnitParameterValue mStartValue{};
+	AudioUnitParameterValue mEndValue{};
+	SInt64 mStartFrame{};
+	UInt32 mDuration{};
+	ECurve mCurve{ ECurve::Linear };
+	bool mActive{ false };
+};
+
+} // namespace ausdk
+
+#endif // AudioUnitSDK_AUParameterRamp_h
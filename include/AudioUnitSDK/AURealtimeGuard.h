@@ -0,0 +1,109 @@
+/*!
+	@file		AudioUnitSDK/AURealtimeGuard.h
+	@copyright	© 2000-2023 Apple Inc. All rights reserved.
+*/
+#ifndef AudioUnitSDK_AURealtimeGuard_h
+#define AudioUnitSDK_AURealtimeGuard_h
+
+// clang-format off
+#include <AudioUnitSDK/AUConfig.h> // must come first
+// clang-format on
+
+#include <MacTypes.h>
+
+#include <array>
+#include <cstddef>
+
+namespace ausdk {
+
+/*!
+	@class	AURealtimeGuard
+	@brief	Marks the current thread as rendering for the guard's lifetime.
+
+	AUBase places one around DoRender, DoProcess and DoProcessMultiple. When AUSDK_REALTIME_GUARD
+	is nonzero, calls which are not real-time safe made while any guard is alive on the thread
+	are counted per render, and their call stacks recorded. Such builds replace the global
+	operator new and delete; on glibc hosts they also interpose malloc, calloc, realloc, free,
+	aligned_alloc, posix_memalign, pthread_mutex_lock, read, write and nanosleep, so that
+	violations in system libraries and plug-in code are caught too. Not for use with sanitizers,
+	which interpose the same functions.
+
+	When AUSDK_REALTIME_GUARD is zero, guards cost nothing and the statistics stay empty.
+*/
+class AURealtimeGuard {
+public:
+	enum class EViolation : UInt8 { Allocation, Deallocation, Lock, SystemCall };
+
+	static constexpr bool kEnabled = AUSDK_REALTIME_GUARD != 0;
+	static constexpr size_t kMaximumFrames = 32;
+	static constexpr size_t kMaximumViolations = 64; ///< the most recent are kept
+
+	struct Violation {
+		EViolation mKind{};
+		UInt64 mRender{}; ///< Statistics::mRenders when the render began
+		UInt32 mFrameCount{};
+		std::array<void*, kMaximumFrames> mFrames{}; ///< return addresses, innermost first
+	};
+
+	struct Statistics {
+		UInt64 mRenders{};
+		UInt64 mViolatingRenders{};
+		UInt64 mViolations{};
+		UInt32 mLastRenderViolations{};
+		UInt32 mMaximumRenderViolations{};
+	};
+
+	/// Called on the offending thread for each violation, after it is recorded, e.g. to abort.
+	using ViolationHandler = void (*)(const Violation&);
+
+#if AUSDK_REALTIME_GUARD
+	AURealtimeGuard() noexcept;
+	~AURealtimeGuard() noexcept;
+#else
+	AURealtimeGuard() noexcept = default;
+	~AURealtimeGuard() noexcept = default;
+#endif
+
+	AURealtimeGuard(const AURealtimeGuard&) = delete;
+	AURealtimeGuard(AURealtimeGuard&&) = delete;
+	AURealtimeGuard& operator=(const AURealtimeGuard&) = delete;
+	AURealtimeGuard& operator=(AURealtimeGuard&&) = delete;
+
+	/// Records a violation if the thread is rendering. Plug-ins can call this from their own
+	/// wrappers of unsafe APIs.
+	static void Report(EViolation inKind) noexcept;
+
+	[[nodiscard]] static Statistics GetStatistics() noexcept;
+	static void ResetStatistics() noexcept;
+
+	/// Copies up to inCapacity of the most recent violations, oldest first; returns the number
+	/// copied.
+	static size_t CopyViolations(Violation* outViolations, size_t inCapacity) noexcept;
+
+	static void SetViolationHandler(ViolationHandler inHandler) noexcept;
+
+	/*!
+		@class	Suspension
+		@brief	Permits violations on the current thread for its lifetime, e.g. around a
+				deliberate, bounded allocation.
+	*/
+	class Suspension {
+	public:
+#if AUSDK_REALTIME_GUARD
+		Suspension() noexcept;
+		~Suspension() noexcept;
+#else
+		Suspension() noexcept = default;
+		~Suspension() noexcept = default;
+#endif
+
+		Suspension(const Suspension&) = delete;
+		Suspension(Suspension&&) = delete;
+		Suspension& operator=(const Suspension&) = delete;
+		Suspension& operator=(Suspension&&) = delete;
+	};
+};
+
+} // namespace ausdk
+
+#endif // AudioUnitSDK_AURealtimeGuard_h
@@ -10,6 +10,8 @@
 #include <AudioUnitSDK/AUConfig.h> // must come first
 // clang-format on
 #include <AudioUnitSDK/AUBuffer.h>
+#include <AudioUnitSDK/AUFormatConversion.h>
+#include <AudioUnitSDK/AUParameterRamp.h>
 #include <AudioUnitSDK/AUUtility.h>
 #include <AudioUnitSDK/ComponentBase.h>
 
@@ -18,8 +20,12 @@
 
 // std
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <cstddef>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <utility>
 #include <vector>
 
@@ -153,14 +159,308 @@ public:
 	ItemProxy operator[](Key k) { return ItemProxy{ *this, k }; }
 };
 
+/// Counts a unit's renders, so that memory its render thread may be reading can be reclaimed
+/// once the render has ended. The count is odd while rendering.
+class AURenderEpoch {
+public:
+	/// Marks a render of the unit on the current thread for the scope's lifetime.
+	class Scope {
+	public:
+		explicit Scope(AURenderEpoch& inEpoch) noexcept;
+		~Scope();
+
+		/// Marks the current thread as helping a render of the unit in progress on another
+		/// thread, e.g. as a worker of AUWorkerPool; that render must outlast the scope.
+		[[nodiscard]] static Scope Join(const AURenderEpoch& inEpoch) noexcept
+		{
+			return Scope{ inEpoch, nullptr };
+		}
+
+		Scope(const Scope&) = delete;
+		Scope(Scope&&) = delete;
+		Scope& operator=(const Scope&) = delete;
+		Scope& operator=(Scope&&) = delete;
+
+	private:
+		friend class AURenderEpoch;
+
+		Scope(const AURenderEpoch& inEpoch, AURenderEpoch* inCounted) noexcept;
+
+		const AURenderEpoch& mEpoch;
+		const Scope* mOuter;     // the enclosing scope on this thread, e.g. of an upstream unit
+		AURenderEpoch* mCounted; // null if joining, or nested within a scope of the same unit
+	};
+
+	[[nodiscard]] UInt64 Get() const noexcept { return mCount.load(); }
+
+	/// True if no render which was in progress when the count was inCount is still running.
+	[[nodiscard]] bool HasPassed(UInt64 inCount) const noexcept
+	{
+		return (inCount & 1u) == 0 || Get() != inCount;
+	}
+
+	/// True within a Scope of this unit on the current thread.
+	[[nodiscard]] bool IsRenderingOnCurrentThread() const noexcept;
+
+private:
+	std::atomic<UInt64> mCount{ 0 };
+};
+
+/*!
+	@class	AUParameterTable
+	@brief	An element's parameter values, in slots which never move, and the catalog from
+			parameter ID to slot.
+
+	The values and ramps live in fixed-size segments, so that pointers to them stay valid as
+	parameters are added. The catalog and the directory of segments form an immutable snapshot;
+	adding a parameter while the unit may be rendering publishes a new snapshot, and frees the
+	previous one once no reader can hold it (read-copy-update). Lookups are wait-free: within
+	a render of the unit they load the snapshot, which is retired until the render has ended;
+	on other threads they also count themselves in and out. Additions are serialized, may block
+	briefly, and must not be made on the render thread.
+*/
+class AUParameterTable {
+public:
+	using Value = AtomicValue<AudioUnitParameterValue>;
+
+	static constexpr UInt32 kNoSlot = std::numeric_limits<UInt32>::max();
+
+	/// A parameter's value, with its flag in the word of change flags it shares with the
+	/// neighbouring slots.
+	class Entry {
+	public:
+		/// Invalid until assigned.
+		Entry() = default;
+
+		[[nodiscard]] bool IsValid() const noexcept { return mValue != nullptr; }
+		[[nodiscard]] Value& GetValue() const noexcept { return *mValue; }
+
+		/// Stores the value and flags the parameter for CollectChanged(). The flag is set
+		/// after the value, so a collector which sees it also sees the value.
+		void Store(AudioUnitParameterValue inValue) const noexcept
+		{
+			mValue->store(inValue, std::memory_order_release);
+			mChanged->fetch_or(mChangedBit, std::memory_order_release);
+		}
+
+	private:
+		friend class AUParameterTable;
+
+		Entry(Value& inValue, std::atomic<UInt64>& inChanged, UInt64 inChangedBit) noexcept
+			: mValue{ &inValue }, mChanged{ &inChanged }, mChangedBit{ inChangedBit }
+		{
+		}
+
+		Value* mValue{ nullptr };
+		std::atomic<UInt64>* mChanged{ nullptr };
+		UInt64 mChangedBit{ 0 };
+	};
+
+	explicit AUParameterTable(const AURenderEpoch& inRenderEpoch);
+	~AUParameterTable();
+
+	AUParameterTable(const AUParameterTable&) = delete;
+	AUParameterTable(AUParameterTable&&) = delete;
+	AUParameterTable& operator=(const AUParameterTable&) = delete;
+	AUParameterTable& operator=(AUParameterTable&&) = delete;
+
+	/// Holds parameters 0 to inCount - 1, in the slots of the same index, replacing any others.
+	/// Moves every parameter to new storage, so advances the layout.
+	void UseIndexed(UInt32 inCount);
+
+	/// Changes whenever parameters move to new storage, invalidating Entries taken before.
+	[[nodiscard]] UInt32 GetLayout() const noexcept
+	{
+		return mLayout.load(std::memory_order_acquire);
+	}
+
+	/// Adds a parameter with the given value, or sets it if present; returns its slot, or
+	/// kNoSlot if the table is indexed and has no such parameter.
+	/// inConcurrent: the table may be read meanwhile, i.e. the unit is initialized.
+	UInt32 Insert(AudioUnitParameterID inParamID, AudioUnitParameterValue inValue,
+		bool inConcurrent);
+
+	[[nodiscard]] bool IsIndexed() const noexcept;
+	[[nodiscard]] UInt32 Size() const noexcept;
+
+	/// Returns kNoSlot if there is no such parameter.
+	[[nodiscard]] UInt32 FindSlot(AudioUnitParameterID inParamID) const noexcept;
+	/// inSlot must have been returned by FindSlot() or Insert().
+	[[nodiscard]] Entry EntryAt(UInt32 inSlot) const noexcept;
+	/// Returns an invalid entry if there is no such parameter.
+	[[nodiscard]] Entry FindEntry(AudioUnitParameterID inParamID) const noexcept;
+	/// Return nullptr if there is no such parameter.
+	[[nodiscard]] AUParameterRamp* FindRamp(AudioUnitParameterID inParamID) const noexcept;
+
+	/// Looks up several parameters on one snapshot: calls inFunction(item, entry) for each of
+	/// inNumItems items, with the entry of the item's mParameterID, invalid if there is no such
+	/// parameter. inFunction must not add parameters.
+	template <typename Item, typename F>
+	void FindEntries(Item* inItems, UInt32 inNumItems, F&& inFunction) const
+	{
+		const Reader snapshot{ *this };
+		size_t hint = 0;
+		for (UInt32 i = 0; i < inNumItems; ++i) {
+			Item& item = inItems[i]; // NOLINT subscript
+			const UInt32 slot = snapshot->FindFrom(item.mParameterID, hint);
+			inFunction(item, slot != kNoSlot ? snapshot->EntryAt(slot) : Entry{});
+		}
+	}
+
+	/// Appends to outParamIDs the parameters stored through an Entry since the last call, in
+	/// order of slot, and clears their flags. Costs one atomic exchange per 64 parameters.
+	void CollectChanged(std::vector<AudioUnitParameterID>& outParamIDs) const;
+
+	/// Calls inFunction(paramID, value, ramp) for each parameter, in order of ID, on one
+	/// snapshot. inFunction must not add parameters.
+	template <typename F>
+	void ForEach(F&& inFunction) const
+	{
+		const Reader snapshot{ *this };
+		if (snapshot->mIndexed) {
+			for (UInt32 slot = 0; slot < snapshot->mSize; ++slot) {
+				inFunction(AudioUnitParameterID{ slot }, snapshot->ValueAt(slot),
+					snapshot->RampAt(slot));
+			}
+			return;
+		}
+		for (const auto& [paramID, slot] : snapshot->mSlots) {
+			inFunction(paramID, snapshot->ValueAt(slot), snapshot->RampAt(slot));
+		}
+	}
+
+	/// The number of replaced snapshots kept because a render which may hold them was in
+	/// progress; each is freed by the first addition after that render ends. For diagnostics.
+	[[nodiscard]] size_t RetiredSnapshotCount() const;
+
+private:
+	static constexpr UInt32 kSlotsPerSegment = 64;
+
+	struct alignas(64) Segment {
+		std::array<Value, kSlotsPerSegment> mValues{};
+		std::atomic<UInt64> mChanged{ 0 }; // a bit per slot
+		std::array<AudioUnitParameterID, kSlotsPerSegment> mParamIDs{};
+		std::array<AUParameterRamp, kSlotsPerSegment> mRamps{};
+	};
+
+	// Immutable once published.
+	struct Snapshot {
+		flat_map<AudioUnitParameterID, UInt32> mSlots; // empty when indexed
+		std::vector<Segment*> mSegments;
+		UInt32 mSize{ 0 };
+		bool mIndexed{ false };
+
+		[[nodiscard]] UInt32 Find(AudioUnitParameterID inParamID) const noexcept;
+		// Like Find(), but searches onwards from ioHint, the catalog position of the previous
+		// lookup, so that lookups in ascending order of ID walk the catalog once.
+		[[nodiscard]] UInt32 FindFrom(
+			AudioUnitParameterID inParamID, size_t& ioHint) const noexcept;
+		[[nodiscard]] Value& ValueAt(UInt32 inSlot) const noexcept
+		{
+			return mSegments[inSlot / kSlotsPerSegment]->mValues[inSlot % kSlotsPerSegment];
+		}
+		[[nodiscard]] AUParameterRamp& RampAt(UInt32 inSlot) const noexcept
+		{
+			return mSegments[inSlot / kSlotsPerSegment]->mRamps[inSlot % kSlotsPerSegment];
+		}
+		[[nodiscard]] Entry EntryAt(UInt32 inSlot) const noexcept
+		{
+			Segment& segment = *mSegments[inSlot / kSlotsPerSegment];
+			const UInt32 index = inSlot % kSlotsPerSegment;
+			return { segment.mValues[index], segment.mChanged, UInt64{ 1 } << index };
+		}
+	};
+
+	// Pins the current snapshot for its lifetime.
+	class Reader {
+	public:
+		explicit Reader(const AUParameterTable& inTable) noexcept;
+		~Reader();
+
+		Reader(const Reader&) = delete;
+		Reader(Reader&&) = delete;
+		Reader& operator=(const Reader&) = delete;
+		Reader& operator=(Reader&&) = delete;
+
+		const Snapshot* operator->() const noexcept { return mSnapshot; }
+
+	private:
+		static constexpr UInt32 kRenderThread = std::numeric_limits<UInt32>::max();
+
+		const AUParameterTable& mTable;
+		UInt32 mPhase;
+		const Snapshot* mSnapshot;
+	};
+
+	struct Retired {
+		std::unique_ptr<Snapshot> mSnapshot;
+		UInt64 mRenderEpoch;
+	};
+
+	// Both called with mWriterMutex held.
+	void Publish(std::unique_ptr<Snapshot> inSnapshot);
+	void ReclaimRetired();
+
+	const AURenderEpoch& mRenderEpoch;
+	std::atomic<Snapshot*> mCurrent;
+	// Readers off the render thread, counted under the phase in which they began.
+	mutable std::array<std::atomic<UInt32>, 2> mReaders{};
+	std::atomic<UInt32> mReaderPhase{ 0 };
+	std::atomic<UInt32> mLayout{ 0 };
+
+	mutable std::mutex mWriterMutex;
+	std::vector<std::unique_ptr<Segment>> mSegments;
+	std::vector<Retired> mRetired; // snapshots the render thread may still hold
+};
+
 // ____________________________________________________________________________
 //
 class AUIOElement;
 
+/// A parameter and its value, for getting and setting many at once; see AUBase::GetParameters().
+struct AUParameterItem {
+	AudioUnitScope mScope{};
+	AudioUnitElement mElement{};
+	AudioUnitParameterID mParameterID{};
+	AudioUnitParameterValue mValue{};
+};
+
+/// A parameter resolved to its storage by AUElement::GetParameterHandle(), so that reading it
+/// on the render thread is one relaxed load rather than a lookup. The handle goes stale when
+/// the element's parameters move, i.e. on UseIndexedParameters(); see
+/// AUElement::IsParameterHandleCurrent().
+class AUParameterHandle {
+public:
+	/// Invalid until assigned.
+	AUParameterHandle() = default;
+
+	[[nodiscard]] bool IsValid() const noexcept { return mEntry.IsValid(); }
+
+	/// The parameter's slot in its element's AUParameterTable.
+	[[nodiscard]] UInt32 GetSlot() const noexcept { return mSlot; }
+
+	[[nodiscard]] AudioUnitParameterValue Get() const noexcept
+	{
+		return mEntry.GetValue().load(std::memory_order_relaxed);
+	}
+
+private:
+	friend class AUElement;
+
+	AUParameterHandle(AUParameterTable::Entry inEntry, UInt32 inSlot, UInt32 inLayout) noexcept
+		: mEntry{ inEntry }, mSlot{ inSlot }, mLayout{ inLayout }
+	{
+	}
+
+	AUParameterTable::Entry mEntry;
+	UInt32 mSlot{ 0 };
+	UInt32 mLayout{ 0 };
+};
+
 /// An organizational unit for parameters, with a name.
 class AUElement {
 public:
-	explicit AUElement(AUBase& audioUnit) : mAudioUnit(audioUnit), mUseIndexedParameters(false) {}
+	explicit AUElement(AUBase& audioUnit);
 
 	AUSDK_DEPRECATED("Construct with a reference")
 	explicit AUElement(AUBase* audioUnit) : AUElement(*audioUnit) {}
@@ -172,28 +472,85 @@ public:
 
 	virtual ~AUElement() = default;
 
-	virtual UInt32 GetNumberOfParameters()
-	{
-		return mUseIndexedParameters ? static_cast<UInt32>(mIndexedParameters.size())
-									 : static_cast<UInt32>(mParameters.size());
-	}
+	virtual UInt32 GetNumberOfParameters() { return mParameters.Size(); }
 	virtual void GetParameterList(AudioUnitParameterID* outList);
 	[[nodiscard]] bool HasParameterID(AudioUnitParameterID paramID) const;
 	[[nodiscard]] AudioUnitParameterValue GetParameter(AudioUnitParameterID paramID) const;
 
-	// Only set okWhenInitialized to true when you know the outside world cannot access this
-	// element. Otherwise the parameter map could get corrupted.
+	/// Resolves a parameter to its slot once, e.g. when a kernel is created at Initialize(), for
+	/// reads without a lookup. Valid until UseIndexedParameters() is next called.
+	[[nodiscard]] AUParameterHandle GetParameterHandle(AudioUnitParameterID paramID) const;
+
+	/// False if inHandle is invalid or was taken before the element's parameters last moved;
+	/// take a new one with GetParameterHandle().
+	[[nodiscard]] bool IsParameterHandleCurrent(const AUParameterHandle& inHandle) const noexcept
+	{
+		return inHandle.IsValid() && inHandle.mLayout == mParameters.GetLayout();
+	}
+
+	/// The storage of a parameter's value, for readers which cache it to avoid the lookup, such
+	/// as AUSmoothedParameter. Valid until UseIndexedParameters() is next called.
+	[[nodiscard]] const AtomicValue<AudioUnitParameterValue>& GetParameterStorage(
+		AudioUnitParameterID paramID) const;
+
+	// Once the unit is initialized, an undefined parameter is ignored unless okWhenInitialized
+	// is true, in which case it is added without disturbing concurrent readers, including the
+	// render thread; notify the host with kAudioUnitProperty_ParameterList afterwards. Adding
+	// a parameter allocates, so never do it on the render thread.
 	void SetParameter(AudioUnitParameterID paramID, AudioUnitParameterValue value,
 		bool okWhenInitialized = false);
 
-	// Only set okWhenInitialized to true when you know the outside world cannot access this
-	// element. Otherwise the parameter map could get corrupted. N.B. This only handles
-	// immediate parameters. Override to implement ramping. Called from
-	// AUBase::ProcessForScheduledParams.
+	/// Gets the values of several of the element's parameters with one lookup of the table; the
+	/// items' scope and element are not examined. Throws kAudioUnitErr_InvalidParameter at the
+	/// first unknown parameter.
+	void GetParameters(AUParameterItem* ioItems, UInt32 inNumItems) const;
+
+	/// Sets several of the element's parameters, in order, as by SetParameter().
+	void SetParameters(const AUParameterItem* inItems, UInt32 inNumItems);
+
+	/// Appends to outParamIDs the parameters set since the last call, by SetParameter(),
+	/// SetParameters() or SetScheduledEvent(), once each, and forgets them; e.g. for a view
+	/// which polls for changes rather than reading every parameter. Cheap enough to call at the
+	/// display's refresh rate; reuse the vector to avoid allocating.
+	void CollectChangedParameters(std::vector<AudioUnitParameterID>& outParamIDs) const
+	{
+		mParameters.CollectChanged(outParamIDs);
+	}
+
+	/// Sets a parameter without a lookup. Returns false, setting nothing, if the handle is not
+	/// current.
+	bool SetParameter(const AUParameterHandle& inHandle, AudioUnitParameterValue value) noexcept
+	{
+		if (!IsParameterHandleCurrent(inHandle)) {
+			return false;
+		}
+		inHandle.mEntry.Store(value);
+		return true;
+	}
+
+	// See SetParameter() for okWhenInitialized. Called from
+	// AUBase::ProcessForScheduledParams. An immediate event sets the parameter and ends its
+	// ramp; a ramped event starts the parameter's ramp, and sets the parameter to the ramp's
+	// value at the end of the slice, so that GetParameter() gives block-rate DSP the target for
+	// the slice. Sample-accurate DSP reads the ramp with FillParameterValues().
 	virtual void SetScheduledEvent(AudioUnitParameterID paramID,
 		const AudioUnitParameterEvent& inEvent, UInt32 inSliceOffsetInBuffer,
 		UInt32 inSliceDurationFrames, bool okWhenInitialized = false);
 
+	/// Writes a parameter's values at inNumValues frames, inFrameStep apart, the first at
+	/// inStartFrame in the buffer being rendered: its ramp's values if it is ramping, else its
+	/// current value. A step of 1 gives per-sample values, a larger step one value per block.
+	void FillParameterValues(AudioUnitParameterID paramID, AudioUnitParameterValue* outValues,
+		UInt32 inNumValues, UInt32 inStartFrame, UInt32 inFrameStep = 1) const;
+
+	[[nodiscard]] bool IsParameterRamping(AudioUnitParameterID paramID) const;
+
+	/// The curve of the parameter's ramps; linear unless set.
+	void SetParameterRampCurve(AudioUnitParameterID paramID, AUParameterRamp::ECurve inCurve);
+
+	/// Ends the ramps started during the render; called by AUBase::ProcessForScheduledParams.
+	void EndParameterRamps() noexcept;
+
 	[[nodiscard]] AUBase& GetAudioUnit() const noexcept { return mAudioUnit; }
 
 	void SaveState(AudioUnitScope scope, CFMutableDataRef data);
@@ -209,12 +566,14 @@ public:
 	virtual AUIOElement* AsIOElement() { return nullptr; }
 
 private:
-	using ParameterValue = AtomicValue<float>;
+	// Throws kAudioUnitErr_InvalidParameter if the element has no such parameter.
+	[[nodiscard]] AUParameterTable::Entry GetEntry(AudioUnitParameterID paramID) const;
 
 	AUBase& mAudioUnit;
-	flat_map<AudioUnitParameterID, ParameterValue> mParameters;
-	bool mUseIndexedParameters;
-	std::vector<ParameterValue> mIndexedParameters;
+	// The values, in slots: the parameter's ID when indexed, else its order of definition. Each
+	// has a ramp, created with it so that starting a ramp never allocates.
+	AUParameterTable mParameters;
+	UInt32 mActiveRamps{ 0 };
 	Owned<CFStringRef> mElementName;
 };
 
@@ -244,10 +603,47 @@ public:
 
 	virtual OSStatus SetStreamFormat(const AudioStreamBasicDescription& format);
 
+	/// How the element's buffer memory is provided.
+	enum class EBufferAllocation {
+		/// The element owns its buffer (the default).
+		Private,
+		/// While rendering, the element borrows its buffer from the render thread's
+		/// AUScratchArena. A private buffer is still allocated, but only touched by a render
+		/// which finds no arena or an exhausted one, so that it does not fail; it is used
+		/// outright if the arenas reserved at AllocateBuffer() time are too small.
+		SharedScratch
+	};
+
+	[[nodiscard]] EBufferAllocation GetBufferAllocation() const noexcept
+	{
+		return mBufferAllocation;
+	}
+
+	/// True if the last AllocateBuffer() honoured EBufferAllocation::SharedScratch.
+	[[nodiscard]] bool UsesSharedScratch() const noexcept { return mScratchFrames > 0; }
+
+	/// The number of renders which used the private buffer because no arena had room, since
+	/// the buffer was allocated; nonzero means too few or too small arenas were reserved.
+	[[nodiscard]] UInt64 GetScratchFallbackCount() const noexcept
+	{
+		return mScratchFallbacks.load(std::memory_order_relaxed);
+	}
+
 	virtual void AllocateBuffer(UInt32 inFramesToAllocate = 0);
 
 	void DeallocateBuffer();
 
+	/// Makes the buffer memory, and any planar conversion buffer, resident; see
+	/// BufferAllocator::EPageTouchPolicy. AllocateBuffer() calls this on an initialized unit
+	/// when the policy is PrefaultOnInitialize. A SharedScratch fallback buffer is left alone.
+	void PrefaultBuffer() noexcept
+	{
+		if (!UsesSharedScratch()) {
+			mIOBuffer.PrefaultPages();
+		}
+		mPlanarBuffer.PrefaultPages();
+	}
+
 	/// Determines (via subclass override) whether the element's buffer list needs to be allocated.
 	[[nodiscard]] virtual bool NeedsBufferSpace() const = 0;
 
@@ -258,6 +654,9 @@ public:
 	AudioBufferList& PrepareBuffer(UInt32 nFrames)
 	{
 		if (mWillAllocate) {
+			if (UsesSharedScratch()) {
+				return PrepareScratchBuffer(nFrames);
+			}
 			return mIOBuffer.PrepareBuffer(mStreamFormat, nFrames);
 		}
 		Throw(kAudioUnitErr_InvalidPropertyValue);
@@ -272,16 +671,70 @@ public:
 	void InvalidateBufferList() { mIOBuffer.InvalidateBufferList(); }
 	[[nodiscard]] AudioBufferList& GetBufferList() const { return mIOBuffer.GetBufferList(); }
 
+	/// Enables a conversion stage which presents an interleaved or non-Float32 stream to kernels
+	/// as planar Float32 buffers, one channel per buffer (see FormatConversion::IsConvertible).
+	/// Inputs convert in AUInputElement::PullInput; outputs render into PreparePlanarBuffer() and
+	/// are converted by CommitPlanarBuffer(). Set before initialization.
+	void SetUsesPlanarConversion(bool inFlag) noexcept;
+
+	[[nodiscard]] bool UsesPlanarConversion() const noexcept { return mUsesPlanarConversion; }
+
+	/// True if the conversion stage is enabled and the current stream format needs it.
+	[[nodiscard]] bool ConvertsToPlanar() const noexcept { return mConvertsToPlanar; }
+
+	/// Dither used when an output converts to an integer stream format. Defaults to none.
+	void SetDither(FormatConversion::EDither inDither) noexcept { mDitherer.SetMode(inDither); }
+	[[nodiscard]] FormatConversion::EDither GetDither() const noexcept { return mDitherer.Mode(); }
+
+	/// The format of the planar buffer list: the stream format, unless ConvertsToPlanar().
+	[[nodiscard]] AudioStreamBasicDescription GetPlanarFormat() const noexcept;
+
+	/// The element's data with one channel per buffer; for an input, that most recently pulled.
+	[[nodiscard]] AudioBufferList& GetPlanarBufferList() const
+	{
+		return mConvertsToPlanar ? mPlanarBuffer.GetBufferList() : mIOBuffer.GetBufferList();
+	}
+
+	/// Converts the element's buffer list into the planar buffer list.
+	void ConvertToPlanar(UInt32 nFrames);
+
+	/// For an output: the buffers into which to render; CommitPlanarBuffer() then converts
+	/// them into the element's buffer list. Without conversion, the element's buffer list.
+	AudioBufferList& PreparePlanarBuffer(UInt32 nFrames);
+
+	/// Converts the buffers returned by PreparePlanarBuffer(), if any. Called by AUBase after
+	/// rendering an output bus.
+	void CommitPlanarBuffer();
+
 	[[nodiscard]] float* GetFloat32ChannelData(UInt32 ch)
 	{
+		if (mConvertsToPlanar) {
+			return static_cast<float*>(mPlanarBuffer.GetBufferList().mBuffers[ch].mData); // NOLINT
+		}
 		if (IsInterleaved()) {
 			return static_cast<float*>(mIOBuffer.GetBufferList().mBuffers[0].mData) + ch; // NOLINT
 		}
 		return static_cast<float*>(mIOBuffer.GetBufferList().mBuffers[ch].mData); // NOLINT
 	}
 
+	/// See AUBufferList::Silence().
+	void SilenceBufferList() { mIOBuffer.Silence(); }
+	void MarkBufferListModified() noexcept { mIOBuffer.MarkModified(); }
+	[[nodiscard]] bool IsBufferListKnownSilent() const noexcept
+	{
+		return mIOBuffer.IsKnownSilent();
+	}
+
 	void CopyBufferListTo(AudioBufferList& abl) const { mIOBuffer.CopyBufferListTo(abl); }
-	void CopyBufferContentsTo(AudioBufferList& abl) const { mIOBuffer.CopyBufferContentsTo(abl); }
+	size_t CopyBufferContentsTo(AudioBufferList& abl) const
+	{
+		return mIOBuffer.CopyBufferContentsTo(abl);
+	}
+	size_t CopyPlanarContentsTo(AudioBufferList& abl) const
+	{
+		return mConvertsToPlanar ? mPlanarBuffer.CopyBufferContentsTo(abl)
+								 : mIOBuffer.CopyBufferContentsTo(abl);
+	}
 	[[nodiscard]] bool IsInterleaved() const noexcept { return ASBD::IsInterleaved(mStreamFormat); }
 	[[nodiscard]] UInt32 NumberChannels() const noexcept { return mStreamFormat.mChannelsPerFrame; }
 	[[nodiscard]] UInt32 NumberInterleavedChannels() const noexcept
@@ -303,17 +756,35 @@ public:
 
 protected:
 	AUBufferList& IOBuffer() noexcept { return mIOBuffer; }
+
+	/// Only valid for buffers which are not referenced after the render call which prepared
+	/// them; subclasses expose it where that holds. Takes effect at the next AllocateBuffer().
+	void SetBufferAllocation(EBufferAllocation inAllocation) noexcept
+	{
+		mBufferAllocation = inAllocation;
+	}
+
 	void ForceSetAudioChannelLayout(const AudioChannelLayout& inLayout)
 	{
 		mChannelLayout = inLayout;
 	}
 
 private:
+	AudioBufferList& PrepareScratchBuffer(UInt32 nFrames);
+
 	AudioStreamBasicDescription mStreamFormat{};
 	AUChannelLayout mChannelLayout{};
 	AUBufferList mIOBuffer; // for input: input proc buffer, only allocated when needed
 							// for output: output cache, usually allocated early on
 	bool mWillAllocate{ false };
+	EBufferAllocation mBufferAllocation{ EBufferAllocation::Private };
+	bool mUsesPlanarConversion{ false };
+	bool mConvertsToPlanar{ false };
+	UInt32 mPlanarFramesPending{ 0 }; // nonzero between PreparePlanarBuffer and CommitPlanarBuffer
+	AUBufferList mPlanarBuffer;       // only allocated when converting
+	FormatConversion::Ditherer mDitherer;
+	UInt32 mScratchFrames{ 0 }; // nonzero when borrowing from the AUScratchArena
+	std::atomic<UInt64> mScratchFallbacks{ 0 }; // only written by the render thread
 };
 
 // ____________________________________________________________________________
@@ -44,6 +44,10 @@ public:
 
 	void Reset() { mResetTimer = true; }
 
+	/// Whether the input has been silent for at least the timeout limit: Process() leaves the
+	/// silence flag alone. Also true before anything has been processed.
+	[[nodiscard]] bool HasTimedOut() const noexcept { return !mResetTimer && mTimeoutCounter == 0; }
+
 private:
 	UInt32 mTimeoutCounter{ 0 };
 	bool mResetTimer{ false };
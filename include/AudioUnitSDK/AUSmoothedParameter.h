@@ -0,0 +1,89 @@
+/*!
+	@file		AudioUnitSDK/AUSmoothedParameter.h
+	@copyright	© 2000-2023 Apple Inc. All rights reserved.
+*/
+#ifndef AudioUnitSDK_AUSmoothedParameter_h
+#define AudioUnitSDK_AUSmoothedParameter_h
+
+// clang-format off
+#include <AudioUnitSDK/AUConfig.h> // must come first
+// clang-format on
+#include <AudioUnitSDK/AUScopeElement.h>
+
+#include <AudioToolbox/AUComponent.h>
+
+namespace ausdk {
+
+/*!
+	@class	AUSmoothedParameter
+	@brief	A parameter's value, read without a lookup, and smoothed towards it block by block.
+
+	Create one per parameter when the DSP object is created, e.g. with
+	AUKernelBase::MakeSmoothedParameter(), then call Process() or Advance() once per block on the
+	render thread. It refers to the element's storage, so it must not outlive the element, and
+	must be created after the element's parameters are defined.
+*/
+class AUSmoothedParameter {
+public:
+	enum class ESmoothing : UInt8 {
+		None,    ///< jumps to each new value
+		OnePole, ///< approaches each new value exponentially; the time constant is in frames
+		Linear   ///< moves to each new value at a constant rate, in the given number of frames
+	};
+
+	/// Unusable until assigned.
+	AUSmoothedParameter() = default;
+
+	AUSmoothedParameter(const AtomicValue<AudioUnitParameterValue>& inStorage,
+		ESmoothing inSmoothing, UInt32 inSmoothingFrames) noexcept;
+
+	AUSmoothedParameter(const AUElement& inElement, AudioUnitParameterID inParamID,
+		ESmoothing inSmoothing, UInt32 inSmoothingFrames)
+		: AUSmoothedParameter(
+			  inElement.GetParameterStorage(inParamID), inSmoothing, inSmoothingFrames)
+	{
+	}
+
+	void SetSmoothing(ESmoothing inSmoothing, UInt32 inSmoothingFrames) noexcept;
+	[[nodiscard]] ESmoothing GetSmoothing() const noexcept { return mSmoothing; }
+
+	/// The parameter's current value, towards which the smoothed value moves.
+	[[nodiscard]] AudioUnitParameterValue GetTarget() const noexcept
+	{
+		return mStorage->load(std::memory_order_relaxed);
+	}
+
+	/// The smoothed value at the end of the last block.
+	[[nodiscard]] AudioUnitParameterValue GetValue() const noexcept { return mValue; }
+
+	/// Jumps to the target, e.g. from AUKernelBase::Reset().
+	void Reset() noexcept;
+
+	/// Advances by inNumFrames, writing the smoothed value at each frame; returns the last.
+	AudioUnitParameterValue Process(
+		AudioUnitParameterValue* outValues, UInt32 inNumFrames) noexcept;
+
+	/// Advances by inNumFrames without the per-frame values, for block-rate DSP; returns the
+	/// value at the end of the block.
+	AudioUnitParameterValue Advance(UInt32 inNumFrames) noexcept;
+
+private:
+	// Begins a linear segment if the target has moved; returns the target.
+	AudioUnitParameterValue UpdateLinearTarget() noexcept;
+	// Moves along the linear segment by inRampFrames, which are within it.
+	void EndLinearSegment(UInt32 inRampFrames) noexcept;
+	[[nodiscard]] bool IsSettled(AudioUnitParameterValue inTarget) const noexcept;
+
+	const AtomicValue<AudioUnitParameterValue>* mStorage{ nullptr };
+	ESmoothing mSmoothing{ ESmoothing::None };
+	UInt32 mSmoothingFrames{ 0 };
+	float mPoleCoefficient{ 0.f }; // the fraction of the distance to the target left per frame
+	AudioUnitParameterValue mValue{};
+	AudioUnitParameterValue mLinearTarget{};
+	AudioUnitParameterValue mLinearStep{};
+	UInt32 mLinearFramesRemaining{ 0 };
+};
+
+} // namespace ausdk
+
+#endif // AudioUnitSDK_AUSmoothedParameter_h
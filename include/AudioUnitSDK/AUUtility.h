@@ -385,8 +385,68 @@ constexpr uint32_t IsBogusAudioBufferList(const AudioBufferList& abl)
 	return anyNull | (sum & ~1u);
 }
 
+/// True if every non-null buffer starts at a multiple of alignment (a power of 2).
+inline bool IsAligned(const AudioBufferList& abl, size_t alignment) noexcept
+{
+	const AudioBuffer *buf = abl.mBuffers, *const bufEnd = buf + abl.mNumberBuffers;
+	for (; buf < bufEnd; ++buf) {
+		if ((reinterpret_cast<uintptr_t>(buf->mData) & (alignment - 1)) != 0) { // NOLINT
+			return false;
+		}
+	}
+	return true;
+}
+
 } // namespace ABL
 
+// -------------------------------------------------------------------------------------------------
+#pragma mark -
+#pragma mark DenormalDisabler
+
+// Render calls, and the threads which help them (see AUWorkerPool), flush denormals to zero.
+#if TARGET_OS_MAC && (TARGET_CPU_X86 || TARGET_CPU_X86_64)
+
+class DenormalDisabler {
+public:
+	DenormalDisabler() noexcept : mSavedMXCSR(GetCSR()) { SetCSR(mSavedMXCSR | 0x8040); }
+
+	DenormalDisabler(const DenormalDisabler&) = delete;
+	DenormalDisabler(DenormalDisabler&&) = delete;
+	DenormalDisabler& operator=(const DenormalDisabler&) = delete;
+	DenormalDisabler& operator=(DenormalDisabler&&) = delete;
+
+	~DenormalDisabler() noexcept { SetCSR(mSavedMXCSR); }
+
+private:
+#if 0 // not sure if this is right: // #if __has_include(<xmmintrin.h>)
+	static unsigned GetCSR() noexcept { return _mm_getcsr(); }
+	static void SetCSR(unsigned x) noexcept { _mm_setcsr(x); }
+#else
+	// our compiler does ALL floating point with SSE
+	static unsigned GetCSR() noexcept
+	{
+		unsigned result{};
+		asm volatile("stmxcsr %0" : "=m"(*&result)); // NOLINT asm
+		return result;
+	}
+	static void SetCSR(unsigned a) noexcept
+	{
+		unsigned temp = a;
+		asm volatile("ldmxcsr %0" : : "m"(*&temp)); // NOLINT asm
+	}
+#endif
+
+	const unsigned mSavedMXCSR;
+};
+
+#else
+// while denormals can be flushed to zero on ARM processors, there is no performance benefit
+class DenormalDisabler {
+public:
+	DenormalDisabler() = default;
+};
+#endif // TARGET_OS_MAC && (TARGET_CPU_X86 || TARGET_CPU_X86_64)
+
 // -------------------------------------------------------------------------------------------------
 #pragma mark -
 #pragma mark HostTime
@@ -0,0 +1,101 @@
+/*!
+	@file		AudioUnitSDK/AUWorkerPool.h
+	@copyright	© 2000-2023 Apple Inc. All rights reserved.
+*/
+#ifndef AudioUnitSDK_AUWorkerPool_h
+#define AudioUnitSDK_AUWorkerPool_h
+
+// clang-format off
+#include <AudioUnitSDK/AUConfig.h> // must come first
+// clang-format on
+
+#include <mach/semaphore.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace ausdk {
+
+/*!
+	@class	AUWorkerPool
+	@brief	A fixed set of threads which help a render thread run a batch of independent tasks.
+
+	Run() is real-time safe: it neither allocates nor locks, and returns once every task has run
+	(a barrier). The calling thread takes part, so a batch has GetNumWorkers() + 1 participants.
+	Tasks are assigned deterministically: each participant runs a fixed, contiguous range of
+	them, so a given task runs on the same participant in every batch of the same size.
+
+	Given the render period, the workers run with the time-constraint (real-time) scheduling
+	policy for it, so that the render thread does not wait on lower-priority threads. Idle
+	workers spin briefly waiting for the next batch, then park on a semaphore. Starting a batch
+	while a worker is parked costs the caller one semaphore signal. Workers run each batch with
+	denormals disabled and a scratch arena, as a render call does.
+*/
+class AUWorkerPool {
+public:
+	using TaskFunction = void (*)(void* inContext, UInt32 inTask);
+
+	/// The number of times an idle worker checks for a new batch before parking, and the caller
+	/// checks for the workers to finish before yielding.
+	static constexpr UInt32 kSpinIterations = 256;
+
+	/// Starts inNumWorkers threads. If inPeriodSeconds, the time between render calls, is
+	/// nonzero, they are given the time-constraint policy for that period. Throws
+	/// kAudio_MemFullError, having stopped any workers it started, if a thread cannot be started.
+	explicit AUWorkerPool(UInt32 inNumWorkers, Float64 inPeriodSeconds = 0.0);
+
+	/// Stops and joins the workers. Must not be called during Run().
+	~AUWorkerPool();
+
+	AUWorkerPool(const AUWorkerPool&) = delete;
+	AUWorkerPool(AUWorkerPool&&) = delete;
+	AUWorkerPool& operator=(const AUWorkerPool&) = delete;
+	AUWorkerPool& operator=(AUWorkerPool&&) = delete;
+
+	[[nodiscard]] UInt32 GetNumWorkers() const noexcept
+	{
+		return static_cast<UInt32>(mThreads.size());
+	}
+
+	[[nodiscard]] Float64 GetPeriod() const noexcept { return mPeriodSeconds; }
+
+	/// Calls inFunction(inContext, task) for each task in [0, inNumTasks), across the calling
+	/// thread and the workers, and returns when all calls have returned. The function must not
+	/// throw. Only one thread may call Run() at a time.
+	void Run(UInt32 inNumTasks, TaskFunction inFunction, void* inContext) noexcept;
+
+	/// Calls inFunction(task) for each task in [0, inNumTasks).
+	template <typename F>
+	void Run(UInt32 inNumTasks, F& inFunction) noexcept
+	{
+		Run(
+			inNumTasks,
+			[](void* inContext, UInt32 inTask) { (*static_cast<F*>(inContext))(inTask); },
+			&inFunction);
+	}
+
+private:
+	// Stops and joins the workers, and destroys the semaphore.
+	void Stop() noexcept;
+	void WorkerMain(UInt32 inParticipant) noexcept;
+	void RunShare(UInt32 inParticipant) const noexcept;
+
+	std::vector<std::thread> mThreads;
+	const Float64 mPeriodSeconds;
+	semaphore_t mWakeSemaphore{}; // signalled once per parked worker to start a batch
+
+	// The batch being run; written by Run() before it advances mGeneration, and read by workers
+	// after they see the new generation.
+	TaskFunction mFunction{ nullptr };
+	void* mContext{ nullptr };
+	UInt32 mNumTasks{ 0 };
+
+	std::atomic<UInt32> mGeneration{ 0 }; // advanced to start each batch, and to stop
+	std::atomic<UInt32> mPending{ 0 };    // workers yet to finish the current batch
+	std::atomic<UInt32> mParked{ 0 };     // workers waiting on mWakeSemaphore
+	std::atomic<bool> mStopping{ false };
+};
+
+} // namespace ausdk
+
+#endif // AudioUnitSDK_AUWorkerPool_h
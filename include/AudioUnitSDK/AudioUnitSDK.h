@@ -10,17 +10,25 @@
 // clang-format on
 #include <AudioUnitSDK/AUBase.h>
 #include <AudioUnitSDK/AUBuffer.h>
+#include <AudioUnitSDK/AUChannelLanes.h>
 #include <AudioUnitSDK/AUEffectBase.h>
+#include <AudioUnitSDK/AUFixedEffect.h>
+#include <AudioUnitSDK/AUFormatConversion.h>
 #include <AudioUnitSDK/AUInputElement.h>
 #if AUSDK_HAVE_MIDI
 #include <AudioUnitSDK/AUMIDIBase.h>
 #include <AudioUnitSDK/AUMIDIEffectBase.h>
 #endif // AUSDK_HAVE_MIDI
 #include <AudioUnitSDK/AUOutputElement.h>
+#include <AudioUnitSDK/AUParameterEventList.h>
+#include <AudioUnitSDK/AUParameterRamp.h>
 #include <AudioUnitSDK/AUPlugInDispatch.h>
+#include <AudioUnitSDK/AURealtimeGuard.h>
 #include <AudioUnitSDK/AUScopeElement.h>
 #include <AudioUnitSDK/AUSilentTimeout.h>
+#include <AudioUnitSDK/AUSmoothedParameter.h>
 #include <AudioUnitSDK/AUUtility.h>
+#include <AudioUnitSDK/AUWorkerPool.h>
 #include <AudioUnitSDK/ComponentBase.h>
 #if AUSDK_HAVE_MUSIC_DEVICE
 #include <AudioUnitSDK/MusicDeviceBase.h>
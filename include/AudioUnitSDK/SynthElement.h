@@ -103,6 +103,11 @@ public:
 	virtual OSStatus Render(
 		SInt64 inAbsoluteSampleFrame, UInt32 inNumberFrames, ausdk::AUScope& outputs);
 
+	// Whether Render() will write to the outputs; consulted only when
+	// AUInstrumentBase::TracksSilentOutputs(). Override if Render() is overridden to produce
+	// output other than from sounding notes.
+	virtual bool HasSoundingNotes() const;
+
 	float GetPitchBend() const { return mMidiControlHandler->GetPitchBend(); }
 
 	SInt64 GetCurrentAbsoluteFrame() const { return mCurrentAbsoluteFrame; }
@@ -96,6 +96,10 @@ public:
 
 	Float32 GetGlobalParameter(AudioUnitParameterID inParamID) const;
 
+	// Resolves a global parameter once, e.g. in the note's constructor, so that reading it
+	// while rendering needs no lookup.
+	ausdk::AUParameterHandle GetGlobalParameterHandle(AudioUnitParameterID inParamID) const;
+
 	NoteInstanceID GetNoteID() const { return mNoteID; }
 
 	SynthNoteState GetState() const { return mState; }
@@ -6,61 +6,21 @@
 #include <AudioUnitSDK/AUConfig.h> // must come first
 // clang-format on
 #include <AudioUnitSDK/AUBase.h>
+#include <AudioUnitSDK/AUFormatConversion.h>
 #include <AudioUnitSDK/AUInputElement.h>
 #include <AudioUnitSDK/AUOutputElement.h>
+#include <AudioUnitSDK/AURealtimeGuard.h>
 #include <AudioUnitSDK/AUUtility.h>
 
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cmath>
 #include <cstring>
 #include <limits>
 
 namespace ausdk {
 
-#if TARGET_OS_MAC && (TARGET_CPU_X86 || TARGET_CPU_X86_64)
-
-class DenormalDisabler {
-public:
-	DenormalDisabler() noexcept : mSavedMXCSR(GetCSR()) { SetCSR(mSavedMXCSR | 0x8040); }
-
-	DenormalDisabler(const DenormalDisabler&) = delete;
-	DenormalDisabler(DenormalDisabler&&) = delete;
-	DenormalDisabler& operator=(const DenormalDisabler&) = delete;
-	DenormalDisabler& operator=(DenormalDisabler&&) = delete;
-
-	~DenormalDisabler() noexcept { SetCSR(mSavedMXCSR); }
-
-private:
-#if 0 // not sure if this is right: // #if __has_include(<xmmintrin.h>)
-	static unsigned GetCSR() noexcept { return _mm_getcsr(); }
-	static void SetCSR(unsigned x) noexcept { _mm_setcsr(x); }
-#else
-	// our compiler does ALL floating point with SSE
-	static unsigned GetCSR() noexcept
-	{
-		unsigned result{};
-		asm volatile("stmxcsr %0" : "=m"(*&result)); // NOLINT asm
-		return result;
-	}
-	static void SetCSR(unsigned a) noexcept
-	{
-		unsigned temp = a;
-		asm volatile("ldmxcsr %0" : : "m"(*&temp)); // NOLINT asm
-	}
-#endif
-
-	const unsigned mSavedMXCSR;
-};
-
-#else
-// while denormals can be flushed to zero on ARM processors, there is no performance benefit
-class DenormalDisabler {
-public:
-	DenormalDisabler() = default;
-};
-#endif
-
 static std::once_flag sAUBaseCFStringsInitialized{}; // NOLINT non-const global
 // this is used for the presets
 static CFStringRef kUntitledString = nullptr; // NOLINT non-const global
@@ -189,6 +149,20 @@ void AUBase::ReallocateBuffers()
 	mBuffersAllocated = true;
 }
 
+//_____________________________________________________________________________
+//
+void AUBase::PrefaultIOBuffers()
+{
+	const UInt32 nOutputs = Outputs().GetNumberOfElements();
+	for (UInt32 i = 0; i < nOutputs; ++i) {
+		Output(i).PrefaultBuffer();
+	}
+	const UInt32 nInputs = Inputs().GetNumberOfElements();
+	for (UInt32 i = 0; i < nInputs; ++i) {
+		Input(i).PrefaultBuffer();
+	}
+}
+
 //_____________________________________________________________________________
 //
 void AUBase::DeallocateIOBuffers()
@@ -215,10 +189,18 @@ OSStatus AUBase::DoInitialize()
 	if (!mInitialized) {
 		AUSDK_Require_noerr(Initialize());
 		if (CanScheduleParameters()) {
-			mParamEventList.reserve(24); // NOLINT magic #
+			if (mParamEventList.Capacity() != mParameterEventCapacity) {
+				mParamEventList.Reserve(mParameterEventCapacity);
+			}
+			mParamBreakpoints.reserve(2 * static_cast<size_t>(mParameterEventCapacity) + 1);
+			mActiveParamRamps.reserve(mParameterEventCapacity);
 		}
 		mHasBegunInitializing = true;
 		ReallocateBuffers(); // calls CreateElements()
+		if (GetBufferAllocator().GetPageTouchPolicy() ==
+			BufferAllocator::EPageTouchPolicy::PrefaultOnInitialize) {
+			PrefaultIOBuffers();
+		}
 		mInitialized = true; // signal that it's okay to render
 		std::atomic_thread_fence(std::memory_order_seq_cst);
 	}
@@ -1031,12 +1013,77 @@ OSStatus AUBase::SetParameter(AudioUnitParameterID inID, AudioUnitScope inScope,
 	return noErr;
 }
 
+//_____________________________________________________________________________
+//
+//	Calls inFunction(element, firstItem, numItems) for each run of items which address the same
+//	element.
+//
+template <typename Item, typename F>
+void ForEachElementRun(AUBase& inUnit, Item* inItems, UInt32 inNumItems, F&& inFunction)
+{
+	const auto sameElement = [](const Item& a, const Item& b) {
+		return a.mScope == b.mScope && a.mElement == b.mElement;
+	};
+	UInt32 runStart = 0;
+	while (runStart < inNumItems) {
+		Item* const first = &inItems[runStart]; // NOLINT subscript
+		UInt32 runEnd = runStart + 1;
+		while (runEnd < inNumItems && sameElement(inItems[runEnd], *first)) { // NOLINT subscript
+			++runEnd;
+		}
+		inFunction(inUnit.Element(first->mScope, first->mElement), first, runEnd - runStart);
+		runStart = runEnd;
+	}
+}
+
+//_____________________________________________________________________________
+//
+OSStatus AUBase::GetParameters(AUParameterItem* ioItems, UInt32 inNumItems)
+{
+	AUSDK_Require(ioItems != nullptr || inNumItems == 0, kAudio_ParamError);
+	OSStatus result = noErr;
+	try {
+		const AUEntryGuard guard(mAUMutex);
+		ForEachElementRun(*this, ioItems, inNumItems,
+			[](const AUElement& element, AUParameterItem* items, UInt32 numItems) {
+				element.GetParameters(items, numItems);
+			});
+	}
+	AUSDK_Catch(result)
+	return result;
+}
+
+//_____________________________________________________________________________
+//
+OSStatus AUBase::SetParameters(const AUParameterItem* inItems, UInt32 inNumItems)
+{
+	AUSDK_Require(inItems != nullptr || inNumItems == 0, kAudio_ParamError);
+	// as AUMethodSetParameter does, reject values which are not finite
+	const auto* const end = inItems + inNumItems; // NOLINT ptr math
+	const auto* const firstInvalid = std::find_if(inItems, end,
+		[](const AUParameterItem& item) { return !std::isfinite(item.mValue); });
+	OSStatus result = noErr;
+	try {
+		const AUEntryGuard guard(mAUMutex);
+		ForEachElementRun(*this, inItems, static_cast<UInt32>(firstInvalid - inItems),
+			[](AUElement& element, const AUParameterItem* items, UInt32 numItems) {
+				element.SetParameters(items, numItems);
+			});
+	}
+	AUSDK_Catch(result)
+	if (result == noErr && firstInvalid != end) {
+		result = kAudioUnitErr_InvalidParameterValue;
+	}
+	return result;
+}
+
 //_____________________________________________________________________________
 //
 OSStatus AUBase::ScheduleParameter(
 	const AudioUnitParameterEvent* inParameterEvent, UInt32 inNumEvents)
 {
 	const bool canScheduleParameters = CanScheduleParameters();
+	OSStatus result = noErr;
 
 	for (UInt32 i = 0; i < inNumEvents; ++i) {
 		const auto& pe = inParameterEvent[i]; // NOLINT subscript
@@ -1046,11 +1093,32 @@ OSStatus AUBase::ScheduleParameter(
 				pe.eventValues.immediate.bufferOffset); // NOLINT union
 		}
 		if (canScheduleParameters) {
-			mParamEventList.push_back(pe);
+			if (const OSStatus err = mParamEventList.Push(pe); err != noErr) {
+				result = err;
+			}
 		}
 	}
 
-	return noErr;
+	return result;
+}
+
+// ____________________________________________________________________________
+//
+// ramp.startBufferOffset is signed
+constexpr SInt64 EventStartOffset(const AudioUnitParameterEvent& event) noexcept
+{
+	return event.eventType == kParameterEvent_Immediate
+			   ? static_cast<SInt64>(event.eventValues.immediate.bufferOffset) // NOLINT union
+			   : static_cast<SInt64>(event.eventValues.ramp.startBufferOffset); // NOLINT union
+}
+
+// ____________________________________________________________________________
+//
+constexpr SInt64 EventEndOffset(const AudioUnitParameterEvent& event) noexcept
+{
+	return event.eventType == kParameterEvent_Ramped
+			   ? EventStartOffset(event) + event.eventValues.ramp.durationInFrames // NOLINT union
+			   : EventStartOffset(event);
 }
 
 // ____________________________________________________________________________
@@ -1058,17 +1126,7 @@ OSStatus AUBase::ScheduleParameter(
 constexpr bool ParameterEventListSortPredicate(
 	const AudioUnitParameterEvent& ev1, const AudioUnitParameterEvent& ev2) noexcept
 {
-	// ramp.startBufferOffset is signed
-	const SInt32 offset1 =
-		ev1.eventType == kParameterEvent_Immediate
-			? static_cast<SInt32>(ev1.eventValues.immediate.bufferOffset) // NOLINT union
-			: ev1.eventValues.ramp.startBufferOffset;                     // NOLINT union
-	const SInt32 offset2 =
-		ev2.eventType == kParameterEvent_Immediate
-			? static_cast<SInt32>(ev2.eventValues.immediate.bufferOffset) // NOLINT union
-			: ev2.eventValues.ramp.startBufferOffset;                     // NOLINT union
-
-	return offset1 < offset2;
+	return EventStartOffset(ev1) < EventStartOffset(ev2);
 }
 
 
@@ -1077,83 +1135,87 @@ constexpr bool ParameterEventListSortPredicate(
 OSStatus AUBase::ProcessForScheduledParams(
 	ParameterEventList& inParamList, UInt32 inFramesToProcess, void* inUserData)
 {
-	OSStatus result = noErr;
-
-	UInt32 framesRemaining = inFramesToProcess;
-
-	UInt32 currentStartFrame = 0; // start of the whole buffer
-
+	if (inFramesToProcess == 0) {
+		return noErr;
+	}
 
 	// sort the ParameterEventList by startBufferOffset
 	std::sort(inParamList.begin(), inParamList.end(), ParameterEventListSortPredicate);
 
-	while (framesRemaining > 0) {
-		// first of all, go through the ramped automation events and find out where the next
-		// division of our whole buffer will be
-
-		UInt32 currentEndFrame = inFramesToProcess; // start out assuming we'll process all the way
-													// to the end of the buffer
-
-		// find the next break point
-		for (const auto& event : inParamList) {
-			SInt32 offset =
-				event.eventType == kParameterEvent_Immediate
-					? static_cast<SInt32>(event.eventValues.immediate.bufferOffset) // NOLINT
-					: event.eventValues.ramp.startBufferOffset;
-
-			if (offset > static_cast<SInt32>(currentStartFrame) &&
-				offset < static_cast<SInt32>(currentEndFrame)) {
-				currentEndFrame = static_cast<UInt32>(offset);
-				break;
-			}
+	// The buffer is divided at every event start and ramp end inside it (there may be gaps in
+	// the supplied ramp events), rounded down to the minimum slice length; or only at immediate
+	// events, if the elements' ramps are read sample-accurately. Collect them once, in order;
+	// the last slice ends at the end of the buffer.
+	auto& breakpoints = mParamBreakpoints;
+	breakpoints.clear();
+	const SInt64 quantum = std::max(mMinimumSliceFrames, 1u);
+	const auto addBreakpoint = [&](SInt64 offset) {
+		offset -= offset % quantum;
+		if (offset > 0 && offset < static_cast<SInt64>(inFramesToProcess)) {
+			breakpoints.push_back(static_cast<UInt32>(offset));
+		}
+	};
+	for (const auto& event : inParamList) {
+		if (event.eventType != kParameterEvent_Ramped) {
+			addBreakpoint(EventStartOffset(event));
+		} else if (mSplitsSlicesAtRamps) {
+			addBreakpoint(EventStartOffset(event));
+			addBreakpoint(EventEndOffset(event));
+		}
+	}
+	std::sort(breakpoints.begin(), breakpoints.end());
+	breakpoints.erase(std::unique(breakpoints.begin(), breakpoints.end()), breakpoints.end());
+	breakpoints.push_back(inFramesToProcess);
 
-			// consider ramp end to be a possible choice (there may be gaps in the supplied ramp
-			// events)
-			if (event.eventType == kParameterEvent_Ramped) {
-				offset = event.eventValues.ramp.startBufferOffset +
-						 static_cast<SInt32>(event.eventValues.ramp.durationInFrames); // NOLINT
+	// Ramps are dispatched to every slice they overlap; immediate events only to the slice which
+	// contains their offset, AUElement having kept their value since. nextEvent is the first
+	// event which has not started yet.
+	auto& activeRamps = mActiveParamRamps;
+	activeRamps.clear();
+	const AudioUnitParameterEvent* nextEvent = inParamList.begin();
 
-				if (offset > static_cast<SInt32>(currentStartFrame) &&
-					offset < static_cast<SInt32>(currentEndFrame)) {
-					currentEndFrame = static_cast<UInt32>(offset);
-				}
-			}
-		}
+	OSStatus result = noErr;
+	UInt32 currentStartFrame = 0; // start of the whole buffer
 
+	for (const UInt32 currentEndFrame : breakpoints) {
 		const UInt32 framesThisTime = currentEndFrame - currentStartFrame;
-
-		// next, setup the parameter maps to be current for the ramp parameters active during
-		// this time segment...
-
-		for (const auto& event : inParamList) {
-			bool eventFallsInSlice = false;
-
-			if (event.eventType == kParameterEvent_Ramped) {
-				const auto& ramp = event.eventValues.ramp;
-				eventFallsInSlice =
-					ramp.startBufferOffset < static_cast<SInt32>(currentEndFrame) &&
-					(ramp.startBufferOffset + static_cast<SInt32>(ramp.durationInFrames)) >
-						static_cast<SInt32>(currentStartFrame);
-			} else { /* kParameterEvent_Immediate */
-				// actually, for the same parameter, there may be future immediate events which
-				// override this one, but it's OK since the event list is sorted in time order,
-				// we're guaranteed to end up with the current one
-				eventFallsInSlice = event.eventValues.immediate.bufferOffset <= currentStartFrame;
+		const auto dispatch = [&](const AudioUnitParameterEvent& event) {
+			AUElement* const element = GetElement(event.scope, event.element);
+			if (element != nullptr) {
+				element->SetScheduledEvent(
+					event.parameter, event, currentStartFrame, framesThisTime);
 			}
-
-			if (eventFallsInSlice) {
-				AUElement* const element = GetElement(event.scope, event.element);
-
-				if (element != nullptr) {
-					element->SetScheduledEvent(event.parameter, event, currentStartFrame,
-						currentEndFrame - currentStartFrame);
+		};
+
+		// first, the ramps still running from earlier slices, then the events starting in this
+		// one. An immediate event ends the ramps of its parameter, so that a ramp it interrupted
+		// is not restarted over its value in the slices which follow.
+		std::erase_if(activeRamps, [&](const AudioUnitParameterEvent* ramp) {
+			return EventEndOffset(*ramp) <= static_cast<SInt64>(currentStartFrame);
+		});
+		for (const auto* ramp : activeRamps) {
+			dispatch(*ramp);
+		}
+		for (; nextEvent != inParamList.end() &&
+			   EventStartOffset(*nextEvent) < static_cast<SInt64>(currentEndFrame);
+			 ++nextEvent) {
+			if (nextEvent->eventType == kParameterEvent_Ramped) {
+				if (EventEndOffset(*nextEvent) <= static_cast<SInt64>(currentStartFrame)) {
+					continue; // ended before the buffer
 				}
+				activeRamps.push_back(nextEvent);
+			} else {
+				std::erase_if(activeRamps, [&](const AudioUnitParameterEvent* ramp) {
+					return ramp->parameter == nextEvent->parameter &&
+						   ramp->scope == nextEvent->scope && ramp->element == nextEvent->element;
+				});
 			}
+			dispatch(*nextEvent);
 		}
 
-
 		// Finally, actually do the processing for this slice.....
 
+		mCurrentSliceStartFrame = currentStartFrame;
 		result =
 			ProcessScheduledSlice(inUserData, currentStartFrame, framesThisTime, inFramesToProcess);
 
@@ -1161,9 +1223,19 @@ OSStatus AUBase::ProcessForScheduledParams(
 			break;
 		}
 
-		framesRemaining -= std::min(framesThisTime, framesRemaining);
 		currentStartFrame = currentEndFrame; // now start from where we left off last time
 	}
+	mCurrentSliceStartFrame = 0;
+
+	// the ramps were for this buffer only; the parameters keep their values at its end
+	for (const auto& event : inParamList) {
+		if (event.eventType == kParameterEvent_Ramped) {
+			AUElement* const element = GetElement(event.scope, event.element);
+			if (element != nullptr) {
+				element->EndParameterRamps();
+			}
+		}
+	}
 
 	return result;
 }
@@ -1190,6 +1262,43 @@ void AUBase::SetWantsRenderThreadID(bool inFlag)
 	};
 }
 
+//_____________________________________________________________________________
+//
+AUBase::OutputCopyStatistics AUBase::GetOutputCopyStatistics() const noexcept
+{
+	return { .mBusRenders = mBusRenders.load(std::memory_order_relaxed),
+		.mZeroCopyBusRenders = mZeroCopyBusRenders.load(std::memory_order_relaxed),
+		.mBytesCopied = mBytesCopied.load(std::memory_order_relaxed),
+		.mLastBytesCopied = mLastBytesCopied.load(std::memory_order_relaxed) };
+}
+
+//_____________________________________________________________________________
+//
+void AUBase::ResetOutputCopyStatistics() noexcept
+{
+	mBusRenders.store(0, std::memory_order_relaxed);
+	mZeroCopyBusRenders.store(0, std::memory_order_relaxed);
+	mBytesCopied.store(0, std::memory_order_relaxed);
+	mLastBytesCopied.store(0, std::memory_order_relaxed);
+}
+
+//_____________________________________________________________________________
+//
+// Busses which rendered into a caller's buffers in an earlier cycle must not render there again.
+void AUBase::PrepareOtherOutputs(const AUOutputElement& inRenderedInPlace, UInt32 inNumberFrames)
+{
+	const UInt32 numOutputs = Outputs().GetNumberOfElements();
+	for (UInt32 bus = 0; bus < numOutputs; ++bus) {
+		AUOutputElement& output = Output(bus);
+		if (&output != &inRenderedInPlace) {
+			output.SetRenderedInPlace(std::nullopt);
+			if (output.WillAllocateBuffer()) {
+				output.PrepareBuffer(inNumberFrames);
+			}
+		}
+	}
+}
+
 //_____________________________________________________________________________
 //
 OSStatus AUBase::DoRender(AudioUnitRenderActionFlags& ioActionFlags,
@@ -1205,6 +1314,9 @@ OSStatus AUBase::DoRender(AudioUnitRenderActionFlags& ioActionFlags,
 	OSStatus theError = noErr;
 
 	[[maybe_unused]] const DenormalDisabler denormalDisabler;
+	[[maybe_unused]] const AUScratchArena::Scope scratchScope;
+	[[maybe_unused]] const AURealtimeGuard realtimeGuard;
+	[[maybe_unused]] const AURenderEpoch::Scope renderEpochScope{ mRenderEpoch };
 
 	try {
 		AUSDK_Require(IsInitialized(), errorExit(kAudioUnitErr_Uninitialized));
@@ -1325,6 +1437,9 @@ OSStatus AUBase::DoProcess(AudioUnitRenderActionFlags& ioActionFlags,
 	OSStatus theError = noErr;
 
 	[[maybe_unused]] const DenormalDisabler denormalDisabler;
+	[[maybe_unused]] const AUScratchArena::Scope scratchScope;
+	[[maybe_unused]] const AURealtimeGuard realtimeGuard;
+	[[maybe_unused]] const AURenderEpoch::Scope renderEpochScope{ mRenderEpoch };
 
 	try {
 		if (CheckRenderArgs(ioActionFlags)) {
@@ -1402,6 +1517,9 @@ OSStatus AUBase::DoProcessMultiple(AudioUnitRenderActionFlags& ioActionFlags,
 	OSStatus theError = noErr;
 
 	[[maybe_unused]] const DenormalDisabler denormalDisabler;
+	[[maybe_unused]] const AUScratchArena::Scope scratchScope;
+	[[maybe_unused]] const AURealtimeGuard realtimeGuard;
+	[[maybe_unused]] const AURenderEpoch::Scope renderEpochScope{ mRenderEpoch };
 
 	try {
 		if (CheckRenderArgs(ioActionFlags)) {
@@ -1569,11 +1687,21 @@ UInt32 AUBase::SupportedNumChannels(const AUChannelInfo** /*outInfo*/) { return
 
 //_____________________________________________________________________________
 //
-bool AUBase::ValidFormat(AudioUnitScope /*inScope*/, AudioUnitElement /*inElement*/,
+bool AUBase::ValidFormat(AudioUnitScope inScope, AudioUnitElement inElement,
 	const AudioStreamBasicDescription& inNewFormat)
 {
-	return ASBD::IsCommonFloat32(inNewFormat) &&
-		   (!ASBD::IsInterleaved(inNewFormat) || inNewFormat.mChannelsPerFrame == 1);
+	if (ASBD::IsCommonFloat32(inNewFormat) &&
+		(!ASBD::IsInterleaved(inNewFormat) || inNewFormat.mChannelsPerFrame == 1)) {
+		return true;
+	}
+	// elements with a conversion stage present other formats to kernels as planar Float32
+	AUElement* const element =
+		(inScope == kAudioUnitScope_Input || inScope == kAudioUnitScope_Output)
+			? GetScope(inScope).GetElement(inElement)
+			: nullptr;
+	AUIOElement* const ioElement = element != nullptr ? element->AsIOElement() : nullptr;
+	return ioElement != nullptr && ioElement->UsesPlanarConversion() &&
+		   FormatConversion::IsConvertible(inNewFormat);
 }
 
 //_____________________________________________________________________________
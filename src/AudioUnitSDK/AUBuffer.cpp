@@ -7,7 +7,32 @@
 
 #include <AudioToolbox/AUComponent.h>
 
+#include <algorithm>
+#include <bit>
+#include <atomic>
 #include <cassert>
+#include <functional>
+#include <new>
+
+#if defined(__has_include) && __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#include <unistd.h>
+#define AUSDK_HAVE_MMAP 1
+#else
+#define AUSDK_HAVE_MMAP 0
+#endif
+
+#if defined(__linux__) && defined(__has_include) && __has_include(<linux/mempolicy.h>)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#define AUSDK_HAVE_NUMA_POLICY 1
+#else
+#define AUSDK_HAVE_NUMA_POLICY 0
+#endif
+
+#if defined(__APPLE__) && defined(__has_include) && __has_include(<mach/vm_statistics.h>)
+#include <mach/vm_statistics.h>
+#endif
 
 namespace ausdk {
 
@@ -41,50 +66,361 @@ static UInt32 SafeMultiplyAddUInt32(UInt32 a, UInt32 b, UInt32 c)
 	return a * b + c;
 }
 
-AllocatedBuffer* BufferAllocator::Allocate(
-	UInt32 numberBuffers, UInt32 maxBytesPerBuffer, UInt32 /*reservedFlags*/)
+static void CheckNumberOfBuffers(UInt32 numberBuffers)
 {
-	constexpr size_t kAlignment = 16;
 	constexpr size_t kMaxBufferListSize = 65536;
 
 	// Check for a reasonable number of buffers (obviate a more complicated check with offsetof).
 	if (numberBuffers > kMaxBufferListSize / sizeof(AudioBuffer)) {
 		throw std::out_of_range("AudioBuffers::Allocate: Too many buffers");
 	}
+}
 
-	maxBytesPerBuffer = RoundUpToMultipleOfPowerOf2(maxBytesPerBuffer, kAlignment);
-
-	const auto bufferDataSize = SafeMultiplyAddUInt32(numberBuffers, maxBytesPerBuffer, 0);
-	void* bufferData = nullptr;
-	if (bufferDataSize > 0) {
-		bufferData = malloc(bufferDataSize);
-		// don't use calloc(); it might not actually touch the memory and cause a VM fault later
-		memset(bufferData, 0, bufferDataSize);
-	}
-
-	const auto implSize = static_cast<uint32_t>(
+static UInt32 AllocatedBufferHeaderSize(UInt32 numberBuffers)
+{
+	return static_cast<uint32_t>(
 		offsetof(AllocatedBuffer, mAudioBufferList.mBuffers[std::max(UInt32(1), numberBuffers)]));
-	auto* const implMem = malloc(implSize);
+}
+
+static AllocatedBuffer* ConstructAllocatedBuffer(void* headerMem, UInt32 numberBuffers,
+	UInt32 maxBytesPerBuffer, UInt32 headerSize, UInt32 bufferDataSize, void* bufferData)
+{
 	auto* const allocatedBuffer =
-		new (implMem) AllocatedBuffer{ .mMaximumNumberBuffers = numberBuffers,
+		new (headerMem) AllocatedBuffer{ .mMaximumNumberBuffers = numberBuffers,
 			.mMaximumBytesPerBuffer = maxBytesPerBuffer,
-			.mHeaderSize = implSize,
+			.mHeaderSize = headerSize,
 			.mBufferDataSize = bufferDataSize,
 			.mBufferData = bufferData };
 	allocatedBuffer->mAudioBufferList.mNumberBuffers = numberBuffers;
 	return allocatedBuffer;
 }
 
+static size_t PageSize() noexcept
+{
+#if AUSDK_HAVE_MMAP
+	static const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return pageSize;
+#else
+	constexpr size_t kDefaultPageSize = 4096;
+	return kDefaultPageSize;
+#endif
+}
+
+#if AUSDK_HAVE_MMAP
+static size_t RoundUpToMultipleOf(size_t x, size_t y) noexcept { return (x + y - 1) / y * y; }
+
+// Returns an anonymous mapping of ordinary pages, which the system zero-fills on demand, or
+// nullptr. ioBytes is updated to the mapped length.
+static void* MapPages(size_t& ioBytes) noexcept
+{
+	const size_t length = RoundUpToMultipleOf(ioBytes, PageSize());
+	void* const region =
+		mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (region == MAP_FAILED) {
+		return nullptr;
+	}
+	ioBytes = length;
+	return region;
+}
+
+// Must precede the first touch of the pages. Failure leaves the default (local) policy.
+static void BindToNUMANode(
+	[[maybe_unused]] void* region, [[maybe_unused]] size_t length, [[maybe_unused]] int numaNode)
+{
+#if AUSDK_HAVE_NUMA_POLICY
+	constexpr int kMaxNodeMaskBits = 64;
+	if (numaNode >= 0 && numaNode < kMaxNodeMaskBits) {
+		const unsigned long nodeMask = 1ul << static_cast<unsigned>(numaNode);
+		syscall(SYS_mbind, region, length, MPOL_PREFERRED, &nodeMask, kMaxNodeMaskBits, 0);
+	}
+#endif
+}
+#endif // AUSDK_HAVE_MMAP
+
+void* BufferAllocator::MapLargePages([[maybe_unused]] size_t& ioBytes) noexcept
+{
+#if AUSDK_HAVE_MMAP && defined(__linux__)
+	// Explicit huge pages only succeed if the administrator has reserved a hugetlb pool;
+	// otherwise fall back to an ordinary mapping with a transparent huge page hint.
+	constexpr size_t kHugePageSize = 2u << 20u;
+	const size_t length = RoundUpToMultipleOf(ioBytes, kHugePageSize);
+	void* region = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0); // NOLINT
+	if (region == MAP_FAILED) {
+		region = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (region == MAP_FAILED) {
+			return nullptr;
+		}
+		madvise(region, length, MADV_HUGEPAGE);
+	}
+	ioBytes = length;
+	return region;
+#elif AUSDK_HAVE_MMAP && defined(VM_FLAGS_SUPERPAGE_SIZE_2MB)
+	// Superpages are only available on some architectures.
+	constexpr size_t kSuperpageSize = 2u << 20u;
+	const size_t length = RoundUpToMultipleOf(ioBytes, kSuperpageSize);
+	void* const region = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON,
+		VM_FLAGS_SUPERPAGE_SIZE_2MB, 0);
+	if (region == MAP_FAILED) {
+		return nullptr;
+	}
+	ioBytes = length;
+	return region;
+#else
+	return nullptr;
+#endif
+}
+
+int BufferAllocator::CurrentThreadNUMANode() noexcept
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+	unsigned cpu = 0;
+	unsigned node = 0;
+	if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+		return static_cast<int>(node);
+	}
+#endif
+	return kAnyNUMANode;
+}
+
+void BufferAllocator::SetBufferAlignment(UInt32 inAlignment)
+{
+	constexpr UInt32 kMinAlignment = 16;
+	constexpr UInt32 kMaxAlignment = 4096;
+	ausdk::ThrowExceptionIf(!std::has_single_bit(inAlignment) || inAlignment < kMinAlignment ||
+								inAlignment > kMaxAlignment,
+		kAudio_ParamError);
+	mBufferAlignment = inAlignment;
+}
+
+UInt32 BufferAllocator::BufferStride(UInt32 numberBuffers, UInt32 maxBytesPerBuffer) const
+{
+	constexpr UInt32 kCacheSetAliasingGranule = 1024;
+
+	auto stride = RoundUpToMultipleOfPowerOf2(maxBytesPerBuffer, mBufferAlignment);
+	if (numberBuffers > 1 && stride > 0 && (stride % kCacheSetAliasingGranule) == 0) {
+		stride += mBufferAlignment;
+	}
+	return stride;
+}
+
+void* BufferAllocator::AllocateZeroedRegion(size_t bytes)
+{
+	const bool eager = mPageTouchPolicy == EPageTouchPolicy::EagerZero;
+#if AUSDK_HAVE_MMAP
+	const bool largePages = mLargePageThreshold > 0 && bytes >= mLargePageThreshold;
+	if (largePages || (!eager && bytes >= PageSize())) {
+		size_t length = bytes;
+		void* region = largePages ? MapLargePages(length) : nullptr;
+		if (region == nullptr) {
+			length = bytes;
+			region = MapPages(length);
+		}
+		if (region != nullptr) {
+			BindToNUMANode(region, length, mPreferredNUMANode);
+			{
+				const std::lock_guard lock{ mMappedRegionsMutex };
+				mMappedRegions.emplace(
+					std::upper_bound(mMappedRegions.begin(), mMappedRegions.end(), region,
+						[](const void* address, const auto& mapped) {
+							return std::less<>{}(address, mapped.first);
+						}),
+					region, length);
+			}
+			if (eager) {
+				memset(region, 0, bytes);
+			}
+			return region;
+		}
+	}
+#endif
+	void* region = nullptr;
+	if (posix_memalign(&region, mBufferAlignment, bytes) != 0) {
+		ThrowBadAlloc();
+	}
+	// don't use calloc(); it might not actually touch the memory and cause a VM fault later
+	memset(region, 0, bytes);
+	return region;
+}
+
+void BufferAllocator::FreeRegion(void* region) noexcept
+{
+#if AUSDK_HAVE_MMAP
+	{
+		const std::lock_guard lock{ mMappedRegionsMutex };
+		const auto it = std::lower_bound(mMappedRegions.begin(), mMappedRegions.end(), region,
+			[](const auto& mapped, const void* address) {
+				return std::less<>{}(mapped.first, address);
+			});
+		if (it != mMappedRegions.end() && it->first == region) {
+			munmap(it->first, it->second);
+			mMappedRegions.erase(it);
+			return;
+		}
+	}
+#endif
+	free(region);
+}
+
+AllocatedBuffer* BufferAllocator::Allocate(
+	UInt32 numberBuffers, UInt32 maxBytesPerBuffer, UInt32 /*reservedFlags*/)
+{
+	CheckNumberOfBuffers(numberBuffers);
+
+	maxBytesPerBuffer = BufferStride(numberBuffers, maxBytesPerBuffer);
+
+	const auto bufferDataSize = SafeMultiplyAddUInt32(numberBuffers, maxBytesPerBuffer, 0);
+	void* bufferData = nullptr;
+	if (bufferDataSize > 0) {
+		bufferData = AllocateZeroedRegion(bufferDataSize);
+	}
+
+	const auto implSize = AllocatedBufferHeaderSize(numberBuffers);
+	auto* const implMem = malloc(implSize);
+	return ConstructAllocatedBuffer(
+		implMem, numberBuffers, maxBytesPerBuffer, implSize, bufferDataSize, bufferData);
+}
+
 void BufferAllocator::Deallocate(AllocatedBuffer* allocatedBuffer)
 {
 	if (allocatedBuffer->mBufferData != nullptr) {
-		free(allocatedBuffer->mBufferData);
+		FreeRegion(allocatedBuffer->mBufferData);
 	}
 	allocatedBuffer->~AllocatedBuffer();
 	free(allocatedBuffer);
 }
 
+//_____________________________________________________________________________
+//
+PooledBufferAllocator::~PooledBufferAllocator() { Trim(); }
 
+size_t PooledBufferAllocator::SizeClassIndex(size_t blockSize) noexcept
+{
+	const auto shift = std::max(static_cast<size_t>(std::bit_width(blockSize - 1)),
+		kMinSizeClassShift); // ceil(log2(blockSize))
+	return std::min(shift - kMinSizeClassShift, kNumSizeClasses);
+}
+
+AllocatedBuffer* PooledBufferAllocator::Allocate(
+	UInt32 numberBuffers, UInt32 maxBytesPerBuffer, UInt32 /*reservedFlags*/)
+{
+	CheckNumberOfBuffers(numberBuffers);
+
+	maxBytesPerBuffer = BufferStride(numberBuffers, maxBytesPerBuffer);
+
+	// The sample data follows the header in the same block.
+	const auto bufferDataSize = SafeMultiplyAddUInt32(numberBuffers, maxBytesPerBuffer, 0);
+	const auto headerSize = AllocatedBufferHeaderSize(numberBuffers);
+	const auto alignment = GetBufferAlignment();
+	const size_t dataOffset = RoundUpToMultipleOfPowerOf2(headerSize, alignment);
+	const size_t blockSize = bufferDataSize > 0 ? dataOffset + bufferDataSize : headerSize;
+	const size_t classIndex = SizeClassIndex(blockSize);
+	const bool pooled = classIndex < kNumSizeClasses;
+	const size_t classBytes = pooled ? SizeClassBytes(classIndex) : blockSize;
+
+	void* block = nullptr;
+	void* staleBlock = nullptr;
+	{
+		const std::lock_guard lock{ mMutex };
+		if (pooled && mFreeLists[classIndex] != nullptr) { // NOLINT index checked
+			FreeBlock* const freeBlock = mFreeLists[classIndex]; // NOLINT
+			mFreeLists[classIndex] = freeBlock->mNext;          // NOLINT
+			freeBlock->~FreeBlock();
+			--mStatistics.mBlocksCached;
+			mStatistics.mBytesCached -= classBytes;
+			if ((reinterpret_cast<uintptr_t>(freeBlock) & (alignment - 1)) == 0) { // NOLINT
+				block = freeBlock;
+				++mStatistics.mPoolHits;
+			} else {
+				staleBlock = freeBlock; // cached before the alignment was raised
+			}
+		}
+	}
+	if (staleBlock != nullptr) {
+		FreeRegion(staleBlock);
+	}
+	const bool recycled = block != nullptr;
+	if (!recycled) {
+		block = AllocateZeroedRegion(classBytes);
+	}
+
+	void* bufferData = nullptr;
+	if (bufferDataSize > 0) {
+		bufferData = static_cast<std::byte*>(block) + dataOffset; // NOLINT ptr math
+		if (recycled) {
+			memset(bufferData, 0, bufferDataSize);
+		}
+	}
+
+	{
+		const std::lock_guard lock{ mMutex };
+		++mStatistics.mAllocations;
+		++mStatistics.mBlocksInUse;
+		mStatistics.mBytesInUse += classBytes;
+		mStatistics.mBytesRequested += blockSize;
+	}
+	return ConstructAllocatedBuffer(
+		block, numberBuffers, maxBytesPerBuffer, headerSize, bufferDataSize, bufferData);
+}
+
+void PooledBufferAllocator::Deallocate(AllocatedBuffer* allocatedBuffer)
+{
+	const size_t blockSize =
+		allocatedBuffer->mBufferData != nullptr
+			? static_cast<size_t>(static_cast<std::byte*>(allocatedBuffer->mBufferData) -
+								  reinterpret_cast<std::byte*>(allocatedBuffer)) + // NOLINT
+				  allocatedBuffer->mBufferDataSize
+			: allocatedBuffer->mHeaderSize;
+	const size_t classIndex = SizeClassIndex(blockSize);
+	const bool pooled = classIndex < kNumSizeClasses;
+	const size_t classBytes = pooled ? SizeClassBytes(classIndex) : blockSize;
+
+	allocatedBuffer->~AllocatedBuffer();
+	void* const block = allocatedBuffer;
+
+	{
+		const std::lock_guard lock{ mMutex };
+		++mStatistics.mDeallocations;
+		--mStatistics.mBlocksInUse;
+		mStatistics.mBytesInUse -= classBytes;
+		mStatistics.mBytesRequested -= blockSize;
+		if (pooled) {
+			mFreeLists[classIndex] = new (block) FreeBlock{ mFreeLists[classIndex] }; // NOLINT
+			++mStatistics.mBlocksCached;
+			mStatistics.mBytesCached += classBytes;
+			return;
+		}
+	}
+	FreeRegion(block);
+}
+
+PooledBufferAllocator::Statistics PooledBufferAllocator::GetStatistics() const
+{
+	const std::lock_guard lock{ mMutex };
+	return mStatistics;
+}
+
+void PooledBufferAllocator::Trim()
+{
+	std::array<FreeBlock*, kNumSizeClasses> freeLists{};
+	{
+		const std::lock_guard lock{ mMutex };
+		std::swap(freeLists, mFreeLists);
+		mStatistics.mBlocksCached = 0;
+		mStatistics.mBytesCached = 0;
+	}
+	for (FreeBlock* freeBlock : freeLists) {
+		while (freeBlock != nullptr) {
+			FreeBlock* const next = freeBlock->mNext;
+			freeBlock->~FreeBlock();
+			FreeRegion(freeBlock);
+			freeBlock = next;
+		}
+	}
+}
+
+//_____________________________________________________________________________
+//
 AudioBufferList& AllocatedBuffer::Prepare(UInt32 channelsPerBuffer, UInt32 bytesPerBuffer)
 {
 	if (mAudioBufferList.mNumberBuffers > mMaximumNumberBuffers) {
@@ -124,6 +460,19 @@ AudioBufferList& AllocatedBuffer::PrepareNull(UInt32 channelsPerBuffer, UInt32 b
 	return mAudioBufferList;
 }
 
+void AUBufferList::PrefaultPages() noexcept
+{
+	if (mBuffers == nullptr || mBuffers->mBufferData == nullptr) {
+		return;
+	}
+	// The memory is zeroed, so writing zeros leaves the contents intact.
+	auto* const data = static_cast<volatile std::byte*>(mBuffers->mBufferData);
+	const size_t size = mBuffers->mBufferDataSize;
+	for (size_t offset = 0; offset < size; offset += PageSize()) {
+		data[offset] = std::byte{ 0 }; // NOLINT ptr math
+	}
+}
+
 AudioBufferList& AUBufferList::PrepareBuffer(
 	const AudioStreamBasicDescription& format, UInt32 nFrames)
 {
@@ -164,29 +513,328 @@ AudioBufferList& AUBufferList::PrepareNullBuffer(
 	return abl;
 }
 
-void AUBufferList::Allocate(const AudioStreamBasicDescription& format, UInt32 nFrames)
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_nontemporal_store)
+#define AUSDK_HAVE_NONTEMPORAL_STORE 1
+#endif
+#endif
+#if !defined(AUSDK_HAVE_NONTEMPORAL_STORE)
+#define AUSDK_HAVE_NONTEMPORAL_STORE 0
+#endif
+
+#if AUSDK_HAVE_NONTEMPORAL_STORE
+// Four 16-byte vectors per iteration fill one cache line, so that the write-combining buffers
+// flush whole lines.
+using StreamVector = float __attribute__((vector_size(16)));
+constexpr size_t kStreamVectorBytes = sizeof(StreamVector);
+constexpr size_t kStreamLineBytes = 64;
+
+// Copies inSize bytes (or zeroes them, when kZero) with non-temporal stores; the ranges must
+// not overlap. The caller must issue a fence before the data is read by another thread.
+template <bool kZero>
+void StreamBytes(std::byte* dest, const std::byte* src, size_t inSize) noexcept
 {
-	auto& alloc = BufferAllocator::instance();
-	if (mBuffers != nullptr) {
-		alloc.Deallocate(mBuffers);
+	const auto copyOrZero = [](std::byte* d, const std::byte* s, size_t n) {
+		if constexpr (kZero) {
+			memset(d, 0, n);
+		} else {
+			memcpy(d, s, n);
+		}
+	};
+
+	const size_t misalignment = reinterpret_cast<uintptr_t>(dest) & (kStreamVectorBytes - 1);
+	const size_t head = std::min(inSize, (kStreamVectorBytes - misalignment) % kStreamVectorBytes);
+	copyOrZero(dest, src, head);
+	dest += head; // NOLINT ptr math
+	if constexpr (!kZero) {
+		src += head; // NOLINT ptr math
+	}
+	const size_t size = inSize - head;
+	const size_t body = size & ~(kStreamLineBytes - 1);
+
+	for (size_t line = 0; line < body; line += kStreamLineBytes) {
+		for (size_t offset = line; offset < line + kStreamLineBytes; offset += kStreamVectorBytes) {
+			StreamVector v{};
+			if constexpr (!kZero) {
+				memcpy(&v, src + offset, kStreamVectorBytes); // NOLINT ptr math
+			}
+			__builtin_nontemporal_store(v, reinterpret_cast<StreamVector*>(dest + offset)); // NOLINT
+		}
+	}
+	copyOrZero(dest + body, kZero ? nullptr : src + body, size - body); // NOLINT ptr math
+}
+#endif // AUSDK_HAVE_NONTEMPORAL_STORE
+
+// Decided once per buffer list, since the cache pressure comes from the list as a whole.
+constexpr bool ShouldStream(size_t inTotalBytes) noexcept
+{
+	return AUSDK_HAVE_NONTEMPORAL_STORE && AUSDK_NONTEMPORAL_STORE_THRESHOLD > 0 &&
+		   inTotalBytes >= static_cast<size_t>(AUSDK_NONTEMPORAL_STORE_THRESHOLD);
+}
+
+// Non-temporal stores are weakly ordered; publish them before the buffers are handed on.
+inline void EndStreaming() noexcept { std::atomic_thread_fence(std::memory_order_seq_cst); }
+
+size_t AUBufferList::CopyBufferContentsTo(AudioBufferList& destabl) const
+{
+	ausdk::ThrowExceptionIf(mPtrState == EPtrState::Invalid, -1);
+	const auto& srcabl = mBuffers->mAudioBufferList;
+	if (srcabl.mNumberBuffers == 0) {
+		return 0;
+	}
+	// duplicate last source to additional outputs [4341137]
+	const auto sourceIndex = [&srcabl](UInt32 i) { return std::min(i, srcabl.mNumberBuffers - 1); };
+
+	size_t bytesToCopy = 0;
+	for (UInt32 i = 0; i < destabl.mNumberBuffers; ++i) {
+		const AudioBuffer& srcbuf = srcabl.mBuffers[sourceIndex(i)]; // NOLINT
+		if (destabl.mBuffers[i].mData != srcbuf.mData &&            // NOLINT
+			!IsKnownSilent(sourceIndex(i))) {
+			bytesToCopy += srcbuf.mDataByteSize;
+		}
+	}
+	const bool stream = ShouldStream(bytesToCopy);
+
+	for (UInt32 i = 0; i < destabl.mNumberBuffers; ++i) {
+		const AudioBuffer& srcbuf = srcabl.mBuffers[sourceIndex(i)]; // NOLINT
+		AudioBuffer& destbuf = destabl.mBuffers[i];                  // NOLINT
+		auto* const dest = static_cast<std::byte*>(destbuf.mData);
+		const auto* const src = static_cast<const std::byte*>(srcbuf.mData);
+		const size_t size = srcbuf.mDataByteSize;
+		if (dest != src) {
+			if (IsKnownSilent(sourceIndex(i))) {
+				// no need to read a buffer known to hold zeros
+				memset(dest, 0, size);
+			} else if (dest < src + size && src < dest + size) { // NOLINT ptr math
+				memmove(dest, src, size);
+			} else if (stream) {
+#if AUSDK_HAVE_NONTEMPORAL_STORE
+				StreamBytes<false>(dest, src, size);
+#endif
+			} else {
+				memcpy(dest, src, size);
+			}
+		}
+		destbuf.mDataByteSize = srcbuf.mDataByteSize;
+	}
+	if (stream) {
+		EndStreaming();
+	}
+	return bytesToCopy;
+}
+
+void AUBufferList::ZeroBuffer(AudioBufferList& abl)
+{
+	size_t totalBytes = 0;
+	for (UInt32 i = 0; i < abl.mNumberBuffers; ++i) {
+		totalBytes += abl.mBuffers[i].mDataByteSize; // NOLINT
+	}
+	const bool stream = ShouldStream(totalBytes);
+
+	for (UInt32 i = 0; i < abl.mNumberBuffers; ++i) {
+		AudioBuffer& buf = abl.mBuffers[i]; // NOLINT
+		if (stream) {
+#if AUSDK_HAVE_NONTEMPORAL_STORE
+			StreamBytes<true>(static_cast<std::byte*>(buf.mData), nullptr, buf.mDataByteSize);
+#endif
+		} else {
+			memset(buf.mData, 0, buf.mDataByteSize);
+		}
+	}
+	if (stream) {
+		EndStreaming();
+	}
+}
+
+const std::byte* AUBufferList::OwnBufferData(UInt32 index) const noexcept
+{
+	return static_cast<const std::byte*>(mBuffers->mBufferData) +
+		   static_cast<size_t>(index) * mBuffers->mMaximumBytesPerBuffer; // NOLINT ptr math
+}
+
+void AUBufferList::Silence()
+{
+	AudioBufferList& abl = GetBufferList();
+	if (mPtrState != EPtrState::ToMyMemory) {
+		ZeroBuffer(abl);
+		return;
 	}
+	for (UInt32 i = 0; i < abl.mNumberBuffers; ++i) {
+		AudioBuffer& buf = abl.mBuffers[i]; // NOLINT
+		if (buf.mData != OwnBufferData(i)) {
+			// the pointers have been moved, e.g. to process a slice; track nothing
+			memset(buf.mData, 0, buf.mDataByteSize);
+			mSilentBytes[i] = 0;
+		} else if (buf.mDataByteSize > mSilentBytes[i]) {
+			memset(static_cast<std::byte*>(buf.mData) + mSilentBytes[i], 0, // NOLINT ptr math
+				buf.mDataByteSize - mSilentBytes[i]);
+			mSilentBytes[i] = buf.mDataByteSize;
+		}
+	}
+}
+
+void AUBufferList::MarkModified() noexcept
+{
+	std::fill(mSilentBytes.begin(), mSilentBytes.end(), 0u);
+}
+
+void AUBufferList::MarkModified(UInt32 index) noexcept
+{
+	if (index < mSilentBytes.size()) {
+		mSilentBytes[index] = 0;
+	}
+}
+
+bool AUBufferList::IsKnownSilent(UInt32 index) const noexcept
+{
+	if (mPtrState != EPtrState::ToMyMemory || index >= mBuffers->mAudioBufferList.mNumberBuffers) {
+		return false;
+	}
+	const AudioBuffer& buf = mBuffers->mAudioBufferList.mBuffers[index]; // NOLINT
+	return buf.mData == OwnBufferData(index) && buf.mDataByteSize <= mSilentBytes[index];
+}
+
+bool AUBufferList::IsKnownSilent() const noexcept
+{
+	if (mPtrState != EPtrState::ToMyMemory) {
+		return false;
+	}
+	for (UInt32 i = 0; i < mBuffers->mAudioBufferList.mNumberBuffers; ++i) {
+		if (!IsKnownSilent(i)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void AUBufferList::Allocate(
+	const AudioStreamBasicDescription& format, UInt32 nFrames, BufferAllocator* allocator)
+{
+	Deallocate();
+	auto& alloc = allocator != nullptr ? *allocator : BufferAllocator::instance();
 	const uint32_t nstreams = ASBD::IsInterleaved(format) ? 1 : format.mChannelsPerFrame;
 	mBuffers = alloc.Allocate(nstreams, nFrames * format.mBytesPerFrame, 0u);
+	mAllocator = &alloc;
 	mAllocatedFrames = nFrames;
 	mAllocatedStreams = nstreams;
 	mPtrState = EPtrState::Invalid;
+	// the allocator's memory is not assumed to be zeroed
+	mSilentBytes.assign(nstreams, 0u);
 }
 
 void AUBufferList::Deallocate()
 {
 	if (mBuffers != nullptr) {
-		BufferAllocator::instance().Deallocate(mBuffers);
+		mAllocator->Deallocate(mBuffers);
 		mBuffers = nullptr;
+		mAllocator = nullptr;
 	}
 
 	mAllocatedFrames = 0;
 	mAllocatedStreams = 0;
 	mPtrState = EPtrState::Invalid;
+	mSilentBytes.clear();
+}
+
+//_____________________________________________________________________________
+//
+// The arena table is fixed-size so that render threads can scan it without locking. Slots are
+// only ever filled, never cleared.
+static std::array<std::atomic<AUScratchArena*>, AUScratchArena::kMaximumArenas> gScratchArenas{};
+static std::atomic<size_t> gScratchArenaCapacity{ 0 };
+static std::mutex gScratchArenaMutex;
+
+static thread_local AUScratchArena* tScratchArena = nullptr;
+static thread_local UInt32 tScratchScopeDepth = 0;
+
+AUScratchArena::AUScratchArena(size_t inCapacity)
+	: mStorage(static_cast<std::byte*>(::operator new(inCapacity, std::align_val_t{ kAlignment }))),
+	  mCapacity(inCapacity)
+{
+	// make the memory resident now rather than on first use by the render thread
+	memset(mStorage, 0, mCapacity);
+}
+
+void AUScratchArena::Reserve(size_t inBytesPerArena, UInt32 inNumberOfArenas)
+{
+	const std::lock_guard lock{ gScratchArenaMutex };
+
+	const size_t capacity = std::max(
+		gScratchArenaCapacity.load(std::memory_order_relaxed), AllocationSize(inBytesPerArena));
+	UInt32 usable = 0;
+	for (auto& slot : gScratchArenas) {
+		if (usable >= inNumberOfArenas) {
+			break;
+		}
+		auto* arena = slot.load(std::memory_order_relaxed);
+		if (arena == nullptr) {
+			arena = new AUScratchArena(capacity); // NOLINT owned by the table
+			slot.store(arena, std::memory_order_release);
+		}
+		if (arena->mCapacity >= capacity) {
+			++usable;
+		}
+	}
+	ThrowExceptionIf(usable < inNumberOfArenas, kAudio_MemFullError);
+	gScratchArenaCapacity.store(capacity, std::memory_order_release);
+}
+
+size_t AUScratchArena::Capacity() noexcept
+{
+	return gScratchArenaCapacity.load(std::memory_order_acquire);
+}
+
+AUScratchArena* AUScratchArena::Current() noexcept { return tScratchArena; }
+
+void* AUScratchArena::Allocate(size_t inBytes) noexcept
+{
+	const size_t size = AllocationSize(inBytes);
+	if (size > mCapacity - mUsed) {
+		return nullptr;
+	}
+	void* const result = mStorage + mUsed; // NOLINT ptr math
+	mUsed += size;
+	return result;
+}
+
+AUScratchArena* AUScratchArena::Claim() noexcept
+{
+	const size_t capacity = Capacity();
+	if (capacity == 0) {
+		return nullptr;
+	}
+	for (auto& slot : gScratchArenas) {
+		auto* const arena = slot.load(std::memory_order_acquire);
+		if (arena == nullptr) {
+			break;
+		}
+		if (arena->mCapacity < capacity || arena->mClaimed.load(std::memory_order_relaxed)) {
+			continue;
+		}
+		bool expected = false;
+		if (arena->mClaimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+			arena->mUsed = 0;
+			return arena;
+		}
+	}
+	return nullptr;
+}
+
+AUScratchArena::Scope::Scope() noexcept
+	: mArena(tScratchScopeDepth++ == 0 ? (tScratchArena = Claim()) : tScratchArena),
+	  mMark(mArena != nullptr ? mArena->mUsed : 0)
+{
+}
+
+AUScratchArena::Scope::~Scope() noexcept
+{
+	if (mArena != nullptr) {
+		mArena->mUsed = mMark;
+	}
+	if (--tScratchScopeDepth == 0 && tScratchArena != nullptr) {
+		tScratchArena->mClaimed.store(false, std::memory_order_release);
+		tScratchArena = nullptr;
+	}
 }
 
 } // namespace ausdk
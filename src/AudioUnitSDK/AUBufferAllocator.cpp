@@ -8,7 +8,11 @@ namespace ausdk {
 
 BufferAllocator& BufferAllocator::instance()
 {
+#if AUSDK_POOLED_BUFFER_ALLOCATOR
+	__attribute__((no_destroy)) static PooledBufferAllocator global;
+#else
 	__attribute__((no_destroy)) static BufferAllocator global;
+#endif
 	return global;
 }
 
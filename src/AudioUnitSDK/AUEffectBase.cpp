@@ -5,7 +5,9 @@
 #include <AudioUnitSDK/AUEffectBase.h>
 #include <AudioUnitSDK/AUUtility.h>
 
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
 
 /*
 	This class does not deal as well as it should with N-M effects...
@@ -17,6 +19,35 @@
 
 namespace ausdk {
 
+namespace {
+
+using CrossfadeVector = float __attribute__((vector_size(16)));
+constexpr UInt32 kCrossfadeVectorLanes = sizeof(CrossfadeVector) / sizeof(float);
+
+// Mixes inDry into ioWet, with the dry gain inDryGain + i * inDryStep at frame i, and the wet
+// gain its complement.
+void Crossfade(const Float32* inDry, Float32* ioWet, UInt32 inFrames, float inDryGain,
+	float inDryStep) noexcept
+{
+	UInt32 i = 0;
+	CrossfadeVector index{ 0.f, 1.f, 2.f, 3.f };
+	for (; i + kCrossfadeVectorLanes <= inFrames; i += kCrossfadeVectorLanes) {
+		CrossfadeVector dry;
+		CrossfadeVector wet;
+		memcpy(&dry, inDry + i, sizeof(dry)); // NOLINT ptr math
+		memcpy(&wet, ioWet + i, sizeof(wet)); // NOLINT ptr math
+		wet += (dry - wet) * (inDryGain + index * inDryStep);
+		memcpy(ioWet + i, &wet, sizeof(wet)); // NOLINT ptr math
+		index += static_cast<float>(kCrossfadeVectorLanes);
+	}
+	for (; i < inFrames; ++i) {
+		const float gain = inDryGain + static_cast<float>(i) * inDryStep;
+		ioWet[i] += (inDry[i] - ioWet[i]) * gain; // NOLINT ptr math
+	}
+}
+
+} // namespace
+
 //_____________________________________________________________________________
 //
 AUEffectBase::AUEffectBase(AudioComponentInstance audioUnit, bool inProcessesInPlace)
@@ -33,7 +64,10 @@ AUEffectBase::AUEffectBase(AudioComponentInstance audioUnit, bool inProcessesInP
 //
 void AUEffectBase::Cleanup()
 {
+	mKernelWorkers.reset();
 	mKernelList.clear();
+	mMultiChannelKernel.reset();
+	mBypassDryBuffer.Deallocate();
 	mMainOutput = nullptr;
 	mMainInput = nullptr;
 }
@@ -95,23 +129,42 @@ OSStatus AUEffectBase::Initialize()
 	mMainOutput = &Output(0);
 	mMainInput = &Input(0);
 
-	const AudioStreamBasicDescription format = GetStreamFormat(kAudioUnitScope_Output, 0);
-	mBytesPerFrame = format.mBytesPerFrame;
+	// the kernels see the planar format
+	mBytesPerFrame = mMainOutput->GetPlanarFormat().mBytesPerFrame;
+
+	mBypassFadeFrames = mBypassCrossfadeFrames;
+	mBypassFadePosition = IsBypassEffect() ? mBypassFadeFrames : 0;
+	if (mBypassFadeFrames > 0) {
+		// a crossfade in place needs a copy of the input
+		mBypassDryBuffer.Allocate(mMainInput->GetPlanarFormat(), GetMaxFramesPerSlice());
+	}
 
 	return noErr;
 }
 
 OSStatus AUEffectBase::Reset(AudioUnitScope inScope, AudioUnitElement inElement)
+{
+	ResetKernels();
+
+	return AUBase::Reset(inScope, inElement);
+}
+
+void AUEffectBase::ResetKernels()
 {
 	for (auto& kernel : mKernelList) {
 		if (kernel) {
 			kernel->Reset();
 		}
 	}
-
-	return AUBase::Reset(inScope, inElement);
+	if (mMultiChannelKernel) {
+		mMultiChannelKernel->Reset();
+	}
 }
 
+void AUEffectBase::WakeKernels() { ResetKernels(); }
+
+void AUEffectBase::BypassEnded() { Reset(kAudioUnitScope_Global, 0); }
+
 OSStatus AUEffectBase::GetPropertyInfo(AudioUnitPropertyID inID, AudioUnitScope inScope,
 	AudioUnitElement inElement, UInt32& outDataSize, bool& outWritable)
 {
@@ -157,13 +210,9 @@ OSStatus AUEffectBase::SetProperty(AudioUnitPropertyID inID, AudioUnitScope inSc
 		case kAudioUnitProperty_BypassEffect: {
 			AUSDK_Require(inDataSize >= sizeof(UInt32), kAudioUnitErr_InvalidPropertyValue);
 
+			// Render() picks up the change, and calls BypassEnded() when it processes again
 			const bool tempNewSetting = *static_cast<const UInt32*>(inData) != 0;
-			// we're changing the state of bypass
 			if (tempNewSetting != IsBypassEffect()) {
-				if (!tempNewSetting && IsBypassEffect() &&
-					IsInitialized()) { // turning bypass off and we're initialized
-					Reset(kAudioUnitScope_Global, 0);
-				}
 				SetBypassEffect(tempNewSetting);
 			}
 			return noErr;
@@ -181,6 +230,18 @@ OSStatus AUEffectBase::SetProperty(AudioUnitPropertyID inID, AudioUnitScope inSc
 
 void AUEffectBase::MaintainKernels()
 {
+	if (!mMultiChannelKernel) {
+		mMultiChannelKernel = NewMultiChannelKernel();
+	}
+	if (mMultiChannelKernel) {
+		mKernelList.clear();
+		const UInt32 nChannels = GetNumberOfChannels();
+		mMultiChannelKernel->SetNumberOfChannels(nChannels);
+		mKernelSources.assign(nChannels, nullptr);
+		mKernelDests.assign(nChannels, nullptr);
+		return;
+	}
+
 #if TARGET_OS_IPHONE
 	const UInt32 nKernels = mOnlyOneKernel ? 1 : GetNumberOfChannels();
 #else
@@ -203,6 +264,19 @@ void AUEffectBase::MaintainKernels()
 			mKernelList[i]->SetChannelNum(i);
 		}
 	}
+
+	// there's no use for more threads than kernels; the workers are scheduled for the longest
+	// render period
+	const UInt32 nWorkers = std::min(mKernelThreads, nKernels) - 1;
+	const Float64 period = static_cast<Float64>(GetMaxFramesPerSlice()) / GetSampleRate();
+	if (mKernelThreads <= 1 || nKernels <= 1) {
+		mKernelWorkers.reset();
+	} else if (!mKernelWorkers || mKernelWorkers->GetNumWorkers() != nWorkers ||
+			   mKernelWorkers->GetPeriod() != period) {
+		mKernelWorkers.reset();
+		mKernelWorkers = std::make_unique<AUWorkerPool>(nWorkers, period);
+	}
+	mKernelSilence.assign(nKernels, 0);
 }
 
 bool AUEffectBase::StreamFormatWritable(AudioUnitScope /*scope*/, AudioUnitElement /*element*/)
@@ -254,8 +328,17 @@ OSStatus AUEffectBase::ProcessScheduledSlice(void* inUserData, UInt32 /*inStartF
 			outputBufferList.mBuffers[i].mNumberChannels * channelSize; // NOLINT
 	}
 	// process the buffer
+#if AUSDK_HAVE_MACH_TIME
+	const uint64_t startTime = HostTime::Current();
+#endif
 	const OSStatus result =
 		ProcessBufferLists(actionFlags, inputBufferList, outputBufferList, inSliceFramesToProcess);
+#if AUSDK_HAVE_MACH_TIME
+	mSliceHostTime.store(mSliceHostTime.load(std::memory_order_relaxed) +
+							 (HostTime::Current() - startTime),
+		std::memory_order_relaxed);
+#endif
+	mSlices.store(mSlices.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
 
 	// we just partially processed the buffers, so increment the data pointers to the next part of
 	// the buffer to process
@@ -274,6 +357,44 @@ OSStatus AUEffectBase::ProcessScheduledSlice(void* inUserData, UInt32 /*inStartF
 	return result;
 }
 
+// ____________________________________________________________________________
+//
+AUEffectBase::SliceStatistics AUEffectBase::GetSliceStatistics() const noexcept
+{
+	return { .mScheduledRenders = mScheduledRenders.load(std::memory_order_relaxed),
+		.mSlices = mSlices.load(std::memory_order_relaxed),
+		.mLastRenderSlices = mLastRenderSlices.load(std::memory_order_relaxed),
+		.mSliceHostTime = mSliceHostTime.load(std::memory_order_relaxed) };
+}
+
+// ____________________________________________________________________________
+//
+void AUEffectBase::ResetSliceStatistics() noexcept
+{
+	mScheduledRenders.store(0, std::memory_order_relaxed);
+	mSlices.store(0, std::memory_order_relaxed);
+	mLastRenderSlices.store(0, std::memory_order_relaxed);
+	mSliceHostTime.store(0, std::memory_order_relaxed);
+}
+
+// ____________________________________________________________________________
+//
+AUEffectBase::SleepStatistics AUEffectBase::GetSleepStatistics() const noexcept
+{
+	return { .mSleepingRenders = mSleepingRenders.load(std::memory_order_relaxed),
+		.mSkippedFrames = mSkippedFrames.load(std::memory_order_relaxed),
+		.mWakes = mWakes.load(std::memory_order_relaxed) };
+}
+
+// ____________________________________________________________________________
+//
+void AUEffectBase::ResetSleepStatistics() noexcept
+{
+	mSleepingRenders.store(0, std::memory_order_relaxed);
+	mSkippedFrames.store(0, std::memory_order_relaxed);
+	mWakes.store(0, std::memory_order_relaxed);
+}
+
 // ____________________________________________________________________________
 //
 
@@ -289,34 +410,83 @@ OSStatus AUEffectBase::Render(
 		mMainOutput->SetBufferList(mMainInput->GetBufferList());
 	}
 
+	// with a planar conversion stage, the kernels see separate buffers even when in place
+	const bool convertsToPlanar = mMainInput->ConvertsToPlanar() || mMainOutput->ConvertsToPlanar();
+	const bool processesInPlace = ProcessesInPlace() && !convertsToPlanar;
+	AudioBufferList& inputBufferList = mMainInput->GetPlanarBufferList();
+	AudioBufferList& outputBufferList = mMainOutput->PreparePlanarBuffer(nFrames);
+
 	OSStatus result = noErr;
 
-	if (ShouldBypassEffect()) {
+	auto& paramEventList = GetParamEventList();
+
+	// between the processed signal, at 0, and the bypassed one, at mBypassFadeFrames
+	const bool bypass = ShouldBypassEffect();
+	const UInt32 bypassTarget = bypass ? mBypassFadeFrames : 0;
+	mBypassFading = mBypassFadePosition != bypassTarget;
+
+	if (bypass && !mBypassFading) {
 		// leave silence bit alone
+		mKernelsBypassed = true;
 
-		if (!ProcessesInPlace()) {
-			mMainInput->CopyBufferContentsTo(mMainOutput->GetBufferList());
+		if (!processesInPlace) {
+			mMainInput->CopyPlanarContentsTo(outputBufferList);
+			mMainOutput->MarkBufferListModified();
 		}
+	} else if (!mBypassFading && mKernelSleepEnabled &&
+			   ((ioActionFlags & kAudioUnitRenderAction_OutputIsSilence) != 0u) &&
+			   paramEventList.empty() && mSilentTimeout.HasTimedOut()) {
+		// asleep: the silence bit is already set, and the output is only silenced below, which
+		// skips buffers known to be silent; AUBase::DoRenderBus() forgets that of buffers it
+		// hands to a caller, which may write them
+		mKernelsAsleep = true;
+		mSleepingRenders.store(
+			mSleepingRenders.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		mSkippedFrames.store(
+			mSkippedFrames.load(std::memory_order_relaxed) + nFrames, std::memory_order_relaxed);
 	} else {
-		auto& paramEventList = GetParamEventList();
+		if (mKernelsBypassed) {
+			// resetting also wakes kernels which slept before the bypass, but that is no wake
+			mKernelsBypassed = false;
+			mKernelsAsleep = false;
+			BypassEnded();
+		} else if (mKernelsAsleep) {
+			mKernelsAsleep = false;
+			WakeKernels();
+			mWakes.store(mWakes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		const bool silentInput = (ioActionFlags & kAudioUnitRenderAction_OutputIsSilence) != 0u;
+		const AudioBufferList* dryBufferList = &inputBufferList;
+		if (mBypassFading && processesInPlace) {
+			AudioBufferList& dryCopy =
+				mBypassDryBuffer.PrepareBuffer(mMainInput->GetPlanarFormat(), nFrames);
+			mMainInput->CopyPlanarContentsTo(dryCopy);
+			dryBufferList = &dryCopy;
+		}
+
+		// the kernels write the output even when they report silence
+		mMainOutput->MarkBufferListModified();
 
 		if (paramEventList.empty()) {
 			// this will read/write silence bit
-			result = ProcessBufferLists(
-				ioActionFlags, mMainInput->GetBufferList(), mMainOutput->GetBufferList(), nFrames);
+			result =
+				ProcessBufferLists(ioActionFlags, inputBufferList, outputBufferList, nFrames);
 		} else {
 			// deal with scheduled parameters...
 
-			AudioBufferList& inputBufferList = mMainInput->GetBufferList();
-			AudioBufferList& outputBufferList = mMainOutput->GetBufferList();
-
 			ScheduledProcessParams processParams{ .actionFlags = &ioActionFlags,
 				.inputBufferList = &inputBufferList,
 				.outputBufferList = &outputBufferList };
 
 			// divide up the buffer into slices according to scheduled params then
 			// do the DSP for each slice (ProcessScheduledSlice() called for each slice)
+			const UInt64 slicesBefore = mSlices.load(std::memory_order_relaxed);
 			result = ProcessForScheduledParams(paramEventList, nFrames, &processParams);
+			mLastRenderSlices.store(
+				mSlices.load(std::memory_order_relaxed) - slicesBefore, std::memory_order_relaxed);
+			mScheduledRenders.store(
+				mScheduledRenders.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
 
 			// fixup the buffer pointers to how they were before we started
 			const UInt32 channelSize = nFrames * mBytesPerFrame;
@@ -336,43 +506,101 @@ OSStatus AUEffectBase::Render(
 				outputBufferList.mBuffers[i].mDataByteSize = size;                      // NOLINT
 			}
 		}
+
+		if (mBypassFading) {
+			CrossfadeBypass(*dryBufferList, outputBufferList, nFrames, bypassTarget);
+			if (!silentInput) {
+				ioActionFlags &= ~kAudioUnitRenderAction_OutputIsSilence;
+			}
+			mBypassFading = false;
+		}
 	}
 
-	if (((ioActionFlags & kAudioUnitRenderAction_OutputIsSilence) != 0u) && !ProcessesInPlace()) {
-		AUBufferList::ZeroBuffer(mMainOutput->GetBufferList());
+	if (((ioActionFlags & kAudioUnitRenderAction_OutputIsSilence) != 0u) && !processesInPlace) {
+		if (convertsToPlanar) {
+			AUBufferList::ZeroBuffer(outputBufferList);
+		} else {
+			mMainOutput->SilenceBufferList();
+		}
 	}
 
 	return result;
 }
 
 
+// ____________________________________________________________________________
+//
+void AUEffectBase::CrossfadeBypass(const AudioBufferList& inDry, AudioBufferList& ioWet,
+	UInt32 inFramesToProcess, UInt32 inTarget) noexcept
+{
+	const bool toBypass = inTarget > mBypassFadePosition;
+	const UInt32 fadeFrames = std::min(inFramesToProcess,
+		toBypass ? inTarget - mBypassFadePosition : mBypassFadePosition - inTarget);
+	const float unit = 1.f / static_cast<float>(mBypassFadeFrames);
+	const float step = toBypass ? unit : -unit;
+	const float firstGain = static_cast<float>(mBypassFadePosition) * unit + step;
+
+	const UInt32 numBuffers = std::min(inDry.mNumberBuffers, ioWet.mNumberBuffers);
+	for (UInt32 i = 0; i < numBuffers; ++i) {
+		const auto* const dry = static_cast<const Float32*>(inDry.mBuffers[i].mData); // NOLINT
+		auto* const wet = static_cast<Float32*>(ioWet.mBuffers[i].mData);            // NOLINT
+		Crossfade(dry, wet, fadeFrames, firstGain, step);
+		if (toBypass) {
+			// the rest is fully bypassed
+			memcpy(wet + fadeFrames, dry + fadeFrames,               // NOLINT ptr math
+				(inFramesToProcess - fadeFrames) * sizeof(Float32)); // NOLINT
+		}
+	}
+	mBypassFadePosition = toBypass ? mBypassFadePosition + fadeFrames
+								   : mBypassFadePosition - fadeFrames;
+}
+
 OSStatus AUEffectBase::ProcessBufferLists(AudioUnitRenderActionFlags& ioActionFlags,
 	const AudioBufferList& inBuffer, AudioBufferList& outBuffer, UInt32 inFramesToProcess)
 {
-	if (ShouldBypassEffect()) {
+	if (ShouldBypassEffect() && !mBypassFading) {
 		return noErr;
 	}
 
-	bool ioSilence = false;
-
 	const bool silentInput = IsInputSilent(ioActionFlags, inFramesToProcess);
 	ioActionFlags |= kAudioUnitRenderAction_OutputIsSilence;
 
-	for (UInt32 channel = 0; channel < mKernelList.size(); ++channel) {
-		auto& kernel = mKernelList[channel];
-
-		if (!kernel) {
-			continue;
+	if (mMultiChannelKernel) {
+		const auto nChannels = static_cast<UInt32>(mKernelSources.size());
+		for (UInt32 channel = 0; channel < nChannels; ++channel) {
+			const AudioBuffer& srcBuffer = inBuffer.mBuffers[channel]; // NOLINT subscript
+			AudioBuffer& destBuffer = outBuffer.mBuffers[channel];     // NOLINT subscript
+			mKernelSources[channel] = static_cast<const Float32*>(srcBuffer.mData);
+			mKernelDests[channel] = static_cast<Float32*>(destBuffer.mData);
 		}
+		bool ioSilence = silentInput;
+		mMultiChannelKernel->Process(
+			mKernelSources.data(), mKernelDests.data(), inFramesToProcess, ioSilence);
+		if (!ioSilence) {
+			ioActionFlags &= ~kAudioUnitRenderAction_OutputIsSilence;
+		}
+		return noErr;
+	}
 
-		ioSilence = silentInput;
-		const AudioBuffer* const srcBuffer = &inBuffer.mBuffers[channel]; // NOLINT subscript
-		AudioBuffer* const destBuffer = &outBuffer.mBuffers[channel];     // NOLINT subscript
-
-		kernel->Process(static_cast<const Float32*>(srcBuffer->mData),
-			static_cast<Float32*>(destBuffer->mData), inFramesToProcess, ioSilence);
+	const auto nKernels = static_cast<UInt32>(mKernelList.size());
+	if (mKernelWorkers) {
+		// each worker joins this render, so that its parameter reads are as cheap as ours
+		auto processKernel = [&](UInt32 channel) {
+			const auto renderEpochScope = AURenderEpoch::Scope::Join(GetRenderEpoch());
+			mKernelSilence[channel] =
+				ProcessKernel(channel, inBuffer, outBuffer, inFramesToProcess, silentInput) ? 1 : 0;
+		};
+		mKernelWorkers->Run(nKernels, processKernel);
+		for (UInt32 channel = 0; channel < nKernels; ++channel) {
+			if (mKernelSilence[channel] == 0) {
+				ioActionFlags &= ~kAudioUnitRenderAction_OutputIsSilence;
+			}
+		}
+		return noErr;
+	}
 
-		if (!ioSilence) {
+	for (UInt32 channel = 0; channel < nKernels; ++channel) {
+		if (!ProcessKernel(channel, inBuffer, outBuffer, inFramesToProcess, silentInput)) {
 			ioActionFlags &= ~kAudioUnitRenderAction_OutputIsSilence;
 		}
 	}
@@ -380,6 +608,23 @@ OSStatus AUEffectBase::ProcessBufferLists(AudioUnitRenderActionFlags& ioActionFl
 	return noErr;
 }
 
+bool AUEffectBase::ProcessKernel(UInt32 inChannel, const AudioBufferList& inBuffer,
+	AudioBufferList& outBuffer, UInt32 inFramesToProcess, bool inSilentInput)
+{
+	auto& kernel = mKernelList[inChannel];
+	if (!kernel) {
+		return true;
+	}
+
+	bool ioSilence = inSilentInput;
+	const AudioBuffer* const srcBuffer = &inBuffer.mBuffers[inChannel]; // NOLINT subscript
+	AudioBuffer* const destBuffer = &outBuffer.mBuffers[inChannel];     // NOLINT subscript
+
+	kernel->Process(static_cast<const Float32*>(srcBuffer->mData),
+		static_cast<Float32*>(destBuffer->mData), inFramesToProcess, ioSilence);
+	return ioSilence;
+}
+
 Float64 AUEffectBase::GetSampleRate() { return Output(0).GetStreamFormat().mSampleRate; }
 
 UInt32 AUEffectBase::GetNumberOfChannels() { return Output(0).GetStreamFormat().mChannelsPerFrame; }
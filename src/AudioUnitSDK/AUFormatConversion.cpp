@@ -0,0 +1,313 @@
+/*!
+	@file		AudioUnitSDK/AUFormatConversion.cpp
+	@copyright	© 2000-2023 Apple Inc. All rights reserved.
+*/
+#include <AudioUnitSDK/AUFormatConversion.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace ausdk::FormatConversion {
+
+namespace {
+
+static_assert(std::endian::native == std::endian::little, "24-bit samples assume little-endian");
+
+// 128-bit vectors of 32-bit lanes, for the stereo shuffle kernels.
+using Lanes = uint32_t __attribute__((vector_size(16)));
+constexpr UInt32 kLanes = 4;
+
+#if defined(__clang__)
+#define AUSDK_SHUFFLE4(a, b, i0, i1, i2, i3) __builtin_shufflevector(a, b, i0, i1, i2, i3)
+#else
+#define AUSDK_SHUFFLE4(a, b, i0, i1, i2, i3) __builtin_shuffle(a, b, Lanes{ i0, i1, i2, i3 })
+#endif
+
+// Rounds a sample scaled to an integer range of [-scale, scale) to nearest, clipping. Written
+// as min/max, add and truncate so that the loops calling it vectorize.
+inline int32_t Quantize(float value, float scale) noexcept
+{
+	const float clipped = std::min(std::max(value, -scale), scale - 1.0f);
+	return static_cast<int32_t>(clipped + (clipped < 0.0f ? -0.5f : 0.5f)); // NOLINT
+}
+
+// Sample codecs. Load reads one sample as Float32 in [-1, 1); Store writes one, adding noise
+// (in LSBs) to integer samples.
+struct Int16Codec {
+	static constexpr UInt32 kBytes = 2;
+	static constexpr float kScale = 32768.0f; // NOLINT magic number
+
+	static float Load(const std::byte* src) noexcept
+	{
+		int16_t sample = 0;
+		memcpy(&sample, src, sizeof(sample));
+		return static_cast<float>(sample) * (1.0f / kScale);
+	}
+	static void Store(float value, float noise, std::byte* dest) noexcept
+	{
+		const auto sample = static_cast<int16_t>(Quantize(value * kScale + noise, kScale));
+		memcpy(dest, &sample, sizeof(sample));
+	}
+};
+
+struct Int24Codec {
+	static constexpr UInt32 kBytes = 3;
+	static constexpr float kScale = 8388608.0f; // NOLINT magic number
+
+	static float Load(const std::byte* src) noexcept
+	{
+		// assemble in the top 24 bits, then sign-extend
+		const uint32_t bits = (static_cast<uint32_t>(src[0]) << 8u) |  // NOLINT ptr math
+							  (static_cast<uint32_t>(src[1]) << 16u) | // NOLINT ptr math
+							  (static_cast<uint32_t>(src[2]) << 24u);  // NOLINT ptr math
+		return static_cast<float>(static_cast<int32_t>(bits) >> 8) * (1.0f / kScale);
+	}
+	static void Store(float value, float noise, std::byte* dest) noexcept
+	{
+		const auto bits = static_cast<uint32_t>(Quantize(value * kScale + noise, kScale));
+		dest[0] = static_cast<std::byte>(bits);        // NOLINT ptr math
+		dest[1] = static_cast<std::byte>(bits >> 8u);  // NOLINT ptr math
+		dest[2] = static_cast<std::byte>(bits >> 16u); // NOLINT ptr math
+	}
+};
+
+struct Float32Codec {
+	static constexpr UInt32 kBytes = 4;
+	static constexpr float kScale = 0.0f; // not quantized
+};
+
+struct Float64Codec {
+	static constexpr UInt32 kBytes = 8;
+	static constexpr float kScale = 0.0f; // not quantized
+
+	static float Load(const std::byte* src) noexcept
+	{
+		double sample = 0.0;
+		memcpy(&sample, src, sizeof(sample));
+		return static_cast<float>(sample);
+	}
+	static void Store(float value, float /*noise*/, std::byte* dest) noexcept
+	{
+		const auto sample = static_cast<double>(value);
+		memcpy(dest, &sample, sizeof(sample));
+	}
+};
+
+// Float32 needs no sample conversion, only the transpose, for which stereo goes through 4-lane
+// vector shuffles.
+void Deinterleave(const float* src, UInt32 nChannels, AudioBuffer* dest, UInt32 nFrames) noexcept
+{
+	UInt32 frame = 0;
+	if (nChannels == 2) {
+		auto* const left = static_cast<float*>(dest[0].mData);  // NOLINT
+		auto* const right = static_cast<float*>(dest[1].mData); // NOLINT
+		for (; frame + kLanes <= nFrames; frame += kLanes) {
+			Lanes a{};
+			Lanes b{};
+			memcpy(&a, src + 2 * frame, sizeof(Lanes));          // NOLINT ptr math
+			memcpy(&b, src + 2 * frame + kLanes, sizeof(Lanes)); // NOLINT ptr math
+			const Lanes l = AUSDK_SHUFFLE4(a, b, 0, 2, 4, 6);
+			const Lanes r = AUSDK_SHUFFLE4(a, b, 1, 3, 5, 7);
+			memcpy(left + frame, &l, sizeof(Lanes));  // NOLINT ptr math
+			memcpy(right + frame, &r, sizeof(Lanes)); // NOLINT ptr math
+		}
+	}
+	for (UInt32 ch = 0; ch < nChannels; ++ch) {
+		auto* const out = static_cast<float*>(dest[ch].mData); // NOLINT
+		for (UInt32 i = frame; i < nFrames; ++i) {
+			out[i] = src[i * nChannels + ch]; // NOLINT ptr math
+		}
+	}
+}
+
+void Interleave(const AudioBuffer* src, UInt32 nChannels, float* dest, UInt32 nFrames) noexcept
+{
+	UInt32 frame = 0;
+	if (nChannels == 2) {
+		const auto* const left = static_cast<const float*>(src[0].mData);  // NOLINT
+		const auto* const right = static_cast<const float*>(src[1].mData); // NOLINT
+		for (; frame + kLanes <= nFrames; frame += kLanes) {
+			Lanes l{};
+			Lanes r{};
+			memcpy(&l, left + frame, sizeof(Lanes));  // NOLINT ptr math
+			memcpy(&r, right + frame, sizeof(Lanes)); // NOLINT ptr math
+			const Lanes a = AUSDK_SHUFFLE4(l, r, 0, 4, 1, 5);
+			const Lanes b = AUSDK_SHUFFLE4(l, r, 2, 6, 3, 7);
+			memcpy(dest + 2 * frame, &a, sizeof(Lanes));          // NOLINT ptr math
+			memcpy(dest + 2 * frame + kLanes, &b, sizeof(Lanes)); // NOLINT ptr math
+		}
+	}
+	for (UInt32 ch = 0; ch < nChannels; ++ch) {
+		const auto* const in = static_cast<const float*>(src[ch].mData); // NOLINT
+		for (UInt32 i = frame; i < nFrames; ++i) {
+			dest[i * nChannels + ch] = in[i]; // NOLINT ptr math
+		}
+	}
+}
+
+// Converts one channel, nChannels samples apart in src, to contiguous Float32. Non-interleaved
+// sources get their own loop so that it vectorizes.
+template <typename Codec>
+void ToFloat(const std::byte* src, UInt32 nChannels, float* dest, UInt32 nFrames) noexcept
+{
+	if (nChannels == 1) {
+		for (UInt32 i = 0; i < nFrames; ++i) {
+			dest[i] = Codec::Load(src + static_cast<size_t>(i) * Codec::kBytes); // NOLINT
+		}
+		return;
+	}
+	const size_t stride = static_cast<size_t>(nChannels) * Codec::kBytes;
+	for (UInt32 i = 0; i < nFrames; ++i) {
+		dest[i] = Codec::Load(src + i * stride); // NOLINT ptr math
+	}
+}
+
+template <typename Codec>
+void FromFloat(const float* src, UInt32 nChannels, std::byte* dest, UInt32 nFrames,
+	Ditherer* ditherer) noexcept
+{
+	const size_t stride = static_cast<size_t>(nChannels) * Codec::kBytes;
+	if constexpr (Codec::kScale != 0.0f) {
+		if (ditherer != nullptr && ditherer->Mode() != EDither::None) {
+			for (UInt32 i = 0; i < nFrames; ++i) {
+				Codec::Store(src[i], ditherer->Next(), dest + i * stride); // NOLINT ptr math
+			}
+			return;
+		}
+	}
+	if (nChannels == 1) {
+		for (UInt32 i = 0; i < nFrames; ++i) {
+			Codec::Store(src[i], 0.0f, dest + static_cast<size_t>(i) * Codec::kBytes); // NOLINT
+		}
+		return;
+	}
+	for (UInt32 i = 0; i < nFrames; ++i) {
+		Codec::Store(src[i], 0.0f, dest + i * stride); // NOLINT ptr math
+	}
+}
+
+enum class ESampleType { Unsupported, Int16, Int24, Float32, Float64 };
+
+ESampleType SampleTypeOf(const AudioStreamBasicDescription& format) noexcept
+{
+	if ((format.mFormatFlags & kAudioFormatFlagIsFloat) != 0) {
+		switch (format.mBitsPerChannel) {
+		case 32: // NOLINT magic number
+			return ESampleType::Float32;
+		case 64: // NOLINT magic number
+			return ESampleType::Float64;
+		default:
+			return ESampleType::Unsupported;
+		}
+	}
+	if ((format.mFormatFlags & kAudioFormatFlagIsSignedInteger) != 0 &&
+		(format.mFormatFlags & kLinearPCMFormatFlagsSampleFractionMask) == 0) {
+		switch (format.mBitsPerChannel) {
+		case 16: // NOLINT magic number
+			return ESampleType::Int16;
+		case 24: // NOLINT magic number
+			return ESampleType::Int24;
+		default:
+			return ESampleType::Unsupported;
+		}
+	}
+	return ESampleType::Unsupported;
+}
+
+// Calls f with a null pointer to the codec for the sample type of format.
+template <typename F>
+void WithCodec(const AudioStreamBasicDescription& format, F&& f)
+{
+	switch (SampleTypeOf(format)) {
+	case ESampleType::Int16:
+		f(static_cast<Int16Codec*>(nullptr));
+		break;
+	case ESampleType::Int24:
+		f(static_cast<Int24Codec*>(nullptr));
+		break;
+	case ESampleType::Float32:
+		f(static_cast<Float32Codec*>(nullptr));
+		break;
+	case ESampleType::Float64:
+		f(static_cast<Float64Codec*>(nullptr));
+		break;
+	default:
+		Throw(kAudioUnitErr_FormatNotSupported);
+	}
+}
+
+} // namespace
+
+bool IsConvertible(const AudioStreamBasicDescription& format) noexcept
+{
+	const UInt32 bytesPerSample = format.mBitsPerChannel / 8; // NOLINT magic number
+	return format.mFormatID == kAudioFormatLinearPCM && format.mChannelsPerFrame > 0 &&
+		   format.mFramesPerPacket == 1 && format.mBytesPerPacket == format.mBytesPerFrame &&
+		   format.mBitsPerChannel % 8 == 0 && // NOLINT magic number
+		   format.mBytesPerFrame == bytesPerSample * ASBD::NumberInterleavedChannels(format) &&
+		   (format.mFormatFlags & kAudioFormatFlagIsBigEndian) == kAudioFormatFlagsNativeEndian &&
+		   SampleTypeOf(format) != ESampleType::Unsupported && !ASBD::IsCommonFloat32(format);
+}
+
+AudioStreamBasicDescription PlanarFormat(const AudioStreamBasicDescription& format) noexcept
+{
+	return ASBD::CreateCommonFloat32(format.mSampleRate, format.mChannelsPerFrame);
+}
+
+void ToPlanar(const AudioStreamBasicDescription& inFormat, const AudioBufferList& inInterleaved,
+	AudioBufferList& outPlanar, UInt32 nFrames)
+{
+	WithCodec(inFormat, [&]<typename Codec>(Codec*) {
+		UInt32 channel = 0;
+		for (UInt32 i = 0; i < inInterleaved.mNumberBuffers; ++i) {
+			const AudioBuffer& in = inInterleaved.mBuffers[i]; // NOLINT
+			ThrowExceptionIf(channel + in.mNumberChannels > outPlanar.mNumberBuffers,
+				kAudioUnitErr_FormatNotSupported);
+			AudioBuffer* const out = &outPlanar.mBuffers[channel]; // NOLINT
+			if constexpr (std::is_same_v<Codec, Float32Codec>) {
+				Deinterleave(static_cast<const float*>(in.mData), in.mNumberChannels, out, nFrames);
+			} else {
+				const auto* const src = static_cast<const std::byte*>(in.mData);
+				for (UInt32 ch = 0; ch < in.mNumberChannels; ++ch) {
+					ToFloat<Codec>(src + ch * Codec::kBytes, in.mNumberChannels, // NOLINT
+						static_cast<float*>(out[ch].mData), nFrames);            // NOLINT
+				}
+			}
+			for (UInt32 ch = 0; ch < in.mNumberChannels; ++ch) {
+				out[ch].mDataByteSize = nFrames * static_cast<UInt32>(sizeof(float)); // NOLINT
+			}
+			channel += in.mNumberChannels;
+		}
+	});
+}
+
+void FromPlanar(const AudioBufferList& inPlanar, const AudioStreamBasicDescription& outFormat,
+	AudioBufferList& outInterleaved, UInt32 nFrames, Ditherer* ioDitherer)
+{
+	WithCodec(outFormat, [&]<typename Codec>(Codec*) {
+		UInt32 channel = 0;
+		for (UInt32 i = 0; i < outInterleaved.mNumberBuffers; ++i) {
+			AudioBuffer& out = outInterleaved.mBuffers[i]; // NOLINT
+			ThrowExceptionIf(channel + out.mNumberChannels > inPlanar.mNumberBuffers,
+				kAudioUnitErr_FormatNotSupported);
+			const AudioBuffer* const in = &inPlanar.mBuffers[channel]; // NOLINT
+			if constexpr (std::is_same_v<Codec, Float32Codec>) {
+				Interleave(in, out.mNumberChannels, static_cast<float*>(out.mData), nFrames);
+			} else {
+				auto* const dest = static_cast<std::byte*>(out.mData);
+				for (UInt32 ch = 0; ch < out.mNumberChannels; ++ch) {
+					FromFloat<Codec>(static_cast<const float*>(in[ch].mData), // NOLINT
+						out.mNumberChannels, dest + ch * Codec::kBytes, nFrames,  // NOLINT
+						ioDitherer);
+				}
+			}
+			out.mDataByteSize = nFrames * out.mNumberChannels * Codec::kBytes;
+			channel += out.mNumberChannels;
+		}
+	});
+}
+
+} // namespace ausdk::FormatConversion
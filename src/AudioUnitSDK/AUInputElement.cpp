@@ -38,7 +38,7 @@ void AUInputElement::SetConnection(const AudioUnitConnection& conn)
 void AUInputElement::Disconnect()
 {
 	mInputType = EInputType::NoInput;
-	IOBuffer().Deallocate();
+	DeallocateBuffer();
 }
 
 
@@ -72,13 +72,16 @@ OSStatus AUInputElement::PullInput(AudioUnitRenderActionFlags& ioActionFlags,
 {
 	AUSDK_Require(IsActive(), kAudioUnitErr_NoConnection);
 
-	auto& iob = IOBuffer();
-
 	AudioBufferList& pullBuffer = (HasConnection() || !WillAllocateBuffer())
-									  ? iob.PrepareNullBuffer(GetStreamFormat(), nFrames)
-									  : iob.PrepareBuffer(GetStreamFormat(), nFrames);
+									  ? PrepareNullBuffer(nFrames)
+									  : PrepareBuffer(nFrames);
 
-	return PullInputWithBufferList(ioActionFlags, inTimeStamp, inElement, nFrames, pullBuffer);
+	const OSStatus result =
+		PullInputWithBufferList(ioActionFlags, inTimeStamp, inElement, nFrames, pullBuffer);
+	if (result == noErr) {
+		ConvertToPlanar(nFrames);
+	}
+	return result;
 }
 
 } // namespace ausdk
@@ -225,12 +225,16 @@ OSStatus AUInstrumentBase::Render([[maybe_unused]] AudioUnitRenderActionFlags& i
 
 	for (UInt32 j = 0; j < numOutputs; ++j) {
 
-		// AUBase::DoRenderBus() only does this for the first output element
-		Output(j).PrepareBuffer(inNumberFrames);
-		AudioBufferList& bufferList = Output(j).GetBufferList();
-
-		for (UInt32 k = 0; k < bufferList.mNumberBuffers; ++k) {
-			memset(bufferList.mBuffers[k].mData, 0, bufferList.mBuffers[k].mDataByteSize);
+		// AUBase::DoRenderBus() only does this for the first output element, and may instead
+		// have pointed the pulled output at the caller's buffers
+		if (!Output(j).RenderedInPlaceAt(inTimeStamp.mSampleTime)) {
+			Output(j).PrepareBuffer(inNumberFrames);
+		}
+		// skips buffers which no note, nor a caller given them by AUBase::DoRenderBus(), has
+		// written since they were last silenced
+		Output(j).SilenceBufferList();
+		if (!mTracksSilentOutputs) {
+			Output(j).MarkBufferListModified();
 		}
 	}
 
@@ -238,6 +242,11 @@ OSStatus AUInstrumentBase::Render([[maybe_unused]] AudioUnitRenderActionFlags& i
 
 	for (UInt32 j = 0; j < numGroups; ++j) {
 		SynthGroupElement* group = (SynthGroupElement*)Groups().GetElement(j);
+		if (mTracksSilentOutputs && group->HasSoundingNotes()) {
+			for (UInt32 k = 0; k < numOutputs; ++k) {
+				Output(k).MarkBufferListModified();
+			}
+		}
 		OSStatus err = group->Render((SInt64)inTimeStamp.mSampleTime, inNumberFrames, outputs);
 		if (err)
 			return err;
@@ -0,0 +1,70 @@
+/*!
+	@file		AudioUnitSDK/AUParameterEventList.cpp
+	@copyright	© 2000-2023 Apple Inc. All rights reserved.
+*/
+#include <AudioUnitSDK/AUParameterEventList.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace ausdk {
+
+//_____________________________________________________________________________
+//
+void AUParameterEventList::Reserve(UInt32 inCapacity)
+{
+	// e.g. ScheduleParameter() before AUBase::DoInitialize()
+	for (; size() > inCapacity; ++mBegin) {
+		CountDropped();
+	}
+	std::vector<AudioUnitParameterEvent> storage(2 * static_cast<size_t>(inCapacity));
+	std::copy(begin(), end(), storage.begin());
+	mEnd = size();
+	mBegin = 0;
+	mStorage = std::move(storage);
+	mCapacity = inCapacity;
+}
+
+//_____________________________________________________________________________
+//
+OSStatus AUParameterEventList::Push(const AudioUnitParameterEvent& inEvent) noexcept
+{
+	if (size() == mCapacity) {
+		switch (mOverflowPolicy) {
+		case EOverflowPolicy::DropOldest:
+			CountDropped();
+			if (mCapacity == 0) {
+				return noErr;
+			}
+			++mBegin;
+			break;
+		case EOverflowPolicy::CoalesceByParameter: {
+			const auto latest = std::find_if(std::make_reverse_iterator(end()),
+				std::make_reverse_iterator(begin()), [&](const AudioUnitParameterEvent& event) {
+					return event.parameter == inEvent.parameter && event.scope == inEvent.scope &&
+						   event.element == inEvent.element;
+				});
+			if (latest.base() != begin()) {
+				*std::prev(latest.base()) = inEvent;
+				CountCoalesced();
+			} else {
+				CountDropped();
+			}
+			return noErr;
+		}
+		case EOverflowPolicy::ReportError:
+			CountDropped();
+			return kAudio_MemFullError;
+		}
+	}
+
+	if (mEnd == mStorage.size()) {
+		std::copy(begin(), end(), mStorage.begin());
+		mEnd -= mBegin;
+		mBegin = 0;
+	}
+	mStorage[mEnd++] = inEvent;
+	return noErr;
+}
+
+} // namespace ausdk
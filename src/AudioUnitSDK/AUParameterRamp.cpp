@@ -0,0 +1,125 @@
+/*!
+	@file		AudioUnitSDK/AUParameterRamp.cpp
+	@copyright	© 2000-2023 Apple Inc. All rights reserved.
+*/
+#include <AudioUnitSDK/AUParameterRamp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ausdk {
+
+namespace {
+
+using RampVector = float __attribute__((vector_size(16)));
+constexpr UInt32 kRampVectorLanes = sizeof(RampVector) / sizeof(float);
+
+// Exponential ramps are stepped by multiplication, and re-anchored this often to bound the
+// accumulated rounding error.
+constexpr UInt32 kExponentialAnchorInterval = 64;
+
+} // namespace
+
+//_____________________________________________________________________________
+//
+void AUParameterRamp::Start(const AudioUnitParameterEvent& inEvent) noexcept
+{
+	const auto& ramp = inEvent.eventValues.ramp; // NOLINT union
+	mStartValue = ramp.startValue;
+	mEndValue = ramp.endValue;
+	mStartFrame = ramp.startBufferOffset;
+	mDuration = ramp.durationInFrames;
+	mActive = true;
+}
+
+//_____________________________________________________________________________
+//
+bool AUParameterRamp::IsExponential() const noexcept
+{
+	return mCurve == ECurve::Exponential && mStartValue != 0.f && mEndValue != 0.f &&
+		   std::signbit(mStartValue) == std::signbit(mEndValue);
+}
+
+//_____________________________________________________________________________
+//
+AudioUnitParameterValue AUParameterRamp::ValueAt(SInt64 inFrame) const noexcept
+{
+	if (inFrame >= mStartFrame + mDuration) {
+		return mEndValue;
+	}
+	if (inFrame <= mStartFrame) {
+		return mStartValue;
+	}
+	const double t = static_cast<double>(inFrame - mStartFrame) / mDuration;
+	if (IsExponential()) {
+		return static_cast<AudioUnitParameterValue>(
+			mStartValue * std::pow(static_cast<double>(mEndValue) / mStartValue, t));
+	}
+	return static_cast<AudioUnitParameterValue>(mStartValue + (mEndValue - mStartValue) * t);
+}
+
+//_____________________________________________________________________________
+//
+void AUParameterRamp::Fill(AudioUnitParameterValue* outValues, UInt32 inCount,
+	SInt64 inFirstFrame, UInt32 inFrameStep) const noexcept
+{
+	const SInt64 step = std::max(inFrameStep, 1u);
+	// the index of the first value at or after inFrame
+	const auto indexOf = [&](SInt64 inFrame) {
+		if (inFrame <= inFirstFrame) {
+			return 0u;
+		}
+		const SInt64 index = (inFrame - inFirstFrame + step - 1) / step;
+		return static_cast<UInt32>(std::min<SInt64>(index, inCount));
+	};
+	const UInt32 rampEnd = indexOf(mStartFrame + mDuration);
+	const UInt32 rampBegin = std::min(indexOf(mStartFrame), rampEnd);
+
+	std::fill_n(outValues, rampBegin, mStartValue);
+	std::fill(outValues + rampEnd, outValues + inCount, mEndValue); // NOLINT ptr math
+	if (rampBegin == rampEnd) {
+		return;
+	}
+
+	UInt32 i = rampBegin;
+	const double framesPerValue = static_cast<double>(step) / mDuration;
+	const double firstT = static_cast<double>(inFirstFrame - mStartFrame) / mDuration;
+	if (IsExponential()) {
+		const double logRatio = std::log(static_cast<double>(mEndValue) / mStartValue);
+		const auto ratio = static_cast<float>(std::exp(logRatio * framesPerValue));
+		const auto ratio2 = ratio * ratio;
+		const RampVector lanesRatio{ 1.f, ratio, ratio2, ratio2 * ratio };
+		const auto vectorRatio = ratio2 * ratio2;
+		while (i < rampEnd) {
+			const UInt32 anchorEnd = std::min(i + kExponentialAnchorInterval, rampEnd);
+			const auto anchor = static_cast<float>(
+				mStartValue * std::exp(logRatio * (firstT + i * framesPerValue)));
+			RampVector values = anchor * lanesRatio;
+			for (; i + kRampVectorLanes <= anchorEnd; i += kRampVectorLanes) {
+				memcpy(outValues + i, &values, sizeof(values)); // NOLINT ptr math
+				values *= vectorRatio;
+			}
+			for (float value = values[0]; i < anchorEnd; ++i, value *= ratio) {
+				outValues[i] = value; // NOLINT ptr math
+			}
+		}
+		return;
+	}
+
+	const auto delta = static_cast<double>(mEndValue) - mStartValue;
+	const auto base = static_cast<float>(mStartValue + delta * firstT);
+	const auto increment = static_cast<float>(delta * framesPerValue);
+	RampVector index{ 0.f, 1.f, 2.f, 3.f };
+	index += static_cast<float>(i);
+	for (; i + kRampVectorLanes <= rampEnd; i += kRampVectorLanes) {
+		const RampVector values = base + index * increment;
+		memcpy(outValues + i, &values, sizeof(values)); // NOLINT ptr math
+		index += static_cast<float>(kRampVectorLanes);
+	}
+	for (; i < rampEnd; ++i) {
+		outValues[i] = base + static_cast<float>(i) * increment; // NOLINT ptr math
+	}
+}
+
+} // namespace ausdk
@@ -0,0 +1,341 @@
+/*!
+	@file		AudioUnitSDK/AURealtimeGuard.cpp
+	@copyright	© 2000-2023 Apple Inc. All rights reserved.
+*/
+#include <AudioUnitSDK/AURealtimeGuard.h>
+
+#if AUSDK_REALTIME_GUARD
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace ausdk {
+
+namespace {
+
+// Initial-exec TLS, so that the hooks can reach it without allocating.
+#define AUSDK_GUARD_THREAD_LOCAL thread_local __attribute__((tls_model("initial-exec")))
+
+AUSDK_GUARD_THREAD_LOCAL UInt32 tRenderDepth = 0;
+AUSDK_GUARD_THREAD_LOCAL UInt32 tSuspendDepth = 0;
+AUSDK_GUARD_THREAD_LOCAL UInt32 tRenderViolations = 0;
+AUSDK_GUARD_THREAD_LOCAL UInt64 tRender = 0;
+
+std::atomic<UInt64> gRenders{ 0 };
+std::atomic<UInt64> gViolatingRenders{ 0 };
+std::atomic<UInt64> gViolations{ 0 };
+std::atomic<UInt32> gLastRenderViolations{ 0 };
+std::atomic<UInt32> gMaximumRenderViolations{ 0 };
+std::atomic<AURealtimeGuard::ViolationHandler> gViolationHandler{ nullptr };
+
+// A ring of the most recent violations. Each entry is a seqlock: its stamp is the violation's
+// index + 1 when complete, kWriting while being written, so that readers can skip torn entries.
+constexpr UInt64 kWriting = ~UInt64{ 0 };
+
+struct LoggedViolation {
+	std::atomic<UInt64> mStamp{ 0 };
+	AURealtimeGuard::Violation mViolation;
+};
+
+std::array<LoggedViolation, AURealtimeGuard::kMaximumViolations> gViolationLog;
+std::atomic<UInt64> gNextViolation{ 0 };
+
+// glibc's backtrace() loads the unwinder, which allocates, on first use; do that now rather
+// than from inside a hook.
+[[maybe_unused]] const int gBacktracePrimed = [] {
+	std::array<void*, 1> frames{};
+	return backtrace(frames.data(), static_cast<int>(frames.size()));
+}();
+
+} // namespace
+
+//_____________________________________________________________________________
+//
+AURealtimeGuard::AURealtimeGuard() noexcept
+{
+	if (tRenderDepth++ == 0) {
+		tRenderViolations = 0;
+		tRender = gRenders.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+//_____________________________________________________________________________
+//
+AURealtimeGuard::~AURealtimeGuard() noexcept
+{
+	if (--tRenderDepth > 0) {
+		return;
+	}
+	const UInt32 violations = tRenderViolations;
+	gLastRenderViolations.store(violations, std::memory_order_relaxed);
+	if (violations > 0) {
+		gViolatingRenders.fetch_add(1, std::memory_order_relaxed);
+		UInt32 maximum = gMaximumRenderViolations.load(std::memory_order_relaxed);
+		while (violations > maximum && !gMaximumRenderViolations.compare_exchange_weak(
+										   maximum, violations, std::memory_order_relaxed)) {
+		}
+	}
+}
+
+//_____________________________________________________________________________
+//
+void AURealtimeGuard::Report(EViolation inKind) noexcept
+{
+	if (tRenderDepth == 0 || tSuspendDepth > 0) {
+		return;
+	}
+	const Suspension suspension; // recording must not recurse into the hooks
+	++tRenderViolations;
+	gViolations.fetch_add(1, std::memory_order_relaxed);
+
+	const UInt64 index = gNextViolation.fetch_add(1, std::memory_order_relaxed);
+	auto& entry = gViolationLog[index % kMaximumViolations]; // NOLINT index is in range
+	entry.mStamp.store(kWriting, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	Violation& violation = entry.mViolation;
+	violation.mKind = inKind;
+	violation.mRender = tRender;
+	const int depth =
+		backtrace(violation.mFrames.data(), static_cast<int>(violation.mFrames.size()));
+	violation.mFrameCount = static_cast<UInt32>(std::max(depth, 0));
+	entry.mStamp.store(index + 1, std::memory_order_release);
+
+	if (const auto handler = gViolationHandler.load(std::memory_order_acquire)) {
+		handler(violation);
+	}
+}
+
+//_____________________________________________________________________________
+//
+AURealtimeGuard::Statistics AURealtimeGuard::GetStatistics() noexcept
+{
+	return { .mRenders = gRenders.load(std::memory_order_relaxed),
+		.mViolatingRenders = gViolatingRenders.load(std::memory_order_relaxed),
+		.mViolations = gViolations.load(std::memory_order_relaxed),
+		.mLastRenderViolations = gLastRenderViolations.load(std::memory_order_relaxed),
+		.mMaximumRenderViolations = gMaximumRenderViolations.load(std::memory_order_relaxed) };
+}
+
+//_____________________________________________________________________________
+//
+void AURealtimeGuard::ResetStatistics() noexcept
+{
+	gRenders.store(0, std::memory_order_relaxed);
+	gViolatingRenders.store(0, std::memory_order_relaxed);
+	gViolations.store(0, std::memory_order_relaxed);
+	gLastRenderViolations.store(0, std::memory_order_relaxed);
+	gMaximumRenderViolations.store(0, std::memory_order_relaxed);
+	for (auto& entry : gViolationLog) {
+		entry.mStamp.store(0, std::memory_order_relaxed);
+	}
+}
+
+//_____________________________________________________________________________
+//
+size_t AURealtimeGuard::CopyViolations(Violation* outViolations, size_t inCapacity) noexcept
+{
+	const UInt64 end = gNextViolation.load(std::memory_order_acquire);
+	const UInt64 begin = end - std::min<UInt64>(end, std::min(inCapacity, kMaximumViolations));
+	size_t count = 0;
+	for (UInt64 index = begin; index < end; ++index) {
+		const auto& entry = gViolationLog[index % kMaximumViolations]; // NOLINT index is in range
+		if (entry.mStamp.load(std::memory_order_acquire) != index + 1) {
+			continue; // reset, being written or overwritten
+		}
+		outViolations[count] = entry.mViolation; // NOLINT ptr math
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (entry.mStamp.load(std::memory_order_relaxed) == index + 1) {
+			++count;
+		}
+	}
+	return count;
+}
+
+//_____________________________________________________________________________
+//
+void AURealtimeGuard::SetViolationHandler(ViolationHandler inHandler) noexcept
+{
+	gViolationHandler.store(inHandler, std::memory_order_release);
+}
+
+//_____________________________________________________________________________
+//
+AURealtimeGuard::Suspension::Suspension() noexcept { ++tSuspendDepth; }
+
+AURealtimeGuard::Suspension::~Suspension() noexcept { --tSuspendDepth; }
+
+} // namespace ausdk
+
+//_____________________________________________________________________________
+// Hooks
+
+using ausdk::AURealtimeGuard;
+
+#if defined(__GLIBC__)
+
+// glibc exports most of its implementations under these names, so the interposers can forward
+// without dlsym(), which itself allocates. libstdc++'s operator new calls malloc, so it needs no
+// replacement.
+extern "C" {
+void* __libc_malloc(size_t);                 // NOLINT reserved identifier
+void* __libc_calloc(size_t, size_t);         // NOLINT reserved identifier
+void* __libc_realloc(void*, size_t);         // NOLINT reserved identifier
+void __libc_free(void*);                     // NOLINT reserved identifier
+void* __libc_memalign(size_t, size_t);       // NOLINT reserved identifier
+ssize_t __read(int, void*, size_t);          // NOLINT reserved identifier
+ssize_t __write(int, const void*, size_t);   // NOLINT reserved identifier
+int __nanosleep(const timespec*, timespec*); // NOLINT reserved identifier
+
+void* malloc(size_t size) noexcept
+{
+	AURealtimeGuard::Report(AURealtimeGuard::EViolation::Allocation);
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept
+{
+	AURealtimeGuard::Report(AURealtimeGuard::EViolation::Allocation);
+	return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept
+{
+	AURealtimeGuard::Report(AURealtimeGuard::EViolation::Allocation);
+	return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) noexcept
+{
+	if (ptr != nullptr) {
+		AURealtimeGuard::Report(AURealtimeGuard::EViolation::Deallocation);
+	}
+	__libc_free(ptr);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept
+{
+	AURealtimeGuard::Report(AURealtimeGuard::EViolation::Allocation);
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** outPtr, size_t alignment, size_t size) noexcept
+{
+	AURealtimeGuard::Report(AURealtimeGuard::EViolation::Allocation);
+	if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) {
+		return EINVAL;
+	}
+	void* const ptr = __libc_memalign(alignment, size);
+	if (ptr == nullptr) {
+		return ENOMEM;
+	}
+	*outPtr = ptr;
+	return 0;
+}
+
+// pthread_mutex_lock has no exported alias, so it is looked up on first use. The dynamic linker
+// takes its own locks internally, not through this symbol, so the lookup cannot recurse.
+int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept
+{
+	using MutexLock = int (*)(pthread_mutex_t*);
+	static std::atomic<MutexLock> sMutexLock{ nullptr };
+
+	AURealtimeGuard::Report(AURealtimeGuard::EViolation::Lock);
+	MutexLock lock = sMutexLock.load(std::memory_order_relaxed);
+	if (lock == nullptr) {
+		lock = reinterpret_cast<MutexLock>(dlsym(RTLD_NEXT, "pthread_mutex_lock")); // NOLINT
+		sMutexLock.store(lock, std::memory_order_relaxed);
+	}
+	return lock(mutex);
+}
+
+ssize_t read(int fd, void* buf, size_t count)
+{
+	AURealtimeGuard::Report(AURealtimeGuard::EViolation::SystemCall);
+	return __read(fd, buf, count);
+}
+
+ssize_t write(int fd, const void* buf, size_t count)
+{
+	AURealtimeGuard::Report(AURealtimeGuard::EViolation::SystemCall);
+	return __write(fd, buf, count);
+}
+
+int nanosleep(const timespec* duration, timespec* remaining)
+{
+	AURealtimeGuard::Report(AURealtimeGuard::EViolation::SystemCall);
+	return __nanosleep(duration, remaining);
+}
+} // extern "C"
+
+#else
+
+// Elsewhere only the C++ allocation functions are replaced; the array, nothrow and sized forms
+// forward to these.
+void* operator new(size_t size)
+{
+	AURealtimeGuard::Report(AURealtimeGuard::EViolation::Allocation);
+	if (void* const ptr = std::malloc(size)) { // NOLINT
+		return ptr;
+	}
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+	if (ptr != nullptr) {
+		AURealtimeGuard::Report(AURealtimeGuard::EViolation::Deallocation);
+	}
+	std::free(ptr); // NOLINT
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	AURealtimeGuard::Report(AURealtimeGuard::EViolation::Allocation);
+	void* ptr = nullptr;
+	if (posix_memalign(&ptr, std::max(static_cast<size_t>(alignment), sizeof(void*)), size) ==
+		0) {
+		return ptr;
+	}
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr, std::align_val_t /*alignment*/) noexcept
+{
+	if (ptr != nullptr) {
+		AURealtimeGuard::Report(AURealtimeGuard::EViolation::Deallocation);
+	}
+	std::free(ptr); // NOLINT
+}
+
+#endif // defined(__GLIBC__)
+
+#else // AUSDK_REALTIME_GUARD
+
+namespace ausdk {
+
+void AURealtimeGuard::Report(EViolation /*inKind*/) noexcept {}
+
+AURealtimeGuard::Statistics AURealtimeGuard::GetStatistics() noexcept { return {}; }
+
+void AURealtimeGuard::ResetStatistics() noexcept {}
+
+size_t AURealtimeGuard::CopyViolations(
+	Violation* /*outViolations*/, size_t /*inCapacity*/) noexcept
+{
+	return 0;
+}
+
+void AURealtimeGuard::SetViolationHandler(ViolationHandler /*inHandler*/) noexcept {}
+
+} // namespace ausdk
+
+#endif // AUSDK_REALTIME_GUARD
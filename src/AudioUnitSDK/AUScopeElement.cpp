@@ -3,6 +3,7 @@
 	@copyright	© 2000-2023 Apple Inc. All rights reserved.
 */
 #include <AudioUnitSDK/AUBase.h>
+#include <AudioUnitSDK/AUFormatConversion.h>
 #include <AudioUnitSDK/AUScopeElement.h>
 #include <AudioUnitSDK/AUUtility.h>
 
@@ -15,10 +16,311 @@
 #include <bit>
 #include <cstring>
 #include <numeric>
+#include <thread>
 #include <utility>
+#include <vector>
 
 namespace ausdk {
 
+namespace {
+
+// The innermost AURenderEpoch::Scope on this thread.
+thread_local const AURenderEpoch::Scope* tInnermostRenderScope = nullptr;
+
+} // namespace
+
+//_____________________________________________________________________________
+//
+AURenderEpoch::Scope::Scope(AURenderEpoch& inEpoch) noexcept
+	: Scope{ inEpoch, inEpoch.IsRenderingOnCurrentThread() ? nullptr : &inEpoch }
+{
+}
+
+//_____________________________________________________________________________
+//
+AURenderEpoch::Scope::Scope(const AURenderEpoch& inEpoch, AURenderEpoch* inCounted) noexcept
+	: mEpoch{ inEpoch }, mOuter{ tInnermostRenderScope }, mCounted{ inCounted }
+{
+	if (mCounted != nullptr) {
+		mCounted->mCount.fetch_add(1);
+	}
+	tInnermostRenderScope = this;
+}
+
+//_____________________________________________________________________________
+//
+AURenderEpoch::Scope::~Scope()
+{
+	tInnermostRenderScope = mOuter;
+	if (mCounted != nullptr) {
+		mCounted->mCount.fetch_add(1);
+	}
+}
+
+//_____________________________________________________________________________
+//
+bool AURenderEpoch::IsRenderingOnCurrentThread() const noexcept
+{
+	for (const Scope* scope = tInnermostRenderScope; scope != nullptr; scope = scope->mOuter) {
+		if (&scope->mEpoch == this) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//_____________________________________________________________________________
+//
+AUParameterTable::AUParameterTable(const AURenderEpoch& inRenderEpoch)
+	: mRenderEpoch{ inRenderEpoch }, mCurrent{ new Snapshot{} }
+{
+}
+
+//_____________________________________________________________________________
+//
+AUParameterTable::~AUParameterTable() { delete mCurrent.load(); }
+
+//_____________________________________________________________________________
+//
+//	A reader on the unit's render thread takes no further steps: the writer keeps what it
+//	replaces until the render has ended. Other readers announce themselves under the current
+//	phase, which the writer flips and drains twice, so that a reader which read the phase just
+//	before a flip is waited for too.
+//
+AUParameterTable::Reader::Reader(const AUParameterTable& inTable) noexcept
+	: mTable{ inTable }, mPhase{ kRenderThread }
+{
+	if (!inTable.mRenderEpoch.IsRenderingOnCurrentThread()) {
+		mPhase = inTable.mReaderPhase.load() & 1u;
+		inTable.mReaders[mPhase].fetch_add(1); // NOLINT index
+	}
+	mSnapshot = inTable.mCurrent.load();
+}
+
+//_____________________________________________________________________________
+//
+AUParameterTable::Reader::~Reader()
+{
+	if (mPhase != kRenderThread) {
+		mTable.mReaders[mPhase].fetch_sub(1); // NOLINT index
+	}
+}
+
+//_____________________________________________________________________________
+//
+UInt32 AUParameterTable::Snapshot::Find(AudioUnitParameterID inParamID) const noexcept
+{
+	if (mIndexed) {
+		return inParamID < mSize ? inParamID : kNoSlot;
+	}
+	const auto i = mSlots.find(inParamID);
+	return i != mSlots.end() ? i->second : kNoSlot;
+}
+
+//_____________________________________________________________________________
+//
+UInt32 AUParameterTable::Snapshot::FindFrom(
+	AudioUnitParameterID inParamID, size_t& ioHint) const noexcept
+{
+	if (mIndexed) {
+		return Find(inParamID);
+	}
+	const auto before = [](const auto& entry, AudioUnitParameterID paramID) {
+		return entry.first < paramID;
+	};
+	auto first = mSlots.begin();
+	auto last = mSlots.end();
+	const auto hint =
+		std::next(first, static_cast<std::ptrdiff_t>(std::min(ioHint, mSlots.size())));
+	if (hint == last || !before(*hint, inParamID)) {
+		last = hint;
+	} else {
+		// gallop forwards from the hint, then search within the last step
+		auto low = hint;
+		std::ptrdiff_t step = 1;
+		while (std::distance(low, last) > step && before(*std::next(low, step), inParamID)) {
+			std::advance(low, step);
+			step *= 2;
+		}
+		if (std::distance(low, last) > step) {
+			last = std::next(low, step);
+		}
+		first = std::next(low);
+	}
+	const auto i = std::lower_bound(first, last, inParamID, before);
+	ioHint = static_cast<size_t>(std::distance(mSlots.begin(), i));
+	return i != mSlots.end() && i->first == inParamID ? i->second : kNoSlot;
+}
+
+//_____________________________________________________________________________
+//
+void AUParameterTable::UseIndexed(UInt32 inCount)
+{
+	const std::lock_guard lock{ mWriterMutex };
+	auto snapshot = std::make_unique<Snapshot>();
+	snapshot->mIndexed = true;
+	snapshot->mSize = inCount;
+	for (UInt32 first = 0; first < inCount; first += kSlotsPerSegment) {
+		Segment& segment = *mSegments.emplace_back(std::make_unique<Segment>());
+		std::iota(segment.mParamIDs.begin(), segment.mParamIDs.end(), first);
+		snapshot->mSegments.push_back(&segment);
+	}
+	Publish(std::move(snapshot));
+	mLayout.fetch_add(1, std::memory_order_release);
+}
+
+//_____________________________________________________________________________
+//
+UInt32 AUParameterTable::Insert(
+	AudioUnitParameterID inParamID, AudioUnitParameterValue inValue, bool inConcurrent)
+{
+	const std::lock_guard lock{ mWriterMutex };
+	ReclaimRetired();
+
+	Snapshot& current = *mCurrent.load();
+	if (const UInt32 slot = current.Find(inParamID); slot != kNoSlot) {
+		current.EntryAt(slot).Store(inValue);
+		return slot;
+	}
+
+	if (current.mIndexed) {
+		return kNoSlot;
+	}
+	const UInt32 slot = current.mSize;
+	Segment* newSegment = nullptr;
+	if (slot == current.mSegments.size() * kSlotsPerSegment) {
+		newSegment = mSegments.emplace_back(std::make_unique<Segment>()).get();
+	}
+	const auto add = [&](Snapshot& snapshot) {
+		if (newSegment != nullptr) {
+			snapshot.mSegments.push_back(newSegment);
+		}
+		snapshot.mSlots[inParamID] = slot;
+		snapshot.mSize = slot + 1;
+		snapshot.mSegments.back()->mParamIDs[slot % kSlotsPerSegment] = inParamID;
+		snapshot.ValueAt(slot).store(inValue, std::memory_order_relaxed);
+	};
+
+	// Before initialization nothing reads concurrently, so the catalog grows in place rather than
+	// being copied for each parameter defined.
+	if (!inConcurrent) {
+		add(current);
+		return slot;
+	}
+	auto snapshot = std::make_unique<Snapshot>(current);
+	add(*snapshot);
+	Publish(std::move(snapshot));
+	return slot;
+}
+
+//_____________________________________________________________________________
+//
+void AUParameterTable::Publish(std::unique_ptr<Snapshot> inSnapshot)
+{
+	std::unique_ptr<Snapshot> previous{ mCurrent.exchange(inSnapshot.release()) };
+
+	for (int flip = 0; flip < 2; ++flip) {
+		const UInt32 phase = mReaderPhase.fetch_xor(1u) & 1u;
+		while (mReaders[phase].load() != 0) { // NOLINT index
+			std::this_thread::yield();
+		}
+	}
+
+	const UInt64 renderEpoch = mRenderEpoch.Get();
+	if (!mRenderEpoch.HasPassed(renderEpoch)) {
+		mRetired.push_back({ std::move(previous), renderEpoch });
+	}
+}
+
+//_____________________________________________________________________________
+//
+void AUParameterTable::ReclaimRetired()
+{
+	std::erase_if(mRetired,
+		[this](const Retired& retired) { return mRenderEpoch.HasPassed(retired.mRenderEpoch); });
+}
+
+//_____________________________________________________________________________
+//
+size_t AUParameterTable::RetiredSnapshotCount() const
+{
+	const std::lock_guard lock{ mWriterMutex };
+	return mRetired.size();
+}
+
+//_____________________________________________________________________________
+//
+bool AUParameterTable::IsIndexed() const noexcept
+{
+	const Reader snapshot{ *this };
+	return snapshot->mIndexed;
+}
+
+//_____________________________________________________________________________
+//
+UInt32 AUParameterTable::Size() const noexcept
+{
+	const Reader snapshot{ *this };
+	return snapshot->mSize;
+}
+
+//_____________________________________________________________________________
+//
+UInt32 AUParameterTable::FindSlot(AudioUnitParameterID inParamID) const noexcept
+{
+	const Reader snapshot{ *this };
+	return snapshot->Find(inParamID);
+}
+
+//_____________________________________________________________________________
+//
+AUParameterTable::Entry AUParameterTable::EntryAt(UInt32 inSlot) const noexcept
+{
+	const Reader snapshot{ *this };
+	return snapshot->EntryAt(inSlot);
+}
+
+//_____________________________________________________________________________
+//
+AUParameterTable::Entry AUParameterTable::FindEntry(AudioUnitParameterID inParamID) const noexcept
+{
+	const Reader snapshot{ *this };
+	const UInt32 slot = snapshot->Find(inParamID);
+	return slot != kNoSlot ? snapshot->EntryAt(slot) : Entry{};
+}
+
+//_____________________________________________________________________________
+//
+AUParameterRamp* AUParameterTable::FindRamp(AudioUnitParameterID inParamID) const noexcept
+{
+	const Reader snapshot{ *this };
+	const UInt32 slot = snapshot->Find(inParamID);
+	return slot != kNoSlot ? &snapshot->RampAt(slot) : nullptr;
+}
+
+//_____________________________________________________________________________
+//
+void AUParameterTable::CollectChanged(std::vector<AudioUnitParameterID>& outParamIDs) const
+{
+	const Reader snapshot{ *this };
+	for (Segment* const segment : snapshot->mSegments) {
+		if (segment->mChanged.load(std::memory_order_relaxed) == 0) {
+			continue;
+		}
+		for (UInt64 changed = segment->mChanged.exchange(0, std::memory_order_acquire);
+			 changed != 0; changed &= changed - 1) {
+			outParamIDs.push_back(segment->mParamIDs[std::countr_zero(changed)]); // NOLINT
+		}
+	}
+}
+
+//_____________________________________________________________________________
+//
+AUElement::AUElement(AUBase& audioUnit)
+	: mAudioUnit(audioUnit), mParameters(audioUnit.GetRenderEpoch())
+{
+}
+
 //_____________________________________________________________________________
 //
 //	By default, parameterIDs may be arbitrarily spaced, and a flat map
@@ -29,8 +331,16 @@ namespace ausdk {
 //
 void AUElement::UseIndexedParameters(UInt32 inNumberOfParameters)
 {
-	mIndexedParameters.resize(inNumberOfParameters);
-	mUseIndexedParameters = true;
+	mParameters.UseIndexed(inNumberOfParameters);
+}
+
+//_____________________________________________________________________________
+//
+AUParameterTable::Entry AUElement::GetEntry(AudioUnitParameterID paramID) const
+{
+	const AUParameterTable::Entry entry = mParameters.FindEntry(paramID);
+	ausdk::ThrowExceptionIf(!entry.IsValid(), kAudioUnitErr_InvalidParameter);
+	return entry;
 }
 
 //_____________________________________________________________________________
@@ -40,11 +350,7 @@ void AUElement::UseIndexedParameters(UInt32 inNumberOfParameters)
 //
 bool AUElement::HasParameterID(AudioUnitParameterID paramID) const
 {
-	if (mUseIndexedParameters) {
-		return paramID < mIndexedParameters.size();
-	}
-
-	return mParameters.find(paramID) != mParameters.end();
+	return mParameters.FindSlot(paramID) != AUParameterTable::kNoSlot;
 }
 
 //_____________________________________________________________________________
@@ -53,14 +359,26 @@ bool AUElement::HasParameterID(AudioUnitParameterID paramID) const
 //
 AudioUnitParameterValue AUElement::GetParameter(AudioUnitParameterID paramID) const
 {
-	if (mUseIndexedParameters) {
-		ausdk::ThrowExceptionIf(
-			paramID >= mIndexedParameters.size(), kAudioUnitErr_InvalidParameter);
-		return mIndexedParameters[paramID].load(std::memory_order_acquire);
-	}
-	const auto i = mParameters.find(paramID);
-	ausdk::ThrowExceptionIf(i == mParameters.end(), kAudioUnitErr_InvalidParameter);
-	return i->second.load(std::memory_order_acquire);
+	return GetEntry(paramID).GetValue().load(std::memory_order_acquire);
+}
+
+//_____________________________________________________________________________
+//
+AUParameterHandle AUElement::GetParameterHandle(AudioUnitParameterID paramID) const
+{
+	// Taken before the lookup, so that a concurrent move leaves the handle stale, not wrong.
+	const UInt32 layout = mParameters.GetLayout();
+	const UInt32 slot = mParameters.FindSlot(paramID);
+	ausdk::ThrowExceptionIf(slot == AUParameterTable::kNoSlot, kAudioUnitErr_InvalidParameter);
+	return { mParameters.EntryAt(slot), slot, layout };
+}
+
+//_____________________________________________________________________________
+//
+const AtomicValue<AudioUnitParameterValue>& AUElement::GetParameterStorage(
+	AudioUnitParameterID paramID) const
+{
+	return GetEntry(paramID).GetValue();
 }
 
 //_____________________________________________________________________________
@@ -68,62 +386,143 @@ AudioUnitParameterValue AUElement::GetParameter(AudioUnitParameterID paramID) co
 void AUElement::SetParameter(
 	AudioUnitParameterID paramID, AudioUnitParameterValue inValue, bool okWhenInitialized)
 {
-	if (mUseIndexedParameters) {
-		ausdk::ThrowExceptionIf(
-			paramID >= mIndexedParameters.size(), kAudioUnitErr_InvalidParameter);
-		mIndexedParameters[paramID].store(inValue, std::memory_order_release);
+	if (const AUParameterTable::Entry entry = mParameters.FindEntry(paramID); entry.IsValid()) {
+		entry.Store(inValue);
+		return;
+	}
+	ausdk::ThrowExceptionIf(mParameters.IsIndexed(), kAudioUnitErr_InvalidParameter);
+
+	const bool initialized = mAudioUnit.IsInitialized();
+	if (initialized && !okWhenInitialized) {
+		// The AU should not be creating new parameters once initialized.
+		// If a client tries to set an undefined parameter, we could throw as follows,
+		// but this might cause a regression. So it is better to just fail silently.
+		// Throw(kAudioUnitErr_InvalidParameter);
+		AUSDK_LogError("Warning: %s SetParameter for undefined param ID %u while initialized. "
+					   "Ignoring.",
+			mAudioUnit.GetLoggingString(), static_cast<unsigned>(paramID));
 	} else {
-		const auto i = mParameters.find(paramID);
-
-		if (i == mParameters.end()) {
-			if (mAudioUnit.IsInitialized() && !okWhenInitialized) {
-				// The AU should not be creating new parameters once initialized.
-				// If a client tries to set an undefined parameter, we could throw as follows,
-				// but this might cause a regression. So it is better to just fail silently.
-				// Throw(kAudioUnitErr_InvalidParameter);
-				AUSDK_LogError(
-					"Warning: %s SetParameter for undefined param ID %u while initialized. "
-					"Ignoring.",
-					mAudioUnit.GetLoggingString(), static_cast<unsigned>(paramID));
-			} else {
-				// create new entry in map for the paramID (only happens first time)
-				mParameters[paramID] = ParameterValue{ inValue };
+		// create new slot and catalog entry for the paramID (only happens first time)
+		mParameters.Insert(paramID, inValue, initialized);
+	}
+}
+
+//_____________________________________________________________________________
+//
+void AUElement::GetParameters(AUParameterItem* ioItems, UInt32 inNumItems) const
+{
+	mParameters.FindEntries(
+		ioItems, inNumItems, [](AUParameterItem& item, const AUParameterTable::Entry& entry) {
+			ausdk::ThrowExceptionIf(!entry.IsValid(), kAudioUnitErr_InvalidParameter);
+			item.mValue = entry.GetValue().load(std::memory_order_acquire);
+		});
+}
+
+//_____________________________________________________________________________
+//
+void AUElement::SetParameters(const AUParameterItem* inItems, UInt32 inNumItems)
+{
+	const AUParameterItem* firstUndefined = nullptr;
+	mParameters.FindEntries(inItems, inNumItems,
+		[&firstUndefined](const AUParameterItem& item, const AUParameterTable::Entry& entry) {
+			if (entry.IsValid()) {
+				entry.Store(item.mValue);
+			} else if (firstUndefined == nullptr) {
+				firstUndefined = &item;
 			}
-		} else {
-			// paramID already exists in map so simply change its value
-			i->second.store(inValue, std::memory_order_release);
-		}
+		});
+	if (firstUndefined == nullptr) {
+		return;
+	}
+	// Defining a parameter waits for lookups to finish, so it cannot happen within one. From the
+	// first undefined parameter on, set them one by one, so that the values set last still win.
+	const auto* const end = inItems + inNumItems; // NOLINT ptr math
+	for (const auto* item = firstUndefined; item != end; ++item) { // NOLINT ptr math
+		SetParameter(item->mParameterID, item->mValue);
 	}
 }
 
 //_____________________________________________________________________________
 //
 void AUElement::SetScheduledEvent(AudioUnitParameterID paramID,
-	const AudioUnitParameterEvent& inEvent, UInt32 /*inSliceOffsetInBuffer*/,
-	UInt32 /*inSliceDurationFrames*/, bool okWhenInitialized)
+	const AudioUnitParameterEvent& inEvent, UInt32 inSliceOffsetInBuffer,
+	UInt32 inSliceDurationFrames, bool okWhenInitialized)
 {
-	if (inEvent.eventType != kParameterEvent_Immediate) {
-		AUSDK_LogError("Warning: %s was passed a ramped parameter event but does not implement "
-					   "them. Ignoring.",
-			mAudioUnit.GetLoggingString());
+	AUParameterRamp* const ramp = mParameters.FindRamp(paramID);
+	if (inEvent.eventType != kParameterEvent_Ramped) {
+		if (ramp != nullptr && ramp->IsActive()) {
+			ramp->Stop();
+			--mActiveRamps;
+		}
+		SetParameter(paramID, inEvent.eventValues.immediate.value, okWhenInitialized); // NOLINT
 		return;
 	}
-	SetParameter(paramID, inEvent.eventValues.immediate.value, okWhenInitialized); // NOLINT
+	if (ramp == nullptr) {
+		return; // an undefined parameter; SetParameter() would ignore it too
+	}
+	if (!ramp->IsActive()) {
+		++mActiveRamps;
+	}
+	ramp->Start(inEvent);
+	SetParameter(paramID,
+		ramp->ValueAt(static_cast<SInt64>(inSliceOffsetInBuffer) + inSliceDurationFrames),
+		okWhenInitialized);
 }
 
 //_____________________________________________________________________________
 //
-void AUElement::GetParameterList(AudioUnitParameterID* outList)
+void AUElement::FillParameterValues(AudioUnitParameterID paramID,
+	AudioUnitParameterValue* outValues, UInt32 inNumValues, UInt32 inStartFrame,
+	UInt32 inFrameStep) const
 {
-	if (mUseIndexedParameters) {
-		const auto numParams = std::ssize(mIndexedParameters);
-		std::iota(outList, std::next(outList, numParams), 0);
+	const AUParameterRamp* const ramp = mParameters.FindRamp(paramID);
+	if (ramp != nullptr && ramp->IsActive()) {
+		ramp->Fill(outValues, inNumValues, inStartFrame, inFrameStep);
 	} else {
-		std::transform(mParameters.cbegin(), mParameters.cend(), outList,
-			[](const auto& keyValue) { return keyValue.first; });
+		std::fill_n(outValues, inNumValues, GetParameter(paramID));
 	}
 }
 
+//_____________________________________________________________________________
+//
+bool AUElement::IsParameterRamping(AudioUnitParameterID paramID) const
+{
+	const AUParameterRamp* const ramp = mParameters.FindRamp(paramID);
+	return ramp != nullptr && ramp->IsActive();
+}
+
+//_____________________________________________________________________________
+//
+void AUElement::SetParameterRampCurve(
+	AudioUnitParameterID paramID, AUParameterRamp::ECurve inCurve)
+{
+	AUParameterRamp* const ramp = mParameters.FindRamp(paramID);
+	ausdk::ThrowExceptionIf(ramp == nullptr, kAudioUnitErr_InvalidParameter);
+	ramp->SetCurve(inCurve);
+}
+
+//_____________________________________________________________________________
+//
+void AUElement::EndParameterRamps() noexcept
+{
+	if (mActiveRamps == 0) {
+		return;
+	}
+	mParameters.ForEach([](AudioUnitParameterID /*paramID*/, AUParameterTable::Value& /*value*/,
+							AUParameterRamp& ramp) { ramp.Stop(); });
+	mActiveRamps = 0;
+}
+
+//_____________________________________________________________________________
+//
+void AUElement::GetParameterList(AudioUnitParameterID* outList)
+{
+	mParameters.ForEach([&outList](AudioUnitParameterID paramID,
+							AUParameterTable::Value& /*value*/, AUParameterRamp& /*ramp*/) {
+		*outList++ = paramID; // NOLINT ptr math
+	});
+}
+
 //_____________________________________________________________________________
 //
 void AUElement::SaveState(AudioUnitScope scope, CFMutableDataRef data)
@@ -162,15 +561,15 @@ void AUElement::SaveState(AudioUnitScope scope, CFMutableDataRef data)
 	constexpr UInt32 placeholderCount = 0;
 	appendBytes(placeholderCount);
 
-	if (mUseIndexedParameters) {
-		const auto numParams = static_cast<UInt32>(mIndexedParameters.size());
-		for (UInt32 i = 0; i < numParams; i++) {
-			appendParameter(i, mIndexedParameters[i]);
-		}
-	} else {
-		for (const auto& item : mParameters) {
-			appendParameter(item.first, item.second);
-		}
+	// GetParameterInfo() may define parameters, so it is not called while reading the table.
+	std::vector<std::pair<AudioUnitParameterID, AudioUnitParameterValue>> parameters;
+	parameters.reserve(mParameters.Size());
+	mParameters.ForEach([&parameters](AudioUnitParameterID paramID,
+							AUParameterTable::Value& value, AUParameterRamp& /*ramp*/) {
+		parameters.emplace_back(paramID, value.load());
+	});
+	for (const auto& [paramID, value] : parameters) {
+		appendParameter(paramID, value);
 	}
 
 	const auto count_BE = CFSwapInt32HostToBig(paramsWritten);
@@ -216,6 +615,7 @@ AUIOElement::AUIOElement(AUBase& audioUnit) : AUElement(audioUnit), mWillAllocat
 OSStatus AUIOElement::SetStreamFormat(const AudioStreamBasicDescription& format)
 {
 	mStreamFormat = format;
+	mConvertsToPlanar = mUsesPlanarConversion && FormatConversion::IsConvertible(mStreamFormat);
 
 	// Clear the previous channel layout if it is inconsistent with the newly set format;
 	// preserve it if it is acceptable, in case the new format has no layout.
@@ -230,18 +630,126 @@ OSStatus AUIOElement::SetStreamFormat(const AudioStreamBasicDescription& format)
 // inFramesToAllocate == 0 implies the AudioUnit's max-frames-per-slice will be used
 void AUIOElement::AllocateBuffer(UInt32 inFramesToAllocate)
 {
+	mConvertsToPlanar = mUsesPlanarConversion && FormatConversion::IsConvertible(mStreamFormat);
+	mPlanarFramesPending = 0;
+
 	if (GetAudioUnit().HasBegunInitializing()) {
 		UInt32 framesToAllocate =
 			inFramesToAllocate > 0 ? inFramesToAllocate : GetAudioUnit().GetMaxFramesPerSlice();
 
-		mIOBuffer.Allocate(
-			mStreamFormat, (mWillAllocate && NeedsBufferSpace()) ? framesToAllocate : 0);
+		const bool needsSpace = mWillAllocate && NeedsBufferSpace();
+		const UInt32 nStreams = ASBD::NumberChannelStreams(mStreamFormat);
+		const size_t scratchBytes =
+			nStreams * AUScratchArena::AllocationSize(
+						   static_cast<size_t>(framesToAllocate) * mStreamFormat.mBytesPerFrame);
+		mScratchFrames = (needsSpace && mBufferAllocation == EBufferAllocation::SharedScratch &&
+							 scratchBytes <= AUScratchArena::Capacity())
+							 ? framesToAllocate
+							 : 0;
+
+		// with shared scratch this is the fallback for a render which finds no arena free
+		mIOBuffer.Allocate(mStreamFormat, needsSpace ? framesToAllocate : 0,
+			&GetAudioUnit().GetBufferAllocator());
+		mScratchFallbacks.store(0, std::memory_order_relaxed);
+
+		if (mConvertsToPlanar) {
+			mPlanarBuffer.Allocate(
+				GetPlanarFormat(), framesToAllocate, &GetAudioUnit().GetBufferAllocator());
+		} else {
+			mPlanarBuffer.Deallocate();
+		}
+
+		// DoInitialize() prefaults the buffers it allocates; these are reallocated afterwards,
+		// e.g. by a new connection or stream format, and would otherwise fault during render
+		if (GetAudioUnit().IsInitialized() &&
+			GetAudioUnit().GetBufferAllocator().GetPageTouchPolicy() ==
+				BufferAllocator::EPageTouchPolicy::PrefaultOnInitialize) {
+			PrefaultBuffer();
+		}
+	}
+}
+
+//_____________________________________________________________________________
+//
+void AUIOElement::SetUsesPlanarConversion(bool inFlag) noexcept
+{
+	mUsesPlanarConversion = inFlag;
+	mConvertsToPlanar = mUsesPlanarConversion && FormatConversion::IsConvertible(mStreamFormat);
+}
+
+//_____________________________________________________________________________
+//
+AudioStreamBasicDescription AUIOElement::GetPlanarFormat() const noexcept
+{
+	return mConvertsToPlanar ? FormatConversion::PlanarFormat(mStreamFormat) : mStreamFormat;
+}
+
+//_____________________________________________________________________________
+//
+void AUIOElement::ConvertToPlanar(UInt32 nFrames)
+{
+	if (mConvertsToPlanar) {
+		FormatConversion::ToPlanar(mStreamFormat, mIOBuffer.GetBufferList(),
+			mPlanarBuffer.PrepareBuffer(GetPlanarFormat(), nFrames), nFrames);
+	}
+}
+
+//_____________________________________________________________________________
+//
+AudioBufferList& AUIOElement::PreparePlanarBuffer(UInt32 nFrames)
+{
+	if (!mConvertsToPlanar) {
+		return mIOBuffer.GetBufferList();
+	}
+	mPlanarFramesPending = nFrames;
+	return mPlanarBuffer.PrepareBuffer(GetPlanarFormat(), nFrames);
+}
+
+//_____________________________________________________________________________
+//
+void AUIOElement::CommitPlanarBuffer()
+{
+	if (mPlanarFramesPending > 0) {
+		const UInt32 nFrames = mPlanarFramesPending;
+		mPlanarFramesPending = 0;
+		FormatConversion::FromPlanar(mPlanarBuffer.GetBufferList(), mStreamFormat,
+			mIOBuffer.GetBufferList(), nFrames, &mDitherer);
+		mIOBuffer.MarkModified();
+	}
+}
+
+//_____________________________________________________________________________
+//
+AudioBufferList& AUIOElement::PrepareScratchBuffer(UInt32 nFrames)
+{
+	ThrowExceptionIf(nFrames > mScratchFrames, kAudioUnitErr_TooManyFramesToProcess);
+	if (AUScratchArena* const arena = AUScratchArena::Current(); arena != nullptr) {
+		AudioBufferList& abl = mIOBuffer.PrepareNullBuffer(mStreamFormat, nFrames);
+		bool allocated = true;
+		for (UInt32 i = 0; i < abl.mNumberBuffers && allocated; ++i) {
+			AudioBuffer& buf = abl.mBuffers[i]; // NOLINT
+			buf.mData = arena->Allocate(buf.mDataByteSize);
+			allocated = buf.mData != nullptr;
+		}
+		if (allocated) {
+			return abl;
+		}
+		// what was allocated is released with the render's AUScratchArena::Scope
 	}
+	mScratchFallbacks.store(
+		mScratchFallbacks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	return mIOBuffer.PrepareBuffer(mStreamFormat, nFrames);
 }
 
 //_____________________________________________________________________________
 //
-void AUIOElement::DeallocateBuffer() { mIOBuffer.Deallocate(); }
+void AUIOElement::DeallocateBuffer()
+{
+	mIOBuffer.Deallocate();
+	mPlanarBuffer.Deallocate();
+	mScratchFrames = 0;
+	mPlanarFramesPending = 0;
+}
 
 //_____________________________________________________________________________
 //
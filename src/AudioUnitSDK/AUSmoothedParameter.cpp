@@ -0,0 +1,175 @@
+/*!
+	@file		AudioUnitSDK/AUSmoothedParameter.cpp
+	@copyright	© 2000-2023 Apple Inc. All rights reserved.
+*/
+#include <AudioUnitSDK/AUSmoothedParameter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ausdk {
+
+namespace {
+
+using SmootherVector = float __attribute__((vector_size(16)));
+constexpr UInt32 kSmootherVectorLanes = sizeof(SmootherVector) / sizeof(float);
+
+// A one-pole smoother snaps to its target once this close, relative to the target's magnitude,
+// rather than approaching it forever.
+constexpr float kSettledDifference = 1.e-6f;
+
+} // namespace
+
+//_____________________________________________________________________________
+//
+AUSmoothedParameter::AUSmoothedParameter(const AtomicValue<AudioUnitParameterValue>& inStorage,
+	ESmoothing inSmoothing, UInt32 inSmoothingFrames) noexcept
+	: mStorage{ &inStorage }
+{
+	SetSmoothing(inSmoothing, inSmoothingFrames);
+	Reset();
+}
+
+//_____________________________________________________________________________
+//
+void AUSmoothedParameter::SetSmoothing(ESmoothing inSmoothing, UInt32 inSmoothingFrames) noexcept
+{
+	mSmoothing = inSmoothingFrames > 0 ? inSmoothing : ESmoothing::None;
+	mSmoothingFrames = inSmoothingFrames;
+	mPoleCoefficient = inSmoothingFrames > 0
+						   ? static_cast<float>(std::exp(-1.0 / inSmoothingFrames))
+						   : 0.f;
+	mLinearFramesRemaining = 0;
+}
+
+//_____________________________________________________________________________
+//
+void AUSmoothedParameter::Reset() noexcept
+{
+	mValue = GetTarget();
+	mLinearTarget = mValue;
+	mLinearFramesRemaining = 0;
+}
+
+//_____________________________________________________________________________
+//
+bool AUSmoothedParameter::IsSettled(AudioUnitParameterValue inTarget) const noexcept
+{
+	return std::fabs(mValue - inTarget) <=
+		   kSettledDifference * std::max(1.f, std::fabs(inTarget));
+}
+
+//_____________________________________________________________________________
+//
+AudioUnitParameterValue AUSmoothedParameter::UpdateLinearTarget() noexcept
+{
+	const AudioUnitParameterValue target = GetTarget();
+	if (target != mLinearTarget) {
+		mLinearTarget = target;
+		mLinearFramesRemaining = mSmoothingFrames;
+		mLinearStep = (target - mValue) / static_cast<float>(mSmoothingFrames);
+	}
+	return target;
+}
+
+//_____________________________________________________________________________
+//
+void AUSmoothedParameter::EndLinearSegment(UInt32 inRampFrames) noexcept
+{
+	mLinearFramesRemaining -= inRampFrames;
+	mValue = mLinearFramesRemaining == 0 ? mLinearTarget
+										 : mValue + mLinearStep * static_cast<float>(inRampFrames);
+}
+
+//_____________________________________________________________________________
+//
+AudioUnitParameterValue AUSmoothedParameter::Process(
+	AudioUnitParameterValue* outValues, UInt32 inNumFrames) noexcept
+{
+	switch (mSmoothing) {
+	case ESmoothing::None:
+		break;
+
+	case ESmoothing::OnePole: {
+		const AudioUnitParameterValue target = GetTarget();
+		if (IsSettled(target)) {
+			break;
+		}
+		// y[i] = target + (y[-1] - target) * c^(i + 1)
+		const float c = mPoleCoefficient;
+		const float c2 = c * c;
+		SmootherVector distances = (mValue - target) * SmootherVector{ 1.f, c, c2, c2 * c };
+		const float vectorCoefficient = c2 * c2;
+		UInt32 i = 0;
+		for (; i + kSmootherVectorLanes <= inNumFrames; i += kSmootherVectorLanes) {
+			const SmootherVector values = target + distances * c;
+			memcpy(outValues + i, &values, sizeof(values)); // NOLINT ptr math
+			distances *= vectorCoefficient;
+		}
+		float distance = distances[0];
+		for (; i < inNumFrames; ++i) {
+			distance *= c;
+			outValues[i] = target + distance; // NOLINT ptr math
+		}
+		mValue = target + distance;
+		if (IsSettled(target)) {
+			mValue = target;
+		}
+		return mValue;
+	}
+
+	case ESmoothing::Linear: {
+		UpdateLinearTarget();
+		const UInt32 rampFrames = std::min(inNumFrames, mLinearFramesRemaining);
+		const float base = mValue + mLinearStep;
+		SmootherVector index{ 0.f, 1.f, 2.f, 3.f };
+		UInt32 i = 0;
+		for (; i + kSmootherVectorLanes <= rampFrames; i += kSmootherVectorLanes) {
+			const SmootherVector values = base + index * mLinearStep;
+			memcpy(outValues + i, &values, sizeof(values)); // NOLINT ptr math
+			index += static_cast<float>(kSmootherVectorLanes);
+		}
+		for (; i < rampFrames; ++i) {
+			outValues[i] = base + static_cast<float>(i) * mLinearStep; // NOLINT ptr math
+		}
+		std::fill(outValues + rampFrames, outValues + inNumFrames, mLinearTarget); // NOLINT
+		EndLinearSegment(rampFrames);
+		return mValue;
+	}
+	}
+
+	mValue = GetTarget();
+	std::fill_n(outValues, inNumFrames, mValue);
+	return mValue;
+}
+
+//_____________________________________________________________________________
+//
+AudioUnitParameterValue AUSmoothedParameter::Advance(UInt32 inNumFrames) noexcept
+{
+	switch (mSmoothing) {
+	case ESmoothing::None:
+		mValue = GetTarget();
+		break;
+
+	case ESmoothing::OnePole: {
+		const AudioUnitParameterValue target = GetTarget();
+		mValue = target + (mValue - target) *
+							  static_cast<float>(std::pow(mPoleCoefficient, inNumFrames));
+		if (IsSettled(target)) {
+			mValue = target;
+		}
+		break;
+	}
+
+	case ESmoothing::Linear: {
+		UpdateLinearTarget();
+		EndLinearSegment(std::min(inNumFrames, mLinearFramesRemaining));
+		break;
+	}
+	}
+	return mValue;
+}
+
+} // namespace ausdk
@@ -0,0 +1,180 @@
+/*!
+	@file		AudioUnitSDK/AUWorkerPool.cpp
+	@copyright	© 2000-2023 Apple Inc. All rights reserved.
+*/
+#include <AudioUnitSDK/AUBuffer.h>
+#include <AudioUnitSDK/AUUtility.h>
+#include <AudioUnitSDK/AUWorkerPool.h>
+
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#include <pthread.h>
+#include <algorithm>
+#include <exception>
+
+namespace ausdk {
+
+namespace {
+
+// Gives the calling thread the time-constraint policy with which the system schedules audio
+// threads: up to half of each period's CPU time, within the period.
+void SetTimeConstraintPolicy(Float64 inPeriodSeconds) noexcept
+{
+	const Float64 ticksPerSecond = HostTime::Frequency();
+	const auto ticks = [ticksPerSecond](Float64 seconds) {
+		return static_cast<uint32_t>(seconds * ticksPerSecond);
+	};
+	// the kernel rejects computation times outside [50 us, 50 ms]
+	const Float64 computation = std::clamp(inPeriodSeconds / 2.0, 50.0e-6, 50.0e-3); // NOLINT
+	thread_time_constraint_policy_data_t policy{ .period = ticks(inPeriodSeconds),
+		.computation = ticks(computation),
+		.constraint = ticks(std::max(inPeriodSeconds, computation)),
+		.preemptible = 1 };
+	const kern_return_t result = thread_policy_set(pthread_mach_thread_np(pthread_self()),
+		THREAD_TIME_CONSTRAINT_POLICY,
+		reinterpret_cast<thread_policy_t>(&policy), // NOLINT reinterpret_cast
+		THREAD_TIME_CONSTRAINT_POLICY_COUNT);
+	if (result != KERN_SUCCESS) {
+		AUSDK_LogError("AUWorkerPool: thread_policy_set failed: %d", static_cast<int>(result));
+	}
+}
+
+// Tells the CPU that the thread is spinning, freeing resources for its sibling hyper-thread.
+inline void SpinPause() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	asm volatile("yield"); // NOLINT asm
+#endif
+}
+
+} // namespace
+
+//_____________________________________________________________________________
+//
+AUWorkerPool::AUWorkerPool(UInt32 inNumWorkers, Float64 inPeriodSeconds)
+	: mPeriodSeconds{ inPeriodSeconds }
+{
+	ThrowExceptionIf(semaphore_create(mach_task_self(), &mWakeSemaphore, SYNC_POLICY_FIFO, 0) !=
+						 KERN_SUCCESS,
+		kAudio_MemFullError);
+	try {
+		mThreads.reserve(inNumWorkers);
+		for (UInt32 worker = 0; worker < inNumWorkers; ++worker) {
+			mThreads.emplace_back([this, participant = worker + 1] { WorkerMain(participant); });
+		}
+	} catch (const std::exception& e) {
+		// e.g. std::system_error when the system is out of threads; the destructor will not run,
+		// and destroying a joinable thread terminates the process
+		AUSDK_LogError("AUWorkerPool: starting worker %zu of %u failed: %s", mThreads.size() + 1,
+			static_cast<unsigned>(inNumWorkers), e.what());
+		Stop();
+		Throw(kAudio_MemFullError);
+	}
+}
+
+//_____________________________________________________________________________
+//
+AUWorkerPool::~AUWorkerPool() { Stop(); }
+
+//_____________________________________________________________________________
+//
+void AUWorkerPool::Stop() noexcept
+{
+	mStopping.store(true, std::memory_order_relaxed);
+	mGeneration.fetch_add(1);
+	for (size_t i = 0; i < mThreads.size(); ++i) {
+		semaphore_signal(mWakeSemaphore);
+	}
+	for (auto& thread : mThreads) {
+		thread.join();
+	}
+	semaphore_destroy(mach_task_self(), mWakeSemaphore);
+}
+
+//_____________________________________________________________________________
+//
+void AUWorkerPool::Run(UInt32 inNumTasks, TaskFunction inFunction, void* inContext) noexcept
+{
+	if (mThreads.empty() || inNumTasks <= 1) {
+		for (UInt32 task = 0; task < inNumTasks; ++task) {
+			inFunction(inContext, task);
+		}
+		return;
+	}
+
+	mFunction = inFunction;
+	mContext = inContext;
+	mNumTasks = inNumTasks;
+	mPending.store(GetNumWorkers(), std::memory_order_relaxed);
+	// Sequentially consistent, with the worker's increment of mParked and re-check of
+	// mGeneration: either the worker sees the new batch, or we see that it is parking. A signal
+	// to a worker which then sees the batch anyway only causes a spurious wake-up later.
+	mGeneration.fetch_add(1);
+	for (UInt32 parked = mParked.load(); parked != 0; --parked) {
+		semaphore_signal(mWakeSemaphore);
+	}
+
+	RunShare(0);
+
+	// when there are more threads than cores, a worker may need this core to finish
+	for (UInt32 spin = 0; mPending.load(std::memory_order_acquire) != 0; ++spin) {
+		if (spin < kSpinIterations) {
+			SpinPause();
+		} else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+//_____________________________________________________________________________
+//
+void AUWorkerPool::RunShare(UInt32 inParticipant) const noexcept
+{
+	const UInt32 participants = GetNumWorkers() + 1;
+	const auto share = [&](UInt32 participant) {
+		return static_cast<UInt32>(static_cast<UInt64>(mNumTasks) * participant / participants);
+	};
+	const UInt32 end = share(inParticipant + 1);
+	for (UInt32 task = share(inParticipant); task < end; ++task) {
+		mFunction(mContext, task);
+	}
+}
+
+//_____________________________________________________________________________
+//
+void AUWorkerPool::WorkerMain(UInt32 inParticipant) noexcept
+{
+	[[maybe_unused]] const DenormalDisabler denormalDisabler;
+	if (mPeriodSeconds > 0.0) {
+		SetTimeConstraintPolicy(mPeriodSeconds);
+	}
+	UInt32 seen = 0;
+	for (;;) {
+		UInt32 generation = mGeneration.load(std::memory_order_acquire);
+		for (UInt32 spin = 0; generation == seen && spin < kSpinIterations; ++spin) {
+			SpinPause();
+			generation = mGeneration.load(std::memory_order_acquire);
+		}
+		if (generation == seen) {
+			mParked.fetch_add(1);
+			if (mGeneration.load() == seen) {
+				semaphore_wait(mWakeSemaphore);
+			}
+			mParked.fetch_sub(1);
+			continue;
+		}
+		seen = generation;
+		if (mStopping.load(std::memory_order_relaxed)) {
+			return;
+		}
+		{
+			[[maybe_unused]] const AUScratchArena::Scope scratchScope;
+			RunShare(inParticipant);
+		}
+		mPending.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+} // namespace ausdk
@@ -291,6 +291,16 @@ void SynthGroupElement::ResetAllControllers([[maybe_unused]] UInt32 inFrame)
 	mMidiControlHandler->Reset();
 }
 
+bool SynthGroupElement::HasSoundingNotes() const
+{
+	for (UInt32 i = 0; i < kNumberOfSoundingNoteStates; ++i) {
+		if (mNoteList[i].NotEmpty()) {
+			return true;
+		}
+	}
+	return false;
+}
+
 OSStatus SynthGroupElement::Render(
 	SInt64 inAbsoluteSampleFrame, UInt32 inNumberFrames, ausdk::AUScope& outputs)
 {
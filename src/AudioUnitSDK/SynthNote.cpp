@@ -64,6 +64,11 @@ Float32 SynthNote::GetGlobalParameter(AudioUnitParameterID inParamID) const
 	return mGroup->GetAudioUnit().Globals()->GetParameter(inParamID);
 }
 
+ausdk::AUParameterHandle SynthNote::GetGlobalParameterHandle(AudioUnitParameterID inParamID) const
+{
+	return mGroup->GetAudioUnit().Globals()->GetParameterHandle(inParamID);
+}
+
 void SynthNote::NoteEnded(UInt32 inFrame)
 {
 	mGroup->NoteEnded(this, inFrame);
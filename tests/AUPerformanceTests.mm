@@ -0,0 +1,832 @@
+/*!
+	@file		AUPerformanceTests.mm
+	@copyright	© 2020-2023 Apple Inc. All rights reserved.
+*/
+#import <XCTest/XCTest.h>
+
+#include <AudioUnitSDK/AudioUnitSDK.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+// A unit whose slices do no DSP, so that only the scheduling of parameter events is measured.
+class SchedulingUnit : public ausdk::AUBase {
+public:
+	class Element : public ausdk::AUOutputElement {
+	public:
+		using AUOutputElement::AUOutputElement;
+
+		void SetScheduledEvent(AudioUnitParameterID /*paramID*/,
+			const AudioUnitParameterEvent& inEvent, UInt32 inSliceOffsetInBuffer,
+			UInt32 /*inSliceDurationFrames*/, bool /*okWhenInitialized*/) override
+		{
+			mLastValue = inEvent.eventType == kParameterEvent_Ramped
+							 ? inEvent.eventValues.ramp.endValue // NOLINT union
+							 : static_cast<float>(inSliceOffsetInBuffer);
+		}
+
+		float mLastValue{};
+	};
+
+	SchedulingUnit() : AUBase(nullptr, 0, 1) {}
+
+	bool CanScheduleParameters() const override { return true; }
+	bool StreamFormatWritable(AudioUnitScope /*scope*/, AudioUnitElement /*element*/) override
+	{
+		return true;
+	}
+	std::unique_ptr<ausdk::AUElement> CreateElement(
+		AudioUnitScope scope, AudioUnitElement element) override
+	{
+		if (scope == kAudioUnitScope_Output) {
+			return std::make_unique<Element>(*this);
+		}
+		return AUBase::CreateElement(scope, element);
+	}
+
+	OSStatus ProcessScheduledSlice(void* /*inUserData*/, UInt32 /*inStartFrameInBuffer*/,
+		UInt32 /*inSliceFramesToProcess*/, UInt32 /*inTotalBufferFrames*/) override
+	{
+		++mSlices;
+		return noErr;
+	}
+
+	OSStatus Process(UInt32 inFrames)
+	{
+		return ProcessForScheduledParams(GetParamEventList(), inFrames, nullptr);
+	}
+	void ClearEvents() { GetParamEventList().clear(); }
+	using AUBase::SetMinimumSliceFrames;
+	using AUBase::SetParameterEventCapacity;
+
+	UInt64 mSlices{};
+};
+
+// A second-order low-pass filter, with its cutoff frequency in global parameter 0, written as
+// per-channel kernels and as one multi-channel kernel.
+struct BiquadCoefficients {
+	BiquadCoefficients(double cutoff, double sampleRate)
+	{
+		const double omega = 2.0 * M_PI * cutoff / sampleRate;
+		const double cosOmega = std::cos(omega);
+		const double alpha = std::sin(omega) / (2.0 * M_SQRT1_2);
+		const double a0 = 1.0 + alpha;
+		b0 = b2 = static_cast<float>((1.0 - cosOmega) / 2.0 / a0);
+		b1 = static_cast<float>((1.0 - cosOmega) / a0);
+		a1 = static_cast<float>(-2.0 * cosOmega / a0);
+		a2 = static_cast<float>((1.0 - alpha) / a0);
+	}
+
+	float b0, b1, b2, a1, a2;
+};
+
+class BiquadKernel : public ausdk::AUKernelBase {
+public:
+	using AUKernelBase::AUKernelBase;
+
+	void Reset() override { mZ1 = mZ2 = 0.f; }
+
+	void Process(const Float32* inSourceP, Float32* inDestP, UInt32 inFramesToProcess,
+		bool& /*ioSilence*/) override
+	{
+		const BiquadCoefficients k{ GetParameter(0), GetSampleRate() };
+		for (UInt32 i = 0; i < inFramesToProcess; ++i) {
+			const float x = inSourceP[i];
+			const float y = k.b0 * x + mZ1;
+			mZ1 = k.b1 * x - k.a1 * y + mZ2;
+			mZ2 = k.b2 * x - k.a2 * y;
+			inDestP[i] = y;
+		}
+	}
+
+private:
+	float mZ1{};
+	float mZ2{};
+};
+
+class BiquadMultiChannelKernel : public ausdk::AUMultiChannelKernel {
+public:
+	using Lanes = ausdk::AUChannelLanes<8>;
+	using Vector = Lanes::Vector;
+
+	using AUMultiChannelKernel::AUMultiChannelKernel;
+
+	void SetNumberOfChannels(UInt32 inNumChannels) override
+	{
+		AUMultiChannelKernel::SetNumberOfChannels(inNumChannels);
+		mZ1.assign(Lanes::GetGroupCount(inNumChannels), Vector{});
+		mZ2 = mZ1;
+	}
+
+	void Reset() override
+	{
+		std::fill(mZ1.begin(), mZ1.end(), Vector{});
+		std::fill(mZ2.begin(), mZ2.end(), Vector{});
+	}
+
+	void Process(const Float32* const* inSources, Float32* const* inDests,
+		UInt32 inFramesToProcess, bool& /*ioSilence*/) override
+	{
+		const BiquadCoefficients k{ GetParameter(0), GetSampleRate() };
+		const UInt32 numChannels = GetNumberOfChannels();
+		for (UInt32 group = 0; group < mZ1.size(); ++group) {
+			const UInt32 groupChannels = Lanes::GetGroupChannels(numChannels, group);
+			const UInt32 firstChannel = group * Lanes::kLanes;
+			Vector z1 = mZ1[group];
+			Vector z2 = mZ2[group];
+			for (UInt32 frame = 0; frame < inFramesToProcess; frame += kBlockFrames) {
+				const UInt32 frames = std::min(kBlockFrames, inFramesToProcess - frame);
+				Lanes::Pack(inSources + firstChannel, groupChannels, frame, frames, mBlock.data());
+				for (UInt32 i = 0; i < frames; ++i) {
+					const Vector x = mBlock[i];
+					const Vector y = k.b0 * x + z1;
+					z1 = k.b1 * x - k.a1 * y + z2;
+					z2 = k.b2 * x - k.a2 * y;
+					mBlock[i] = y;
+				}
+				Lanes::Unpack(mBlock.data(), frames, inDests + firstChannel, groupChannels, frame);
+			}
+			mZ1[group] = z1;
+			mZ2[group] = z2;
+		}
+	}
+
+private:
+	static constexpr UInt32 kBlockFrames = 64;
+
+	std::vector<Vector> mZ1;
+	std::vector<Vector> mZ2;
+	std::array<Vector, kBlockFrames> mBlock{};
+};
+
+class BiquadUnit : public ausdk::AUEffectBase {
+public:
+	explicit BiquadUnit(bool multiChannel) : AUEffectBase(nullptr), mMultiChannel(multiChannel)
+	{
+	}
+
+	std::unique_ptr<ausdk::AUKernelBase> NewKernel() override
+	{
+		return std::make_unique<BiquadKernel>(*this);
+	}
+
+	std::unique_ptr<ausdk::AUMultiChannelKernel> NewMultiChannelKernel() override
+	{
+		if (!mMultiChannel) {
+			return {};
+		}
+		return std::make_unique<BiquadMultiChannelKernel>(*this);
+	}
+
+private:
+	bool mMultiChannel;
+};
+
+// A long FIR filter per channel, as heavy per-channel DSP.
+class FIRKernel : public ausdk::AUKernelBase {
+public:
+	static constexpr UInt32 kTaps = 512;
+	static constexpr UInt32 kMaxFrames = 4096;
+
+	explicit FIRKernel(ausdk::AUEffectBase& inAudioUnit)
+		: AUKernelBase(inAudioUnit), mCoefficients(kTaps), mHistory(kTaps + kMaxFrames)
+	{
+		for (UInt32 tap = 0; tap < kTaps; ++tap) {
+			mCoefficients[tap] = std::sin(0.01f * static_cast<float>(tap + 1)) / kTaps;
+		}
+	}
+
+	void Reset() override { std::fill(mHistory.begin(), mHistory.end(), 0.f); }
+
+	void Process(const Float32* inSourceP, Float32* inDestP, UInt32 inFramesToProcess,
+		bool& ioSilence) override
+	{
+		// mHistory holds the last kTaps - 1 inputs, then this slice's
+		std::copy(inSourceP, inSourceP + inFramesToProcess, mHistory.begin() + kTaps - 1);
+		for (UInt32 i = 0; i < inFramesToProcess; ++i) {
+			float sum = 0.f;
+			for (UInt32 tap = 0; tap < kTaps; ++tap) {
+				sum += mCoefficients[tap] * mHistory[i + kTaps - 1 - tap];
+			}
+			inDestP[i] = sum;
+		}
+		std::copy(mHistory.begin() + inFramesToProcess,
+			mHistory.begin() + inFramesToProcess + kTaps - 1, mHistory.begin());
+		ioSilence = false;
+	}
+
+private:
+	std::vector<float> mCoefficients;
+	std::vector<float> mHistory;
+};
+
+class FIRUnit : public ausdk::AUEffectBase {
+public:
+	FIRUnit() : AUEffectBase(nullptr) {}
+
+	std::unique_ptr<ausdk::AUKernelBase> NewKernel() override
+	{
+		return std::make_unique<FIRKernel>(*this);
+	}
+};
+
+// A gain of one half, on 8 channels in blocks of 64 frames, written as per-channel kernels and as
+// an AUFixedEffect.
+class GainKernel : public ausdk::AUKernelBase {
+public:
+	using AUKernelBase::AUKernelBase;
+
+	void Process(const Float32* inSourceP, Float32* inDestP, UInt32 inFramesToProcess,
+		bool& ioSilence) override
+	{
+		for (UInt32 i = 0; i < inFramesToProcess; ++i) {
+			inDestP[i] = 0.5f * inSourceP[i];
+		}
+		ioSilence = false;
+	}
+};
+
+class GainUnit : public ausdk::AUEffectBase {
+public:
+	GainUnit() : AUEffectBase(nullptr, false) {}
+
+	std::unique_ptr<ausdk::AUKernelBase> NewKernel() override
+	{
+		return std::make_unique<GainKernel>(*this);
+	}
+};
+
+class FixedGainUnit : public ausdk::AUFixedEffect<8, 64, false> {
+public:
+	FixedGainUnit() : AUFixedEffect(nullptr) {}
+
+	void ProcessBlock(const Sources& inSources, const Dests& inDests, UInt32 inFramesToProcess,
+		bool& ioSilence) override
+	{
+		Gain(inSources, inDests, inFramesToProcess);
+		ioSilence = false;
+	}
+
+	void ProcessFixedBlock(const Sources& inSources, const Dests& inDests, bool& ioSilence) override
+	{
+		Gain(inSources, inDests, kMaxBlock);
+		ioSilence = false;
+	}
+
+private:
+	static void Gain(const Sources& inSources, const Dests& inDests, UInt32 inFrames)
+	{
+		for (UInt32 channel = 0; channel < kChannels; ++channel) {
+			for (UInt32 i = 0; i < inFrames; ++i) {
+				inDests[channel][i] = 0.5f * inSources[channel][i];
+			}
+		}
+	}
+};
+
+// Renders silence into the input of an effect.
+static OSStatus RenderSilence(void* /*inRefCon*/, AudioUnitRenderActionFlags* ioActionFlags,
+	const AudioTimeStamp* /*inTimeStamp*/, UInt32 /*inBusNumber*/, UInt32 /*inNumberFrames*/,
+	AudioBufferList* ioData)
+{
+	ausdk::AUBufferList::ZeroBuffer(*ioData);
+	*ioActionFlags |= kAudioUnitRenderAction_OutputIsSilence;
+	return noErr;
+}
+
+@interface AUPerformanceTests : XCTestCase
+
+@end
+
+@implementation AUPerformanceTests
+
+// Simulates instantiating and initializing a large session: 256 units, each with a 16-channel
+// bus of 4096 frames.
+- (void)measureStartupWithPageTouchPolicy:(ausdk::BufferAllocator::EPageTouchPolicy)policy
+{
+	constexpr unsigned kNumUnits = 256;
+	constexpr unsigned kNumChannels = 16;
+	constexpr unsigned kFrameCount = 4096;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(48000.0, kNumChannels);
+
+	[self measureBlock:^{
+		ausdk::BufferAllocator allocator;
+		allocator.SetPageTouchPolicy(policy);
+		std::vector<std::unique_ptr<ausdk::AUBufferList>> buffers;
+		for (unsigned unit = 0; unit < kNumUnits; ++unit) {
+			auto& buffer = buffers.emplace_back(std::make_unique<ausdk::AUBufferList>());
+			buffer->Allocate(asbd, kFrameCount, &allocator);
+			if (policy == ausdk::BufferAllocator::EPageTouchPolicy::PrefaultOnInitialize) {
+				buffer->PrefaultPages();
+			}
+		}
+	}];
+}
+
+- (void)testStartupEagerZero
+{
+	[self measureStartupWithPageTouchPolicy:ausdk::BufferAllocator::EPageTouchPolicy::EagerZero];
+}
+
+- (void)testStartupPrefaultOnInitialize
+{
+	[self measureStartupWithPageTouchPolicy:ausdk::BufferAllocator::EPageTouchPolicy::
+												PrefaultOnInitialize];
+}
+
+- (void)testStartupLazyFirstTouch
+{
+	[self measureStartupWithPageTouchPolicy:ausdk::BufferAllocator::EPageTouchPolicy::
+												LazyFirstTouch];
+}
+
+// Copies and zeroes a 64-channel list of 8192 frames (2 MiB), above the non-temporal threshold.
+- (void)testCopyAndZeroLargeBufferList
+{
+	constexpr unsigned kNumChannels = 64;
+	constexpr unsigned kFrameCount = 8192;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(48000.0, kNumChannels);
+	auto src = std::make_shared<ausdk::AUBufferList>();
+	auto dest = std::make_shared<ausdk::AUBufferList>();
+	src->Allocate(asbd, kFrameCount);
+	dest->Allocate(asbd, kFrameCount);
+	src->PrepareBuffer(asbd, kFrameCount);
+
+	[self measureBlock:^{
+		for (int iteration = 0; iteration < 100; ++iteration) {
+			auto& abl = dest->PrepareBuffer(asbd, kFrameCount);
+			src->CopyBufferContentsTo(abl);
+			ausdk::AUBufferList::ZeroBuffer(abl);
+		}
+	}];
+}
+
+static AudioStreamBasicDescription InterleavedStereo(UInt32 bitsPerChannel, bool isFloat)
+{
+	AudioStreamBasicDescription asbd{};
+	asbd.mSampleRate = 48000.0;
+	asbd.mFormatID = kAudioFormatLinearPCM;
+	asbd.mFormatFlags = (isFloat ? kAudioFormatFlagIsFloat : kAudioFormatFlagIsSignedInteger) |
+						kAudioFormatFlagIsPacked;
+	asbd.mBitsPerChannel = bitsPerChannel;
+	asbd.mChannelsPerFrame = 2;
+	asbd.mFramesPerPacket = 1;
+	asbd.mBytesPerFrame = asbd.mBytesPerPacket = 2 * bitsPerChannel / 8;
+	return asbd;
+}
+
+// Converts 100 slices of 4096 interleaved stereo frames between format and planar Float32.
+- (void)measureConversionOf:(AudioStreamBasicDescription)format
+					toPlanar:(BOOL)toPlanar
+					  dither:(ausdk::FormatConversion::EDither)dither
+{
+	constexpr unsigned kFrameCount = 4096;
+	const auto planarFormat = ausdk::FormatConversion::PlanarFormat(format);
+	auto interleaved = std::make_shared<ausdk::AUBufferList>();
+	auto planar = std::make_shared<ausdk::AUBufferList>();
+	auto ditherer = std::make_shared<ausdk::FormatConversion::Ditherer>(dither);
+	interleaved->Allocate(format, kFrameCount);
+	planar->Allocate(planarFormat, kFrameCount);
+	interleaved->PrepareBuffer(format, kFrameCount);
+	planar->PrepareBuffer(planarFormat, kFrameCount);
+
+	[self measureBlock:^{
+		auto& interleavedABL = interleaved->GetBufferList();
+		auto& planarABL = planar->GetBufferList();
+		for (int iteration = 0; iteration < 100; ++iteration) {
+			if (toPlanar) {
+				ausdk::FormatConversion::ToPlanar(format, interleavedABL, planarABL, kFrameCount);
+			} else {
+				ausdk::FormatConversion::FromPlanar(
+					planarABL, format, interleavedABL, kFrameCount, ditherer.get());
+			}
+		}
+	}];
+}
+
+- (void)testConvertInt16ToFloat32
+{
+	[self measureConversionOf:InterleavedStereo(16, false)
+					 toPlanar:YES
+					   dither:ausdk::FormatConversion::EDither::None];
+}
+
+- (void)testConvertInt24ToFloat32
+{
+	[self measureConversionOf:InterleavedStereo(24, false)
+					 toPlanar:YES
+					   dither:ausdk::FormatConversion::EDither::None];
+}
+
+- (void)testConvertFloat64ToFloat32
+{
+	[self measureConversionOf:InterleavedStereo(64, true)
+					 toPlanar:YES
+					   dither:ausdk::FormatConversion::EDither::None];
+}
+
+- (void)testDeinterleaveFloat32
+{
+	[self measureConversionOf:InterleavedStereo(32, true)
+					 toPlanar:YES
+					   dither:ausdk::FormatConversion::EDither::None];
+}
+
+- (void)testConvertFloat32ToInt16
+{
+	[self measureConversionOf:InterleavedStereo(16, false)
+					 toPlanar:NO
+					   dither:ausdk::FormatConversion::EDither::None];
+}
+
+- (void)testConvertFloat32ToInt16TriangularDither
+{
+	[self measureConversionOf:InterleavedStereo(16, false)
+					 toPlanar:NO
+					   dither:ausdk::FormatConversion::EDither::Triangular];
+}
+
+- (void)testConvertFloat32ToInt24
+{
+	[self measureConversionOf:InterleavedStereo(24, false)
+					 toPlanar:NO
+					   dither:ausdk::FormatConversion::EDither::None];
+}
+
+- (void)testConvertFloat32ToInt24TriangularDither
+{
+	[self measureConversionOf:InterleavedStereo(24, false)
+					 toPlanar:NO
+					   dither:ausdk::FormatConversion::EDither::Triangular];
+}
+
+- (void)testConvertFloat32ToFloat64
+{
+	[self measureConversionOf:InterleavedStereo(64, true)
+					 toPlanar:NO
+					   dither:ausdk::FormatConversion::EDither::None];
+}
+
+- (void)testInterleaveFloat32
+{
+	[self measureConversionOf:InterleavedStereo(32, true)
+					 toPlanar:NO
+					   dither:ausdk::FormatConversion::EDither::None];
+}
+
+// Schedules and processes 1000 buffers of 512 frames, each with numEvents overlapping ramps
+// spread across four parameters, in reverse time order, with slices quantized to sliceFrames.
+- (void)measureScheduledParameterEvents:(unsigned)numEvents minimumSliceFrames:(UInt32)sliceFrames
+{
+	constexpr unsigned kFrameCount = 512;
+	auto events = std::make_shared<std::vector<AudioUnitParameterEvent>>(numEvents);
+	for (unsigned i = 0; i < numEvents; ++i) {
+		auto& event = (*events)[numEvents - 1 - i];
+		event.scope = kAudioUnitScope_Output;
+		event.parameter = i % 4;
+		event.eventType = kParameterEvent_Ramped;
+		event.eventValues.ramp.startBufferOffset = static_cast<SInt32>(i * kFrameCount / numEvents);
+		event.eventValues.ramp.durationInFrames = 2 * kFrameCount / numEvents + 1;
+		event.eventValues.ramp.endValue = 1.f;
+	}
+	auto unit = std::make_shared<SchedulingUnit>();
+	unit->SetParameterEventCapacity(numEvents);
+	unit->SetMinimumSliceFrames(sliceFrames);
+	unit->DoPostConstructor();
+	XCTAssertEqual(unit->DoInitialize(), noErr);
+
+	[self measureBlock:^{
+		for (int iteration = 0; iteration < 1000; ++iteration) {
+			unit->ClearEvents();
+			unit->ScheduleParameter(events->data(), numEvents);
+			unit->Process(kFrameCount);
+		}
+	}];
+	unit->DoPreDestructor();
+}
+
+- (void)testScheduledParameterEvents1
+{
+	[self measureScheduledParameterEvents:1 minimumSliceFrames:0];
+}
+
+- (void)testScheduledParameterEvents10
+{
+	[self measureScheduledParameterEvents:10 minimumSliceFrames:0];
+}
+
+- (void)testScheduledParameterEvents100
+{
+	[self measureScheduledParameterEvents:100 minimumSliceFrames:0];
+}
+
+- (void)testScheduledParameterEvents1000
+{
+	[self measureScheduledParameterEvents:1000 minimumSliceFrames:0];
+}
+
+- (void)testScheduledParameterEvents1000MinimumSlice32
+{
+	[self measureScheduledParameterEvents:1000 minimumSliceFrames:32];
+}
+
+// Gets and then sets 10000 global parameters, as a host syncing a control surface would: through
+// the per-parameter entry points, each taking the instance's mutex like AUPlugInDispatch, or in
+// one batch.
+- (void)measureParameterSync:(BOOL)batch
+{
+	constexpr UInt32 kNumParameters = 10000;
+	auto unit = std::make_shared<SchedulingUnit>();
+	auto mutex = std::make_shared<ausdk::AUMutex>();
+	unit->SetMutex(mutex.get());
+	unit->DoPostConstructor();
+	auto items = std::make_shared<std::vector<ausdk::AUParameterItem>>(kNumParameters);
+	for (UInt32 i = 0; i < kNumParameters; ++i) {
+		(*items)[i] = { kAudioUnitScope_Global, 0, 3 * i, static_cast<float>(i) };
+		unit->Globals()->SetParameter(3 * i, 0.f);
+	}
+	XCTAssertEqual(unit->DoInitialize(), noErr);
+
+	[self measureBlock:^{
+		if (batch) {
+			unit->GetParameters(items->data(), kNumParameters);
+			unit->SetParameters(items->data(), kNumParameters);
+			return;
+		}
+		for (auto& item : *items) {
+			const ausdk::AUEntryGuard guard{ unit->GetMutex() };
+			unit->GetParameter(item.mParameterID, item.mScope, item.mElement, item.mValue);
+		}
+		for (const auto& item : *items) {
+			unit->SetParameter(item.mParameterID, item.mScope, item.mElement, item.mValue, 0);
+		}
+	}];
+	XCTAssertEqual((*items)[42].mValue, 0.f); // read back, replacing the initial values
+	unit->DoPreDestructor();
+	unit->SetMutex(nullptr);
+}
+
+- (void)testParameterSyncPerCall10000
+{
+	[self measureParameterSync:NO];
+}
+
+- (void)testParameterSyncBatch10000
+{
+	[self measureParameterSync:YES];
+}
+
+// Reads each of 1000 sparse global parameters 1000 times, as a kernel would per slice: by ID,
+// with a lookup each time, or through handles resolved beforehand.
+- (void)measureParameterReads:(BOOL)handles
+{
+	constexpr UInt32 kNumParameters = 1000;
+	constexpr UInt32 kNumPasses = 1000;
+	auto unit = std::make_shared<SchedulingUnit>();
+	unit->DoPostConstructor();
+	auto handleList = std::make_shared<std::vector<ausdk::AUParameterHandle>>();
+	for (UInt32 i = 0; i < kNumParameters; ++i) {
+		unit->Globals()->SetParameter(7 * i, static_cast<float>(i));
+		handleList->push_back(unit->Globals()->GetParameterHandle(7 * i));
+	}
+	XCTAssertEqual(unit->DoInitialize(), noErr);
+
+	[self measureBlock:^{
+		const ausdk::AUElement& globals = *unit->Globals();
+		double sum = 0.0;
+		for (UInt32 pass = 0; pass < kNumPasses; ++pass) {
+			if (handles) {
+				for (const auto& handle : *handleList) {
+					sum += handle.Get();
+				}
+			} else {
+				for (UInt32 i = 0; i < kNumParameters; ++i) {
+					sum += globals.GetParameter(7 * i);
+				}
+			}
+		}
+		XCTAssertEqual(sum, 499500.0 * kNumPasses);
+	}];
+	unit->DoPreDestructor();
+}
+
+- (void)testParameterReadsByID1000
+{
+	[self measureParameterReads:NO];
+}
+
+- (void)testParameterReadsByHandle1000
+{
+	[self measureParameterReads:YES];
+}
+
+// Filters 100 slices of 512 frames of a 7.1.4 (12-channel) stream.
+- (void)measureBiquad:(BOOL)multiChannel
+{
+	constexpr UInt32 kNumChannels = 12;
+	constexpr UInt32 kFrameCount = 512;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(48000.0, kNumChannels);
+	auto unit = std::make_shared<BiquadUnit>(multiChannel);
+	unit->DoPostConstructor();
+	XCTAssertEqual(unit->DispatchSetProperty(kAudioUnitProperty_StreamFormat,
+					   kAudioUnitScope_Input, 0, &asbd, sizeof(asbd)),
+		noErr);
+	XCTAssertEqual(unit->DispatchSetProperty(kAudioUnitProperty_StreamFormat,
+					   kAudioUnitScope_Output, 0, &asbd, sizeof(asbd)),
+		noErr);
+	unit->Globals()->UseIndexedParameters(1);
+	unit->SetParameter(0, 1000.f);
+	XCTAssertEqual(unit->DoInitialize(), noErr);
+
+	auto input = std::make_shared<ausdk::AUBufferList>();
+	auto output = std::make_shared<ausdk::AUBufferList>();
+	input->Allocate(asbd, kFrameCount);
+	output->Allocate(asbd, kFrameCount);
+	auto& inputABL = input->PrepareBuffer(asbd, kFrameCount);
+	for (UInt32 channel = 0; channel < kNumChannels; ++channel) {
+		auto* samples = static_cast<Float32*>(inputABL.mBuffers[channel].mData);
+		for (UInt32 i = 0; i < kFrameCount; ++i) {
+			samples[i] = static_cast<float>((i * 7919 + channel * 104729) % 2000) / 1000.f - 1.f;
+		}
+	}
+	output->PrepareBuffer(asbd, kFrameCount);
+
+	[self measureBlock:^{
+		for (int iteration = 0; iteration < 100; ++iteration) {
+			AudioUnitRenderActionFlags flags = 0;
+			unit->ProcessBufferLists(
+				flags, input->GetBufferList(), output->GetBufferList(), kFrameCount);
+		}
+	}];
+	unit->DoPreDestructor();
+}
+
+- (void)testBiquadPerChannelKernels
+{
+	[self measureBiquad:NO];
+}
+
+- (void)testBiquadMultiChannelKernel
+{
+	[self measureBiquad:YES];
+}
+
+// Filters 20 slices of 512 frames of a 16-channel stream with 512-tap FIR kernels, spread
+// across the given number of threads.
+- (void)measureKernelThreads:(UInt32)threads
+{
+	constexpr UInt32 kNumChannels = 16;
+	constexpr UInt32 kFrameCount = 512;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(48000.0, kNumChannels);
+	auto unit = std::make_shared<FIRUnit>();
+	unit->DoPostConstructor();
+	unit->SetKernelThreads(threads);
+	XCTAssertEqual(unit->DispatchSetProperty(kAudioUnitProperty_StreamFormat,
+					   kAudioUnitScope_Input, 0, &asbd, sizeof(asbd)),
+		noErr);
+	XCTAssertEqual(unit->DispatchSetProperty(kAudioUnitProperty_StreamFormat,
+					   kAudioUnitScope_Output, 0, &asbd, sizeof(asbd)),
+		noErr);
+	XCTAssertEqual(unit->DoInitialize(), noErr);
+
+	auto input = std::make_shared<ausdk::AUBufferList>();
+	auto output = std::make_shared<ausdk::AUBufferList>();
+	input->Allocate(asbd, kFrameCount);
+	output->Allocate(asbd, kFrameCount);
+	auto& inputABL = input->PrepareBuffer(asbd, kFrameCount);
+	for (UInt32 channel = 0; channel < kNumChannels; ++channel) {
+		auto* samples = static_cast<Float32*>(inputABL.mBuffers[channel].mData);
+		for (UInt32 i = 0; i < kFrameCount; ++i) {
+			samples[i] = static_cast<float>((i * 7919 + channel * 104729) % 2000) / 1000.f - 1.f;
+		}
+	}
+	output->PrepareBuffer(asbd, kFrameCount);
+
+	[self measureBlock:^{
+		for (int iteration = 0; iteration < 20; ++iteration) {
+			AudioUnitRenderActionFlags flags = 0;
+			unit->ProcessBufferLists(
+				flags, input->GetBufferList(), output->GetBufferList(), kFrameCount);
+		}
+	}];
+	unit->DoPreDestructor();
+}
+
+- (void)testKernelThreads1
+{
+	[self measureKernelThreads:1];
+}
+
+- (void)testKernelThreads2
+{
+	[self measureKernelThreads:2];
+}
+
+- (void)testKernelThreads4
+{
+	[self measureKernelThreads:4];
+}
+
+- (void)testKernelThreads8
+{
+	[self measureKernelThreads:8];
+}
+
+- (void)testKernelThreads16
+{
+	[self measureKernelThreads:16];
+}
+
+// Processes 10000 blocks of 64 frames of an 8-channel stream.
+- (void)measureGain:(std::shared_ptr<ausdk::AUEffectBase>)unit
+{
+	constexpr UInt32 kNumChannels = 8;
+	constexpr UInt32 kFrameCount = 64;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(48000.0, kNumChannels);
+	unit->DoPostConstructor();
+	XCTAssertEqual(unit->DispatchSetProperty(kAudioUnitProperty_StreamFormat,
+					   kAudioUnitScope_Input, 0, &asbd, sizeof(asbd)),
+		noErr);
+	XCTAssertEqual(unit->DispatchSetProperty(kAudioUnitProperty_StreamFormat,
+					   kAudioUnitScope_Output, 0, &asbd, sizeof(asbd)),
+		noErr);
+	XCTAssertEqual(unit->DoInitialize(), noErr);
+
+	auto input = std::make_shared<ausdk::AUBufferList>();
+	auto output = std::make_shared<ausdk::AUBufferList>();
+	input->Allocate(asbd, kFrameCount);
+	output->Allocate(asbd, kFrameCount);
+	input->PrepareBuffer(asbd, kFrameCount);
+	output->PrepareBuffer(asbd, kFrameCount);
+
+	[self measureBlock:^{
+		for (int iteration = 0; iteration < 10000; ++iteration) {
+			AudioUnitRenderActionFlags flags = 0;
+			unit->ProcessBufferLists(
+				flags, input->GetBufferList(), output->GetBufferList(), kFrameCount);
+		}
+	}];
+	unit->DoPreDestructor();
+}
+
+- (void)testGainPerChannelKernels
+{
+	[self measureGain:std::make_shared<GainUnit>()];
+}
+
+- (void)testGainFixedEffect
+{
+	[self measureGain:std::make_shared<FixedGainUnit>()];
+}
+
+// Renders 200 blocks of 512 frames of silence through 16 FIR kernels.
+- (void)measureSilentFIR:(bool)kernelSleep
+{
+	constexpr UInt32 kNumChannels = 16;
+	constexpr UInt32 kFrameCount = 512;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(48000.0, kNumChannels);
+	auto unit = std::make_shared<FIRUnit>();
+	unit->DoPostConstructor();
+	unit->SetKernelSleepEnabled(kernelSleep);
+	XCTAssertEqual(unit->DispatchSetProperty(kAudioUnitProperty_StreamFormat,
+					   kAudioUnitScope_Input, 0, &asbd, sizeof(asbd)),
+		noErr);
+	XCTAssertEqual(unit->DispatchSetProperty(kAudioUnitProperty_StreamFormat,
+					   kAudioUnitScope_Output, 0, &asbd, sizeof(asbd)),
+		noErr);
+	AURenderCallbackStruct callback{ .inputProc = RenderSilence, .inputProcRefCon = nullptr };
+	XCTAssertEqual(unit->DispatchSetProperty(kAudioUnitProperty_SetRenderCallback,
+					   kAudioUnitScope_Input, 0, &callback, sizeof(callback)),
+		noErr);
+	XCTAssertEqual(unit->DoInitialize(), noErr);
+
+	auto output = std::make_shared<ausdk::AUBufferList>();
+	output->Allocate(asbd, kFrameCount);
+	output->PrepareBuffer(asbd, kFrameCount);
+
+	[self measureBlock:^{
+		AudioTimeStamp timeStamp{};
+		timeStamp.mFlags = kAudioTimeStampSampleTimeValid;
+		for (int iteration = 0; iteration < 200; ++iteration) {
+			AudioUnitRenderActionFlags flags = 0;
+			unit->DoRender(flags, timeStamp, 0, kFrameCount, output->GetBufferList());
+			timeStamp.mSampleTime += kFrameCount;
+		}
+	}];
+	XCTAssertEqual(unit->GetSleepStatistics().mSleepingRenders != 0, kernelSleep);
+	unit->DoPreDestructor();
+}
+
+- (void)testSilentFIRAwake
+{
+	[self measureSilentFIR:false];
+}
+
+- (void)testSilentFIRAsleep
+{
+	[self measureSilentFIR:true];
+}
+
+@end
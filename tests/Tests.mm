@@ -6,7 +6,248 @@
 #import <XCTest/XCTest.h>
 
 #import <AudioUnitSDK/AudioUnitSDK.h>
+#import <algorithm>
 #import <array>
+#import <atomic>
+#import <cmath>
+#import <cstdint>
+#import <cstdlib>
+#import <cstring>
+#import <thread>
+#import <vector>
+
+// Halves a stereo signal, in blocks of at most 64 frames, and counts the blocks of each kind.
+class FixedGain : public ausdk::AUFixedEffect<2, 64, false> {
+public:
+	FixedGain() : AUFixedEffect(nullptr) {}
+
+	OSStatus Reset(AudioUnitScope inScope, AudioUnitElement inElement) override
+	{
+		++mResets;
+		return AUFixedEffect::Reset(inScope, inElement);
+	}
+
+	void SetBypassEffect(bool inFlag) override
+	{
+		++mBypassChanges;
+		AUFixedEffect::SetBypassEffect(inFlag);
+	}
+
+	void ProcessBlock(const Sources& inSources, const Dests& inDests, UInt32 inFramesToProcess,
+		bool& ioSilence) override
+	{
+		++mBlocks;
+		mLastBlockFrames = inFramesToProcess;
+		Process(inSources, inDests, inFramesToProcess, ioSilence);
+	}
+
+	void ProcessFixedBlock(const Sources& inSources, const Dests& inDests, bool& ioSilence) override
+	{
+		++mFixedBlocks;
+		Process(inSources, inDests, kMaxBlock, ioSilence);
+	}
+
+	UInt32 mBlocks{};
+	UInt32 mFixedBlocks{};
+	UInt32 mLastBlockFrames{};
+	UInt32 mResets{};
+	UInt32 mBypassChanges{};
+
+private:
+	static void Process(
+		const Sources& inSources, const Dests& inDests, UInt32 inFrames, bool& ioSilence)
+	{
+		for (UInt32 channel = 0; channel < kChannels; ++channel) {
+			for (UInt32 i = 0; i < inFrames; ++i) {
+				inDests[channel][i] = 0.5f * inSources[channel][i];
+			}
+		}
+		ioSilence = false;
+	}
+};
+
+// Fills each of its two output busses with a constant: ten times the number of renders, plus the
+// bus number.
+class TwoBusUnit : public ausdk::AUBase {
+public:
+	TwoBusUnit() : AUBase(nullptr, 0, 2) {}
+
+	OSStatus Render(AudioUnitRenderActionFlags& /*ioActionFlags*/,
+		const AudioTimeStamp& inTimeStamp, UInt32 inNumberFrames) override
+	{
+		++mRenders;
+		for (UInt32 bus = 0; bus < 2; ++bus) {
+			auto& output = Output(bus);
+			if (!output.RenderedInPlaceAt(inTimeStamp.mSampleTime)) {
+				output.PrepareBuffer(inNumberFrames);
+			}
+			const auto& abl = output.GetBufferList();
+			for (UInt32 i = 0; i < abl.mNumberBuffers; ++i) {
+				std::fill_n(static_cast<float*>(abl.mBuffers[i].mData), inNumberFrames,
+					static_cast<float>(10 * mRenders + bus));
+			}
+		}
+		return noErr;
+	}
+
+	UInt32 mRenders{};
+};
+
+// Renders silence as a unit which tracks its silent outputs does: only what was written since
+// the last render is zeroed.
+class SilentUnit : public ausdk::AUBase {
+public:
+	SilentUnit() : AUBase(nullptr, 0, 1) {}
+
+	OSStatus Render(AudioUnitRenderActionFlags& ioActionFlags,
+		const AudioTimeStamp& /*inTimeStamp*/, UInt32 /*inNumberFrames*/) override
+	{
+		Output(0).SilenceBufferList();
+		ioActionFlags |= kAudioUnitRenderAction_OutputIsSilence;
+		return noErr;
+	}
+};
+
+// Runs ProcessForScheduledParams() on global parameter 0 and records each slice with the value
+// the parameter has during it, and the parameter's per-sample values across the buffer.
+class ScheduledUnit : public ausdk::AUBase {
+public:
+	struct Slice {
+		UInt32 mStart{};
+		UInt32 mFrames{};
+		float mValue{};
+	};
+
+	ScheduledUnit() : AUBase(nullptr, 0, 1) {}
+
+	bool CanScheduleParameters() const override { return true; }
+	bool StreamFormatWritable(AudioUnitScope /*scope*/, AudioUnitElement /*element*/) override
+	{
+		return true;
+	}
+
+	OSStatus ProcessScheduledSlice(void* /*inUserData*/, UInt32 inStartFrameInBuffer,
+		UInt32 inSliceFramesToProcess, UInt32 /*inTotalBufferFrames*/) override
+	{
+		mSlices.push_back({ inStartFrameInBuffer, inSliceFramesToProcess,
+			Globals()->GetParameter(0) });
+		Globals()->FillParameterValues(
+			0, &mValues[inStartFrameInBuffer], inSliceFramesToProcess, inStartFrameInBuffer);
+		return noErr;
+	}
+
+	OSStatus Process(UInt32 inFrames)
+	{
+		mSlices.clear();
+		mValues.assign(inFrames, 0.f);
+		const OSStatus result = ProcessForScheduledParams(GetParamEventList(), inFrames, nullptr);
+		GetParamEventList().clear();
+		return result;
+	}
+
+	std::vector<Slice> mSlices;
+	std::vector<float> mValues;
+};
+
+// A kParameterEvent_Immediate or kParameterEvent_Ramped event for global parameter inParameter.
+static AudioUnitParameterEvent ImmediateEvent(
+	AudioUnitParameterID inParameter, UInt32 inOffset, float inValue)
+{
+	AudioUnitParameterEvent result{};
+	result.scope = kAudioUnitScope_Global;
+	result.parameter = inParameter;
+	result.eventType = kParameterEvent_Immediate;
+	result.eventValues.immediate.bufferOffset = inOffset;
+	result.eventValues.immediate.value = inValue;
+	return result;
+}
+
+static AudioUnitParameterEvent RampedEvent(AudioUnitParameterID inParameter, SInt32 inOffset,
+	UInt32 inDuration, float inStartValue, float inEndValue)
+{
+	AudioUnitParameterEvent result{};
+	result.scope = kAudioUnitScope_Global;
+	result.parameter = inParameter;
+	result.eventType = kParameterEvent_Ramped;
+	result.eventValues.ramp.startBufferOffset = inOffset;
+	result.eventValues.ramp.durationInFrames = inDuration;
+	result.eventValues.ramp.startValue = inStartValue;
+	result.eventValues.ramp.endValue = inEndValue;
+	return result;
+}
+
+// A one-pole low-pass filter per channel, whose output depends on each kernel's state.
+class OnePoleKernel : public ausdk::AUKernelBase {
+public:
+	using AUKernelBase::AUKernelBase;
+
+	void Reset() override { mState = 0.f; }
+
+	void Process(const Float32* inSourceP, Float32* inDestP, UInt32 inFramesToProcess,
+		bool& /*ioSilence*/) override
+	{
+		for (UInt32 i = 0; i < inFramesToProcess; ++i) {
+			mState += 0.1f * (inSourceP[i] - mState);
+			inDestP[i] = mState;
+		}
+	}
+
+private:
+	float mState{};
+};
+
+class OnePoleUnit : public ausdk::AUEffectBase {
+public:
+	OnePoleUnit() : AUEffectBase(nullptr) {}
+
+	std::unique_ptr<ausdk::AUKernelBase> NewKernel() override
+	{
+		return std::make_unique<OnePoleKernel>(*this);
+	}
+};
+
+// Renders the constant *inRefCon, flagging zero as silence.
+static OSStatus RenderConstant(void* inRefCon, AudioUnitRenderActionFlags* ioActionFlags,
+	const AudioTimeStamp* /*inTimeStamp*/, UInt32 /*inBusNumber*/, UInt32 inNumberFrames,
+	AudioBufferList* ioData)
+{
+	const float value = *static_cast<const float*>(inRefCon);
+	for (UInt32 i = 0; i < ioData->mNumberBuffers; ++i) {
+		std::fill_n(static_cast<float*>(ioData->mBuffers[i].mData), inNumberFrames, value);
+	}
+	if (value == 0.f) {
+		*ioActionFlags |= kAudioUnitRenderAction_OutputIsSilence;
+	}
+	return noErr;
+}
+
+// Behaves as a system which provides no large pages.
+class NoLargePagesAllocator : public ausdk::BufferAllocator {
+public:
+	UInt32 mLargePageRequests{};
+
+protected:
+	void* MapLargePages(size_t& /*ioBytes*/) noexcept override
+	{
+		++mLargePageRequests;
+		return nullptr;
+	}
+};
+
+struct RecordingSource {
+	float mLevel{ 1.f };
+	const void* mData{ nullptr }; // the buffer last rendered into
+};
+
+static OSStatus RenderRecording(void* inRefCon, AudioUnitRenderActionFlags* ioActionFlags,
+	const AudioTimeStamp* inTimeStamp, UInt32 inBusNumber, UInt32 inNumberFrames,
+	AudioBufferList* ioData)
+{
+	auto& source = *static_cast<RecordingSource*>(inRefCon);
+	source.mData = ioData->mBuffers[0].mData;
+	return RenderConstant(
+		&source.mLevel, ioActionFlags, inTimeStamp, inBusNumber, inNumberFrames, ioData);
+}
 
 @interface Tests : XCTestCase
 
@@ -79,6 +320,10 @@
 				false);
 		}
 
+		if (kBufSize > 0) {
+			XCTAssertTrue(uut.IsAligned(ausdk::BufferAllocator::kDefaultBufferAlignment));
+		}
+
 		checkABL(uut.PrepareNullBuffer(asbd, kFrameCount), kNumBufs, 1, kFrameCount * sizeof(float),
 			true);
 	};
@@ -93,6 +338,1237 @@
 	test(4, kTypicalFrameCount);
 }
 
+- (void)testCopyBufferContentsTo
+{
+	constexpr unsigned kFrameCount = 64;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(44100.0, 2);
+	ausdk::AUBufferList src;
+	src.Allocate(asbd, kFrameCount);
+	auto& srcABL = src.PrepareBuffer(asbd, kFrameCount);
+
+	ausdk::AUBufferList dest;
+	dest.Allocate(asbd, kFrameCount);
+	XCTAssertEqual(src.CopyBufferContentsTo(dest.PrepareBuffer(asbd, kFrameCount)),
+		2 * kFrameCount * sizeof(float));
+
+	// copying onto itself moves nothing
+	XCTAssertEqual(src.CopyBufferContentsTo(srcABL), 0u);
+}
+
+- (void)testKnownSilentBuffers
+{
+	constexpr unsigned kFrameCount = 64;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(44100.0, 2);
+	ausdk::AUBufferList uut;
+	uut.Allocate(asbd, kFrameCount);
+	auto& abl = uut.PrepareBuffer(asbd, kFrameCount);
+	auto* const left = static_cast<float*>(abl.mBuffers[0].mData);
+	XCTAssertFalse(uut.IsKnownSilent());
+
+	left[1] = 1.0f;
+	uut.Silence();
+	XCTAssertTrue(uut.IsKnownSilent());
+	XCTAssertEqual(left[1], 0.0f);
+
+	left[1] = 1.0f;
+	uut.MarkModified(0);
+	XCTAssertFalse(uut.IsKnownSilent(0));
+	XCTAssertTrue(uut.IsKnownSilent(1));
+	uut.Silence();
+	XCTAssertEqual(left[1], 0.0f);
+
+	// copies from silent buffers only write zeros
+	std::array<std::array<float, kFrameCount>, 2> dest{};
+	dest[1][3] = 1.0f;
+	ausdk::AUBufferList destList;
+	destList.Allocate(asbd, kFrameCount);
+	auto& destABL = destList.PrepareNullBuffer(asbd, kFrameCount);
+	destABL.mBuffers[0].mData = dest[0].data();
+	destABL.mBuffers[1].mData = dest[1].data();
+	XCTAssertEqual(uut.CopyBufferContentsTo(destABL), 0u);
+	XCTAssertEqual(dest[1][3], 0.0f);
+}
+
+- (void)testPlanarConversion
+{
+	constexpr unsigned kFrameCount = 67; // exercises the vector and scalar paths
+	const auto interleaved = ausdk::ASBD::CreateCommonFloat32(44100.0, 2, true);
+	XCTAssertTrue(ausdk::FormatConversion::IsConvertible(interleaved));
+	XCTAssertFalse(
+		ausdk::FormatConversion::IsConvertible(ausdk::ASBD::CreateCommonFloat32(44100.0, 2)));
+	const auto planar = ausdk::FormatConversion::PlanarFormat(interleaved);
+	XCTAssertTrue(ausdk::ASBD::IsCommonFloat32(planar));
+
+	std::array<float, 2 * kFrameCount> source{};
+	for (unsigned i = 0; i < source.size(); ++i) {
+		source[i] = static_cast<float>(i);
+	}
+	ausdk::AUBufferList sourceList;
+	sourceList.Allocate(interleaved, kFrameCount);
+	auto& sourceABL = sourceList.PrepareNullBuffer(interleaved, kFrameCount);
+	sourceABL.mBuffers[0].mData = source.data();
+
+	ausdk::AUBufferList planarList;
+	planarList.Allocate(planar, kFrameCount);
+	auto& planarABL = planarList.PrepareBuffer(planar, kFrameCount);
+	ausdk::FormatConversion::ToPlanar(interleaved, sourceABL, planarABL, kFrameCount);
+	const auto* const left = static_cast<const float*>(planarABL.mBuffers[0].mData);
+	const auto* const right = static_cast<const float*>(planarABL.mBuffers[1].mData);
+	for (unsigned i = 0; i < kFrameCount; ++i) {
+		XCTAssertEqual(left[i], static_cast<float>(2 * i));
+		XCTAssertEqual(right[i], static_cast<float>(2 * i + 1));
+	}
+
+	std::array<float, 2 * kFrameCount> dest{};
+	ausdk::AUBufferList destList;
+	destList.Allocate(interleaved, kFrameCount);
+	auto& destABL = destList.PrepareNullBuffer(interleaved, kFrameCount);
+	destABL.mBuffers[0].mData = dest.data();
+	ausdk::FormatConversion::FromPlanar(planarABL, interleaved, destABL, kFrameCount);
+	XCTAssertEqual(dest, source);
+	XCTAssertEqual(destABL.mBuffers[0].mDataByteSize, sizeof(dest));
+}
+
+- (void)testSampleFormatConversion
+{
+	AudioStreamBasicDescription int16{};
+	int16.mSampleRate = 44100.0;
+	int16.mFormatID = kAudioFormatLinearPCM;
+	int16.mFormatFlags = kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsPacked;
+	int16.mBitsPerChannel = 16;
+	int16.mChannelsPerFrame = 1;
+	int16.mFramesPerPacket = 1;
+	int16.mBytesPerFrame = int16.mBytesPerPacket = sizeof(int16_t);
+	XCTAssertTrue(ausdk::FormatConversion::IsConvertible(int16));
+
+	constexpr UInt32 kSampleCount = 4;
+	std::array<float, kSampleCount> planar{ 0.5f, -1.0f, 2.0f, -3.0f };
+	std::array<int16_t, kSampleCount> samples{};
+	AudioBufferList planarABL{ 1, { { 1, sizeof(planar), planar.data() } } };
+	AudioBufferList samplesABL{ 1, { { 1, sizeof(samples), samples.data() } } };
+	ausdk::FormatConversion::FromPlanar(planarABL, int16, samplesABL, kSampleCount);
+	XCTAssertEqual(samples[0], 16384);
+	XCTAssertEqual(samples[1], -32768);
+	XCTAssertEqual(samples[2], 32767); // clipped
+	XCTAssertEqual(samples[3], -32768);
+
+	ausdk::FormatConversion::ToPlanar(int16, samplesABL, planarABL, kSampleCount);
+	XCTAssertEqual(planar[0], 0.5f);
+	XCTAssertEqual(planar[1], -1.0f);
+
+	// triangular dither of a quarter LSB: within 1 LSB, averaging to the input
+	constexpr unsigned kFrameCount = 4096;
+	std::vector<float> quiet(kFrameCount, 0.25f / 32768.0f);
+	std::vector<int16_t> dithered(kFrameCount);
+	AudioBufferList quietABL{ 1, { { 1, kFrameCount * sizeof(float), quiet.data() } } };
+	AudioBufferList ditheredABL{ 1, { { 1, kFrameCount * sizeof(int16_t), dithered.data() } } };
+	ausdk::FormatConversion::Ditherer ditherer{ ausdk::FormatConversion::EDither::Triangular };
+	ausdk::FormatConversion::FromPlanar(quietABL, int16, ditheredABL, kFrameCount, &ditherer);
+	double sum = 0.0;
+	for (const auto sample : dithered) {
+		XCTAssertLessThanOrEqual(std::abs(sample), 1);
+		sum += sample;
+	}
+	XCTAssertEqualWithAccuracy(sum / kFrameCount, 0.25, 0.05);
+}
+
+- (void)testParameterEventList
+{
+	using ausdk::AUParameterEventList;
+	const auto event = [](AudioUnitParameterID inParameter, UInt32 inOffset) {
+		AudioUnitParameterEvent result{};
+		result.parameter = inParameter;
+		result.eventType = kParameterEvent_Immediate;
+		result.eventValues.immediate.bufferOffset = inOffset;
+		return result;
+	};
+
+	AUParameterEventList uut;
+	XCTAssertEqual(uut.Capacity(), AUParameterEventList::kDefaultCapacity);
+	XCTAssertEqual(uut.Push(event(9, 0)), noErr);
+	uut.push_back(event(10, 0));
+
+	// shrinking keeps the latest pending events
+	uut.Reserve(1);
+	XCTAssertEqual(uut.size(), 1u);
+	XCTAssertEqual(uut.begin()->parameter, 10u);
+	XCTAssertEqual(uut.DroppedEventCount(), 1u);
+	uut.Reserve(2);
+	XCTAssertEqual(uut.size(), 1u);
+	XCTAssertEqual(uut.begin()->parameter, 10u);
+	uut.clear();
+	uut.ResetDroppedEventCount();
+
+	for (UInt32 i = 0; i < 5; ++i) {
+		XCTAssertEqual(uut.Push(event(i, i)), noErr);
+	}
+	XCTAssertEqual(uut.size(), 2u);
+	XCTAssertEqual(uut.begin()->parameter, 3u);
+	XCTAssertEqual(uut.DroppedEventCount(), 3u);
+
+	uut.clear();
+	uut.ResetDroppedEventCount();
+	uut.SetOverflowPolicy(AUParameterEventList::EOverflowPolicy::CoalesceByParameter);
+	XCTAssertEqual(uut.Push(event(0, 0)), noErr);
+	XCTAssertEqual(uut.Push(event(1, 0)), noErr);
+	XCTAssertEqual(uut.Push(event(0, 7)), noErr); // replaces the first event
+	XCTAssertEqual(uut.Push(event(2, 0)), noErr); // no match; dropped
+	XCTAssertEqual(uut.size(), 2u);
+	XCTAssertEqual(uut.begin()->eventValues.immediate.bufferOffset, 7u);
+	XCTAssertEqual(uut.CoalescedEventCount(), 1u);
+	XCTAssertEqual(uut.DroppedEventCount(), 1u);
+
+	uut.SetOverflowPolicy(AUParameterEventList::EOverflowPolicy::ReportError);
+	XCTAssertEqual(uut.Push(event(3, 0)), kAudio_MemFullError);
+	XCTAssertEqual(uut.DroppedEventCount(), 2u);
+	XCTAssertEqual(uut.CoalescedEventCount(), 1u);
+	uut.ResetCoalescedEventCount();
+	XCTAssertEqual(uut.CoalescedEventCount(), 0u);
+	XCTAssertEqual(uut.DroppedEventCount(), 2u);
+}
+
+- (void)testParameterEventsScheduledBeforeInitialize
+{
+	ScheduledUnit unit;
+	unit.DoPostConstructor();
+	unit.Globals()->SetParameter(0, 0.f);
+	unit.SetParameterEventCapacity(64);
+
+	// kept when DoInitialize() allocates the configured capacity
+	const AudioUnitParameterEvent ramp = RampedEvent(0, 16, 32, 0.f, 1.f);
+	XCTAssertEqual(unit.ScheduleParameter(&ramp, 1), noErr);
+	XCTAssertEqual(unit.DoInitialize(), noErr);
+	XCTAssertEqual(unit.Process(64), noErr);
+	XCTAssertEqual(unit.mSlices.size(), 3u);
+	XCTAssertEqual(unit.mSlices[1].mStart, 16u);
+	XCTAssertEqual(unit.Globals()->GetParameter(0), 1.f);
+	XCTAssertEqual(unit.GetDroppedParameterEventCount(), 0u);
+	XCTAssertEqual(unit.GetCoalescedParameterEventCount(), 0u);
+	unit.DoPreDestructor();
+}
+
+- (void)testParameterRamp
+{
+	using ausdk::AUParameterRamp;
+	AudioUnitParameterEvent event{};
+	event.eventType = kParameterEvent_Ramped;
+	event.eventValues.ramp.startBufferOffset = 2;
+	event.eventValues.ramp.durationInFrames = 4;
+	event.eventValues.ramp.startValue = 1.f;
+	event.eventValues.ramp.endValue = 3.f;
+
+	AUParameterRamp uut;
+	uut.Start(event);
+	XCTAssertTrue(uut.IsActive());
+	std::array<float, 9> values{};
+	uut.Fill(values.data(), values.size(), 0);
+	const std::array<float, 9> linear{ 1.f, 1.f, 1.f, 1.5f, 2.f, 2.5f, 3.f, 3.f, 3.f };
+	XCTAssertTrue(values == linear);
+
+	std::array<float, 3> blocks{};
+	uut.Fill(blocks.data(), blocks.size(), 0, 4); // frames 0, 4 and 8
+	XCTAssertTrue((blocks == std::array<float, 3>{ 1.f, 2.f, 3.f }));
+
+	event.eventValues.ramp.endValue = 16.f;
+	uut.SetCurve(AUParameterRamp::ECurve::Exponential);
+	uut.Start(event);
+	uut.Fill(values.data(), values.size(), 0);
+	const std::array<float, 9> exponential{ 1.f, 1.f, 1.f, 2.f, 4.f, 8.f, 16.f, 16.f, 16.f };
+	for (size_t i = 0; i < values.size(); ++i) {
+		XCTAssertEqualWithAccuracy(values[i], exponential[i], 1e-5f);
+	}
+	XCTAssertEqualWithAccuracy(uut.ValueAt(3), 2.f, 1e-5f);
+
+	uut.Stop();
+	XCTAssertFalse(uut.IsActive());
+}
+
+- (void)testImmediateEventInterruptsRamp
+{
+	ScheduledUnit unit;
+	unit.DoPostConstructor();
+	unit.Globals()->SetParameter(0, 0.f);
+	unit.Globals()->SetParameter(1, 0.f);
+	XCTAssertEqual(unit.DoInitialize(), noErr);
+
+	// the ramp runs past the buffer; parameter 1 divides the buffer again after the interruption
+	const std::array<AudioUnitParameterEvent, 3> events{ RampedEvent(0, 0, 100, 0.f, 1.f),
+		ImmediateEvent(0, 16, 5.f), ImmediateEvent(1, 32, 1.f) };
+	XCTAssertEqual(unit.ScheduleParameter(events.data(), events.size()), noErr);
+	XCTAssertEqual(unit.Process(64), noErr);
+
+	XCTAssertEqual(unit.mSlices.size(), 3u);
+	XCTAssertEqualWithAccuracy(unit.mSlices[0].mValue, 0.16f, 1e-6f);
+	XCTAssertEqual(unit.mSlices[1].mValue, 5.f);
+	XCTAssertEqual(unit.mSlices[2].mStart, 32u);
+	XCTAssertEqual(unit.mSlices[2].mValue, 5.f);
+	XCTAssertEqual(unit.Globals()->GetParameter(0), 5.f);
+	unit.DoPreDestructor();
+}
+
+- (void)testSampleAccurateRampInterruptedByImmediateEvent
+{
+	ScheduledUnit unit;
+	unit.DoPostConstructor();
+	unit.SetSplitsSlicesAtRamps(false);
+	unit.Globals()->SetParameter(0, 0.f);
+	unit.Globals()->SetParameter(1, 0.f);
+	XCTAssertEqual(unit.DoInitialize(), noErr);
+
+	const std::array<AudioUnitParameterEvent, 3> events{ RampedEvent(0, 0, 64, 0.f, 64.f),
+		ImmediateEvent(0, 16, -1.f), ImmediateEvent(1, 32, 1.f) };
+	XCTAssertEqual(unit.ScheduleParameter(events.data(), events.size()), noErr);
+	XCTAssertEqual(unit.Process(64), noErr);
+
+	// the ramp's values up to the immediate event, then the event's value to the end
+	XCTAssertEqual(unit.mSlices.size(), 3u);
+	for (UInt32 i = 0; i < 16; ++i) {
+		XCTAssertEqualWithAccuracy(unit.mValues[i], static_cast<float>(i), 1e-5f);
+	}
+	for (UInt32 i = 16; i < 64; ++i) {
+		XCTAssertEqual(unit.mValues[i], -1.f);
+	}
+	XCTAssertFalse(unit.Globals()->IsParameterRamping(0));
+	unit.DoPreDestructor();
+}
+
+- (void)testMinimumSliceFrames
+{
+	// immediate events for parameter 0 at 10, 40, 45 and 70, and a ramp of parameter 1 over
+	// frames 20 to 50
+	const std::array<AudioUnitParameterEvent, 5> events{ ImmediateEvent(0, 10, 1.f),
+		RampedEvent(1, 20, 30, 0.f, 1.f), ImmediateEvent(0, 40, 2.f), ImmediateEvent(0, 45, 3.f),
+		ImmediateEvent(0, 70, 4.f) };
+	const auto render = [&events](UInt32 inMinimumSliceFrames) {
+		auto unit = std::make_unique<ScheduledUnit>();
+		unit->DoPostConstructor();
+		unit->SetMinimumSliceFrames(inMinimumSliceFrames);
+		unit->Globals()->SetParameter(0, 0.f);
+		unit->Globals()->SetParameter(1, 0.f);
+		XCTAssertEqual(unit->DoInitialize(), noErr);
+		XCTAssertEqual(unit->ScheduleParameter(events.data(), events.size()), noErr);
+		XCTAssertEqual(unit->Process(128), noErr);
+		unit->DoPreDestructor();
+		return unit;
+	};
+	const auto starts = [](const ScheduledUnit& unit) {
+		std::vector<UInt32> result;
+		for (const auto& slice : unit.mSlices) {
+			result.push_back(slice.mStart);
+		}
+		return result;
+	};
+
+	// a quantum of 1 slices at every event and ramp end, as without quantization
+	const auto unquantized = render(0);
+	const auto single = render(1);
+	XCTAssertTrue((starts(*unquantized) == std::vector<UInt32>{ 0, 10, 20, 40, 45, 50, 70 }));
+	XCTAssertTrue(starts(*single) == starts(*unquantized));
+	XCTAssertTrue(single->mValues == unquantized->mValues);
+	for (size_t i = 0; i < single->mSlices.size(); ++i) {
+		XCTAssertEqual(single->mSlices[i].mFrames, unquantized->mSlices[i].mFrames);
+		XCTAssertEqual(single->mSlices[i].mValue, unquantized->mSlices[i].mValue);
+	}
+
+	// with 32, slices start on multiples of 32 and each event applies from the start of its
+	// quantum; the events at 40 and 45 coalesce to the later
+	const auto quantized = render(32);
+	XCTAssertTrue((starts(*quantized) == std::vector<UInt32>{ 0, 32, 64 }));
+	XCTAssertEqual(quantized->mSlices[0].mValue, 1.f);
+	XCTAssertEqual(quantized->mSlices[1].mValue, 3.f);
+	XCTAssertEqual(quantized->mSlices[2].mValue, 4.f);
+	XCTAssertEqual(quantized->mSlices[2].mFrames, 64u);
+	XCTAssertEqual(quantized->mValues[0], 1.f);
+	XCTAssertEqual(quantized->mValues[32], 3.f);
+	XCTAssertEqual(quantized->mValues[127], 4.f);
+}
+
+- (void)testSmoothedParameter
+{
+	using ausdk::AUSmoothedParameter;
+	ausdk::AtomicValue<float> storage{ 0.f };
+	AUSmoothedParameter linear{ storage, AUSmoothedParameter::ESmoothing::Linear, 4 };
+	AUSmoothedParameter onePole{ storage, AUSmoothedParameter::ESmoothing::OnePole, 8 };
+	AUSmoothedParameter none{ storage, AUSmoothedParameter::ESmoothing::None, 8 };
+
+	storage = 1.f;
+	std::array<float, 6> values{};
+	XCTAssertEqual(linear.Process(values.data(), values.size()), 1.f);
+	XCTAssertTrue((values == std::array<float, 6>{ .25f, .5f, .75f, 1.f, 1.f, 1.f }));
+
+	XCTAssertEqualWithAccuracy(
+		onePole.Process(values.data(), values.size()), 1.f - std::exp(-6.f / 8.f), 1e-5f);
+	for (size_t i = 1; i < values.size(); ++i) {
+		XCTAssertGreaterThan(values[i], values[i - 1]);
+	}
+	XCTAssertEqualWithAccuracy(onePole.Advance(10000), 1.f, 1e-6f);
+
+	XCTAssertEqual(none.Advance(1), 1.f);
+	storage = 2.f;
+	XCTAssertEqual(none.GetTarget(), 2.f);
+	XCTAssertEqual(linear.Advance(2), 1.5f);
+	linear.Reset();
+	XCTAssertEqual(linear.GetValue(), 2.f);
+}
+
+- (void)testParameterTable
+{
+	using ausdk::AUParameterTable;
+	ausdk::AURenderEpoch epoch;
+	AUParameterTable table{ epoch };
+
+	XCTAssertEqual(table.Insert(10, 1.f, false), 0u);
+	XCTAssertEqual(table.Insert(5, 2.f, false), 1u);
+	const AUParameterTable::Value* const first = &table.FindEntry(10).GetValue();
+
+	// added while a render is in progress: the values already resolved stay in place
+	{
+		const ausdk::AURenderEpoch::Scope render{ epoch };
+		XCTAssertTrue(epoch.IsRenderingOnCurrentThread());
+		for (UInt32 i = 0; i < 200; ++i) {
+			XCTAssertEqual(table.Insert(100 + i, static_cast<float>(i), true), 2 + i);
+		}
+		XCTAssertEqual(&table.FindEntry(10).GetValue(), first);
+		XCTAssertEqual(table.FindEntry(299).GetValue().load(), 199.f);
+	}
+	XCTAssertFalse(epoch.IsRenderingOnCurrentThread());
+	XCTAssertEqual(table.Size(), 202u);
+	XCTAssertEqual(table.FindSlot(7), AUParameterTable::kNoSlot);
+
+	std::vector<AudioUnitParameterID> ids;
+	table.ForEach([&ids](AudioUnitParameterID paramID, AUParameterTable::Value& /*value*/,
+					  ausdk::AUParameterRamp& /*ramp*/) { ids.push_back(paramID); });
+	XCTAssertEqual(ids.size(), 202u);
+	XCTAssertTrue(std::is_sorted(ids.begin(), ids.end()));
+
+	// changes are collected once each, in order of slot
+	std::vector<AudioUnitParameterID> changed;
+	table.FindEntry(5).Store(3.f);
+	table.EntryAt(0).Store(4.f);
+	table.FindEntry(5).Store(5.f);
+	table.CollectChanged(changed);
+	XCTAssertTrue((changed == std::vector<AudioUnitParameterID>{ 10, 5 }));
+	changed.clear();
+	table.CollectChanged(changed);
+	XCTAssertTrue(changed.empty());
+
+	table.UseIndexed(3);
+	XCTAssertTrue(table.IsIndexed());
+	XCTAssertEqual(table.FindSlot(2), 2u);
+	XCTAssertEqual(table.FindSlot(3), AUParameterTable::kNoSlot);
+}
+
+- (void)testParameterTableConcurrentReaders
+{
+	using ausdk::AUParameterTable;
+	constexpr UInt32 kNumParameters = 2000;
+	ausdk::AURenderEpoch epoch;
+	AUParameterTable table{ epoch };
+	table.Insert(0, 0.f, false);
+
+	// Every parameter's value is its ID, so a reader which finds one can check that the
+	// snapshot and the storage it reached are intact. Parameter 0 is always present.
+	std::atomic<bool> done{ false };
+	std::atomic<UInt32> failures{ 0 };
+	std::atomic<UInt64> renders{ 0 };
+	const auto check = [&](AudioUnitParameterID paramID) {
+		const AUParameterTable::Entry entry = table.FindEntry(paramID);
+		if (entry.IsValid() ? entry.GetValue().load() != static_cast<float>(paramID)
+							: paramID == 0) {
+			failures.fetch_add(1);
+		}
+	};
+
+	// a render thread, covered by the render epoch, and a reader off it, which counts itself in
+	// and out, while parameters are added
+	std::thread renderer{ [&] {
+		constexpr UInt32 kLookupsPerRender = 16;
+		for (UInt32 i = 0; !done.load(); ++i) {
+			const ausdk::AURenderEpoch::Scope render{ epoch };
+			for (UInt32 j = 0; j < kLookupsPerRender; ++j) {
+				check((i * kLookupsPerRender + j) % kNumParameters);
+			}
+			renders.fetch_add(1);
+		}
+	} };
+	std::thread reader{ [&] {
+		for (UInt32 i = 0; !done.load(); ++i) {
+			check((i * 7) % kNumParameters);
+			if (i % 256 == 0) {
+				table.ForEach([&](AudioUnitParameterID paramID, AUParameterTable::Value& value,
+								  ausdk::AUParameterRamp& /*ramp*/) {
+					if (value.load() != static_cast<float>(paramID)) {
+						failures.fetch_add(1);
+					}
+				});
+			}
+		}
+	} };
+	for (UInt32 i = 1; i < kNumParameters; ++i) {
+		table.Insert(i, static_cast<float>(i), true);
+	}
+	done = true;
+	renderer.join();
+	reader.join();
+	XCTAssertEqual(failures.load(), 0u);
+	XCTAssertGreaterThan(renders.load(), 0u);
+	XCTAssertEqual(table.Size(), kNumParameters);
+
+	// A snapshot replaced while a render holds it is kept until the render ends, and freed by
+	// the first addition after the epoch has advanced.
+	struct Item {
+		AudioUnitParameterID mParameterID{};
+		float mFound{ -1.f };
+	};
+	std::array<Item, 2> items{ Item{ 1 }, Item{ 2 } };
+	std::atomic<bool> holding{ false };
+	std::atomic<bool> release{ false };
+	std::thread held{ [&] {
+		const ausdk::AURenderEpoch::Scope render{ epoch };
+		table.FindEntries(items.data(), static_cast<UInt32>(items.size()),
+			[&](Item& item, const AUParameterTable::Entry& entry) {
+				if (&item == &items[0]) {
+					holding = true;
+					while (!release.load()) {
+						std::this_thread::yield();
+					}
+				}
+				item.mFound = entry.IsValid() ? entry.GetValue().load() : -1.f;
+			});
+	} };
+	while (!holding.load()) {
+		std::this_thread::yield();
+	}
+	table.Insert(kNumParameters, 0.f, true);
+	XCTAssertEqual(table.RetiredSnapshotCount(), 1u);
+	table.Insert(kNumParameters + 1, 0.f, true);
+	XCTAssertEqual(table.RetiredSnapshotCount(), 2u);
+	release = true;
+	held.join();
+	XCTAssertEqual(items[0].mFound, 1.f);
+	XCTAssertEqual(items[1].mFound, 2.f); // found through the retired snapshot
+	table.Insert(kNumParameters + 2, 0.f, true);
+	XCTAssertEqual(table.RetiredSnapshotCount(), 0u);
+}
+
+- (void)testParameterTableFindEntries
+{
+	using ausdk::AUParameterTable;
+	ausdk::AURenderEpoch epoch;
+	AUParameterTable table{ epoch };
+	for (UInt32 i = 0; i < 100; ++i) {
+		table.Insert(3 * i, static_cast<float>(i), false);
+	}
+
+	struct Item {
+		AudioUnitParameterID mParameterID{};
+		float mFound{ -1.f };
+	};
+	const auto find = [&table](std::vector<Item>& items) {
+		table.FindEntries(items.data(), static_cast<UInt32>(items.size()),
+			[](Item& item, const AUParameterTable::Entry& entry) {
+				item.mFound = entry.IsValid() ? entry.GetValue().load() : -1.f;
+			});
+	};
+	const auto expected = [](AudioUnitParameterID paramID) {
+		return paramID % 3 == 0 && paramID < 300 ? static_cast<float>(paramID / 3) : -1.f;
+	};
+
+	// ascending, with gaps of every size for the search to gallop over, and misses between,
+	// before and after the parameters
+	std::vector<Item> ascending;
+	for (const AudioUnitParameterID paramID :
+		 { 0u, 1u, 3u, 6u, 7u, 30u, 31u, 96u, 99u, 100u, 294u, 297u, 298u, 1000u }) {
+		ascending.push_back({ paramID });
+	}
+	find(ascending);
+	for (const auto& item : ascending) {
+		XCTAssertEqual(item.mFound, expected(item.mParameterID), @"ID %u", item.mParameterID);
+	}
+
+	// descending and shuffled orders search backwards from the hint
+	std::vector<Item> unsorted;
+	for (const AudioUnitParameterID paramID :
+		 { 297u, 5u, 150u, 0u, 151u, 299u, 12u, 11u, 3u, 1000u, 42u, 3u }) {
+		unsorted.push_back({ paramID });
+	}
+	find(unsorted);
+	for (const auto& item : unsorted) {
+		XCTAssertEqual(item.mFound, expected(item.mParameterID), @"ID %u", item.mParameterID);
+	}
+}
+
+- (void)testParameterHandles
+{
+	ScheduledUnit unit;
+	unit.DoPostConstructor();
+	for (UInt32 i = 0; i < 100; ++i) {
+		unit.Globals()->SetParameter(3 * i, static_cast<float>(i));
+	}
+	ausdk::AUElement& globals = *unit.Globals();
+
+	// a handle reads and writes its parameter's storage without a lookup
+	const ausdk::AUParameterHandle handle = globals.GetParameterHandle(297);
+	XCTAssertTrue(globals.IsParameterHandleCurrent(handle));
+	XCTAssertEqual(handle.GetSlot(), 99u);
+	XCTAssertEqual(handle.Get(), 99.f);
+	XCTAssertTrue(globals.SetParameter(handle, 5.f));
+	XCTAssertEqual(globals.GetParameter(297), 5.f);
+	globals.SetParameter(297, 6.f);
+	XCTAssertEqual(handle.Get(), 6.f);
+	XCTAssertFalse(globals.IsParameterHandleCurrent(ausdk::AUParameterHandle{}));
+
+	// adding parameters leaves the slots in place
+	globals.SetParameter(1000, 1.f);
+	XCTAssertTrue(globals.IsParameterHandleCurrent(handle));
+	XCTAssertTrue(globals.SetParameter(handle, 7.f));
+	XCTAssertEqual(globals.GetParameter(297), 7.f);
+
+	// moving them makes the handle stale: it is rejected rather than setting the old storage
+	globals.UseIndexedParameters(300);
+	XCTAssertFalse(globals.IsParameterHandleCurrent(handle));
+	XCTAssertFalse(globals.SetParameter(handle, 8.f));
+	XCTAssertEqual(globals.GetParameter(297), 0.f);
+	const ausdk::AUParameterHandle current = globals.GetParameterHandle(297);
+	XCTAssertTrue(globals.IsParameterHandleCurrent(current));
+	XCTAssertEqual(current.GetSlot(), 297u);
+	XCTAssertTrue(globals.SetParameter(current, 8.f));
+	XCTAssertEqual(globals.GetParameter(297), 8.f);
+	unit.DoPreDestructor();
+}
+
+- (void)testParameterTableAlignment
+{
+	// each segment of 64 values starts a cache line, so that values written by one thread do
+	// not share a line with another segment's
+	using ausdk::AUParameterTable;
+	ausdk::AURenderEpoch epoch;
+	AUParameterTable table{ epoch };
+	for (UInt32 i = 0; i < 200; ++i) {
+		table.Insert(i, 0.f, false);
+	}
+	for (const UInt32 slot : { 0u, 64u, 128u, 192u }) {
+		const auto address = reinterpret_cast<std::uintptr_t>(&table.EntryAt(slot).GetValue());
+		XCTAssertEqual(address % 64, 0u, @"slot %u", slot);
+	}
+	table.UseIndexed(130);
+	for (const UInt32 slot : { 0u, 64u, 128u }) {
+		const auto address = reinterpret_cast<std::uintptr_t>(&table.EntryAt(slot).GetValue());
+		XCTAssertEqual(address % 64, 0u, @"slot %u", slot);
+	}
+}
+
+- (void)testBatchParameters
+{
+	using ausdk::AUParameterItem;
+	ScheduledUnit unit;
+	unit.DoPostConstructor();
+	for (UInt32 i = 0; i < 100; ++i) {
+		unit.Globals()->SetParameter(3 * i, static_cast<float>(i));
+	}
+	XCTAssertEqual(unit.DoInitialize(), noErr);
+	const auto item = [](AudioUnitParameterID paramID, float value = 0.f) {
+		return AUParameterItem{ kAudioUnitScope_Global, 0, paramID, value };
+	};
+
+	std::vector<AUParameterItem> items{ item(297), item(0), item(150), item(3) };
+	XCTAssertEqual(unit.GetParameters(items.data(), static_cast<UInt32>(items.size())), noErr);
+	XCTAssertEqual(items[0].mValue, 99.f);
+	XCTAssertEqual(items[1].mValue, 0.f);
+	XCTAssertEqual(items[2].mValue, 50.f);
+	XCTAssertEqual(items[3].mValue, 1.f);
+
+	// errors are returned, not thrown
+	items = { item(0), item(1) };
+	XCTAssertEqual(unit.GetParameters(items.data(), static_cast<UInt32>(items.size())),
+		kAudioUnitErr_InvalidParameter);
+	items = { item(0), AUParameterItem{ kAudioUnitScope_Global, 1, 0, 0.f } };
+	XCTAssertEqual(unit.GetParameters(items.data(), static_cast<UInt32>(items.size())),
+		kAudioUnitErr_InvalidElement);
+
+	// setting defines new parameters, and stops at the first value which is not finite
+	items = { item(0, 10.f), item(1, 11.f), item(3, NAN), item(6, 12.f) };
+	XCTAssertEqual(unit.SetParameters(items.data(), static_cast<UInt32>(items.size())),
+		kAudioUnitErr_InvalidParameterValue);
+	XCTAssertEqual(unit.Globals()->GetParameter(0), 10.f);
+	XCTAssertEqual(unit.Globals()->GetParameter(1), 11.f);
+	XCTAssertEqual(unit.Globals()->GetParameter(3), 1.f);
+	XCTAssertEqual(unit.Globals()->GetParameter(6), 2.f);
+	items = { item(3, INFINITY) };
+	XCTAssertEqual(unit.SetParameters(items.data(), static_cast<UInt32>(items.size())),
+		kAudioUnitErr_InvalidParameterValue);
+	XCTAssertEqual(unit.Globals()->GetParameter(3), 1.f);
+	unit.DoPreDestructor();
+}
+
+- (void)testFixedEffect
+{
+	FixedGain unit;
+	unit.DoPostConstructor();
+	XCTAssertEqual(unit.GetMaxFramesPerSlice(), 64u);
+	const AUChannelInfo* channelInfo = nullptr;
+	XCTAssertEqual(unit.SupportedNumChannels(&channelInfo), 1u);
+	XCTAssertEqual(channelInfo->outChannels, 2);
+	UInt32 inPlace = 1;
+	XCTAssertEqual(unit.DispatchSetProperty(kAudioUnitProperty_InPlaceProcessing,
+					   kAudioUnitScope_Global, 0, &inPlace, sizeof(inPlace)),
+		kAudioUnitErr_PropertyNotWritable);
+	XCTAssertEqual(unit.DoInitialize(), noErr);
+
+	constexpr UInt32 kFrameCount = 150;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(44100.0, 2);
+	ausdk::AUBufferList input;
+	ausdk::AUBufferList output;
+	input.Allocate(asbd, kFrameCount);
+	output.Allocate(asbd, kFrameCount);
+	auto& inputABL = input.PrepareBuffer(asbd, kFrameCount);
+	auto& outputABL = output.PrepareBuffer(asbd, kFrameCount);
+	auto* const left = static_cast<float*>(inputABL.mBuffers[0].mData);
+	std::fill_n(left, kFrameCount, 1.f);
+
+	AudioUnitRenderActionFlags flags = 0;
+	XCTAssertEqual(unit.ProcessBufferLists(flags, inputABL, outputABL, 64), noErr);
+	XCTAssertEqual(unit.mFixedBlocks, 1u);
+	XCTAssertEqual(unit.mBlocks, 0u);
+
+	XCTAssertEqual(unit.ProcessBufferLists(flags, inputABL, outputABL, kFrameCount), noErr);
+	XCTAssertEqual(unit.mFixedBlocks, 1u);
+	XCTAssertEqual(unit.mBlocks, 3u); // 64 + 64 + 22
+	XCTAssertEqual(unit.mLastBlockFrames, 22u);
+	XCTAssertEqual(static_cast<const float*>(outputABL.mBuffers[0].mData)[kFrameCount - 1], 0.5f);
+	XCTAssertEqual((flags & kAudioUnitRenderAction_OutputIsSilence), 0u);
+	unit.DoPreDestructor();
+}
+
+- (void)testKernelSleep
+{
+	FixedGain unit;
+	unit.DoPostConstructor();
+	unit.SetKernelSleepEnabled(true);
+	float level = 0.f;
+	AURenderCallbackStruct callback{ .inputProc = RenderConstant, .inputProcRefCon = &level };
+	XCTAssertEqual(unit.DispatchSetProperty(kAudioUnitProperty_SetRenderCallback,
+					   kAudioUnitScope_Input, 0, &callback, sizeof(callback)),
+		noErr);
+	XCTAssertEqual(unit.DoInitialize(), noErr);
+
+	constexpr UInt32 kFrameCount = 64;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(44100.0, 2);
+	ausdk::AUBufferList output;
+	output.Allocate(asbd, kFrameCount);
+	auto& outputABL = output.PrepareBuffer(asbd, kFrameCount);
+	const auto* const left = static_cast<const float*>(outputABL.mBuffers[0].mData);
+	AudioTimeStamp timeStamp{};
+	timeStamp.mFlags = kAudioTimeStampSampleTimeValid;
+	const auto render = [&] {
+		AudioUnitRenderActionFlags flags = 0;
+		XCTAssertEqual(unit.DoRender(flags, timeStamp, 0, kFrameCount, outputABL), noErr);
+		timeStamp.mSampleTime += kFrameCount;
+		return flags;
+	};
+
+	// no latency or tail: silent input puts the kernels to sleep at once
+	XCTAssertNotEqual((render() & kAudioUnitRenderAction_OutputIsSilence), 0u);
+	XCTAssertEqual(unit.mFixedBlocks, 0u);
+	XCTAssertEqual(left[0], 0.f);
+
+	level = 1.f;
+	XCTAssertEqual((render() & kAudioUnitRenderAction_OutputIsSilence), 0u);
+	XCTAssertEqual(unit.mFixedBlocks, 1u);
+	XCTAssertEqual(left[0], 0.5f);
+
+	// the first silent render after the sound still processes
+	level = 0.f;
+	render();
+	XCTAssertEqual(unit.mFixedBlocks, 2u);
+	XCTAssertNotEqual((render() & kAudioUnitRenderAction_OutputIsSilence), 0u);
+	XCTAssertEqual(unit.mFixedBlocks, 2u);
+
+	const auto statistics = unit.GetSleepStatistics();
+	XCTAssertEqual(statistics.mSleepingRenders, 2u);
+	XCTAssertEqual(statistics.mSkippedFrames, 2u * kFrameCount);
+	XCTAssertEqual(statistics.mWakes, 1u);
+
+	// pulled as by a connection, with null buffers: the unit's own buffers, which the caller
+	// writes between renders, are zeroed by each sleeping render
+	ausdk::AUBufferList pulled;
+	pulled.Allocate(asbd, kFrameCount);
+	for (int sleeping = 0; sleeping < 3; ++sleeping) {
+		auto& abl = pulled.PrepareNullBuffer(asbd, kFrameCount);
+		AudioUnitRenderActionFlags flags = 0;
+		XCTAssertEqual(unit.DoRender(flags, timeStamp, 0, kFrameCount, abl), noErr);
+		timeStamp.mSampleTime += kFrameCount;
+		XCTAssertNotEqual((flags & kAudioUnitRenderAction_OutputIsSilence), 0u);
+		for (UInt32 i = 0; i < abl.mNumberBuffers; ++i) {
+			auto* const samples = static_cast<float*>(abl.mBuffers[i].mData);
+			XCTAssertEqual(samples[0], 0.f, @"render %d", sleeping);
+			XCTAssertEqual(samples[kFrameCount - 1], 0.f, @"render %d", sleeping);
+			std::fill_n(samples, kFrameCount, 1.f);
+		}
+	}
+	XCTAssertEqual(unit.mFixedBlocks, 2u);
+	XCTAssertEqual(unit.GetSleepStatistics().mSleepingRenders, 5u);
+	unit.DoPreDestructor();
+}
+
+- (void)testBypassCrossfade
+{
+	FixedGain unit;
+	unit.DoPostConstructor();
+	unit.SetBypassCrossfadeFrames(100);
+	float level = 1.f;
+	AURenderCallbackStruct callback{ .inputProc = RenderConstant, .inputProcRefCon = &level };
+	XCTAssertEqual(unit.DispatchSetProperty(kAudioUnitProperty_SetRenderCallback,
+					   kAudioUnitScope_Input, 0, &callback, sizeof(callback)),
+		noErr);
+	XCTAssertEqual(unit.DoInitialize(), noErr);
+
+	constexpr UInt32 kFrameCount = 64;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(44100.0, 2);
+	ausdk::AUBufferList output;
+	output.Allocate(asbd, kFrameCount);
+	auto& outputABL = output.PrepareBuffer(asbd, kFrameCount);
+	const auto* const left = static_cast<const float*>(outputABL.mBuffers[0].mData);
+	AudioTimeStamp timeStamp{};
+	timeStamp.mFlags = kAudioTimeStampSampleTimeValid;
+	const auto render = [&] {
+		AudioUnitRenderActionFlags flags = 0;
+		XCTAssertEqual(unit.DoRender(flags, timeStamp, 0, kFrameCount, outputABL), noErr);
+		timeStamp.mSampleTime += kFrameCount;
+	};
+	const auto setBypass = [&](UInt32 inBypass) {
+		XCTAssertEqual(unit.DispatchSetProperty(kAudioUnitProperty_BypassEffect,
+						   kAudioUnitScope_Global, 0, &inBypass, sizeof(inBypass)),
+			noErr);
+	};
+
+	render();
+	XCTAssertEqual(left[0], 0.5f);
+
+	// 100 frames from the processed signal, 0.5, to the input, 1
+	setBypass(1);
+	render();
+	XCTAssertEqualWithAccuracy(left[0], 0.505f, 1e-6f);
+	XCTAssertEqualWithAccuracy(left[63], 0.82f, 1e-6f);
+	render();
+	XCTAssertEqualWithAccuracy(left[35], 1.f, 1e-6f);
+	XCTAssertEqual(left[36], 1.f);
+	XCTAssertEqual(unit.mFixedBlocks, 3u);
+
+	// once bypassed, the kernels stop; setting the same value again changes nothing
+	render();
+	XCTAssertEqual(left[0], 1.f);
+	XCTAssertEqual(unit.mFixedBlocks, 3u);
+	setBypass(1);
+	XCTAssertEqual(unit.mBypassChanges, 1u);
+
+	// processing again resets the unit, as turning the bypass off always has, and is no wake
+	const UInt32 resets = unit.mResets;
+	setBypass(0);
+	XCTAssertEqual(unit.mResets, resets);
+	render();
+	XCTAssertEqualWithAccuracy(left[0], 0.995f, 1e-6f);
+	XCTAssertEqual(unit.mFixedBlocks, 4u);
+	XCTAssertEqual(unit.mResets, resets + 1);
+	XCTAssertEqual(unit.GetSleepStatistics().mWakes, 0u);
+	XCTAssertEqual(unit.mBypassChanges, 2u);
+	unit.DoPreDestructor();
+}
+
+- (void)testChannelLanes
+{
+	using Lanes = ausdk::AUChannelLanes<4>;
+	XCTAssertEqual(Lanes::GetGroupCount(6), 2u);
+	XCTAssertEqual(Lanes::GetGroupChannels(6, 1), 2u);
+
+	std::array<std::array<float, 5>, 3> channels{};
+	for (size_t channel = 0; channel < channels.size(); ++channel) {
+		for (size_t frame = 0; frame < 5; ++frame) {
+			channels[channel][frame] = static_cast<float>(10 * channel + frame);
+		}
+	}
+	const std::array<const float*, 3> sources{ channels[0].data(), channels[1].data(),
+		channels[2].data() };
+	std::array<Lanes::Vector, 4> packed{};
+	Lanes::Pack(sources.data(), 3, 1, 4, packed.data());
+	XCTAssertEqual(packed[0][2], 21.f);
+	XCTAssertEqual(packed[3][1], 14.f);
+	XCTAssertEqual(packed[3][3], 0.f); // unused lane
+
+	std::array<std::array<float, 5>, 3> unpacked{};
+	const std::array<float*, 3> dests{ unpacked[0].data(), unpacked[1].data(),
+		unpacked[2].data() };
+	Lanes::Unpack(packed.data(), 4, dests.data(), 3, 1);
+	for (size_t channel = 0; channel < channels.size(); ++channel) {
+		XCTAssertEqual(unpacked[channel][0], 0.f); // before the first frame
+		for (size_t frame = 1; frame < 5; ++frame) {
+			XCTAssertEqual(unpacked[channel][frame], channels[channel][frame]);
+		}
+	}
+}
+
+- (void)testRealtimeGuard
+{
+	using ausdk::AURealtimeGuard;
+	const UInt64 expected = AURealtimeGuard::kEnabled ? 1 : 0;
+	AURealtimeGuard::ResetStatistics();
+
+	AURealtimeGuard::Report(AURealtimeGuard::EViolation::Lock); // not rendering
+	{
+		const AURealtimeGuard guard;
+		{
+			const AURealtimeGuard nested; // counts towards the outer render
+			AURealtimeGuard::Report(AURealtimeGuard::EViolation::SystemCall);
+		}
+		const AURealtimeGuard::Suspension suspension;
+		AURealtimeGuard::Report(AURealtimeGuard::EViolation::Lock);
+	}
+
+	const auto statistics = AURealtimeGuard::GetStatistics();
+	XCTAssertEqual(statistics.mRenders, expected);
+	XCTAssertEqual(statistics.mViolatingRenders, expected);
+	XCTAssertEqual(statistics.mViolations, expected);
+	XCTAssertEqual(statistics.mLastRenderViolations, expected);
+
+	std::array<AURealtimeGuard::Violation, 4> violations{};
+	XCTAssertEqual(AURealtimeGuard::CopyViolations(violations.data(), violations.size()), expected);
+	if (AURealtimeGuard::kEnabled) {
+		XCTAssertTrue(violations[0].mKind == AURealtimeGuard::EViolation::SystemCall);
+		XCTAssertGreaterThan(violations[0].mFrameCount, 0u);
+	}
+	AURealtimeGuard::ResetStatistics();
+}
+
+- (void)testWorkerPool
+{
+	ausdk::AUWorkerPool pool{ 3, 512.0 / 48000.0 };
+	XCTAssertEqual(pool.GetNumWorkers(), 3u);
+
+	std::array<std::thread::id, 10> firstThreads{};
+	std::array<int, 10> runs{};
+	auto first = [&](UInt32 task) {
+		firstThreads[task] = std::this_thread::get_id();
+		++runs[task];
+	};
+	pool.Run(static_cast<UInt32>(runs.size()), first);
+
+	// each task runs once per batch, on the same participant every time
+	auto again = [&](UInt32 task) {
+		XCTAssertEqual(firstThreads[task], std::this_thread::get_id());
+		++runs[task];
+	};
+	for (int batch = 0; batch < 100; ++batch) {
+		pool.Run(static_cast<UInt32>(runs.size()), again);
+	}
+	for (int taskRuns : runs) {
+		XCTAssertEqual(taskRuns, 101);
+	}
+	XCTAssertEqual(firstThreads[0], std::this_thread::get_id()); // the caller takes part
+}
+
+- (void)testKernelThreadsMatchSerialOutput
+{
+	constexpr UInt32 kNumChannels = 8;
+	constexpr UInt32 kFrameCount = 256;
+	constexpr UInt32 kNumBuffers = 10;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(48000.0, kNumChannels);
+
+	// renders kNumBuffers buffers of the same input, returning all of the output
+	const auto render = [&](UInt32 threads) {
+		OnePoleUnit unit;
+		unit.DoPostConstructor();
+		unit.SetKernelThreads(threads);
+		XCTAssertEqual(unit.DispatchSetProperty(kAudioUnitProperty_StreamFormat,
+						   kAudioUnitScope_Input, 0, &asbd, sizeof(asbd)),
+			noErr);
+		XCTAssertEqual(unit.DispatchSetProperty(kAudioUnitProperty_StreamFormat,
+						   kAudioUnitScope_Output, 0, &asbd, sizeof(asbd)),
+			noErr);
+		XCTAssertEqual(unit.DoInitialize(), noErr);
+
+		ausdk::AUBufferList input;
+		ausdk::AUBufferList output;
+		input.Allocate(asbd, kFrameCount);
+		output.Allocate(asbd, kFrameCount);
+		auto& inputABL = input.PrepareBuffer(asbd, kFrameCount);
+		auto& outputABL = output.PrepareBuffer(asbd, kFrameCount);
+		for (UInt32 channel = 0; channel < kNumChannels; ++channel) {
+			auto* const samples = static_cast<float*>(inputABL.mBuffers[channel].mData);
+			for (UInt32 i = 0; i < kFrameCount; ++i) {
+				samples[i] = static_cast<float>((i * 7919 + channel * 104729) % 2000) / 1000.f;
+			}
+		}
+
+		std::vector<float> result;
+		for (UInt32 buffer = 0; buffer < kNumBuffers; ++buffer) {
+			AudioUnitRenderActionFlags flags = 0;
+			XCTAssertEqual(unit.ProcessBufferLists(flags, inputABL, outputABL, kFrameCount), noErr);
+			for (UInt32 channel = 0; channel < kNumChannels; ++channel) {
+				const auto* const samples =
+					static_cast<const float*>(outputABL.mBuffers[channel].mData);
+				result.insert(result.end(), samples, samples + kFrameCount);
+			}
+		}
+		unit.DoPreDestructor();
+		return result;
+	};
+
+	const auto serial = render(1);
+	for (const UInt32 threads : { 2u, 3u, 8u }) {
+		const auto parallel = render(threads);
+		XCTAssertEqual(parallel.size(), serial.size());
+		XCTAssertEqual(
+			std::memcmp(parallel.data(), serial.data(), serial.size() * sizeof(float)), 0);
+	}
+}
+
+- (void)testZeroCopyOutputs
+{
+	TwoBusUnit unit;
+	unit.DoPostConstructor();
+	unit.SetZeroCopyOutputs(true);
+	XCTAssertEqual(unit.DoInitialize(), noErr);
+
+	constexpr UInt32 kFrameCount = 64;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(44100.0, 2);
+	std::array<std::array<float, kFrameCount>, 2> callerBuffers{};
+	ausdk::AUBufferList callerList;
+	callerList.Allocate(asbd, kFrameCount);
+	auto& callerABL = callerList.PrepareNullBuffer(asbd, kFrameCount);
+	callerABL.mBuffers[0].mData = callerBuffers[0].data();
+	callerABL.mBuffers[1].mData = callerBuffers[1].data();
+	ausdk::AUBufferList nullList;
+	nullList.Allocate(asbd, kFrameCount);
+	const auto nullBuffers = [&]() -> AudioBufferList& {
+		return nullList.PrepareNullBuffer(asbd, kFrameCount);
+	};
+
+	// returns the last sample of the pulled bus
+	const auto pull = [&](UInt32 bus, Float64 sampleTime, AudioBufferList& abl) {
+		AudioTimeStamp timeStamp{};
+		timeStamp.mFlags = kAudioTimeStampSampleTimeValid;
+		timeStamp.mSampleTime = sampleTime;
+		AudioUnitRenderActionFlags flags = 0;
+		XCTAssertEqual(unit.DoRender(flags, timeStamp, bus, kFrameCount, abl), noErr);
+		return static_cast<const float*>(abl.mBuffers[1].mData)[kFrameCount - 1];
+	};
+
+	XCTAssertEqual(pull(0, 0, callerABL), 10.f);
+	XCTAssertEqual(unit.GetOutputCopyStatistics().mZeroCopyBusRenders, 1u);
+
+	// pulled again for the same time with null buffers: the first pull's buffers, not the cache
+	XCTAssertEqual(pull(0, 0, nullBuffers()), 10.f);
+	XCTAssertEqual(
+		nullList.GetBufferList().mBuffers[0].mData, static_cast<void*>(callerBuffers[0].data()));
+	XCTAssertEqual(pull(1, 0, nullBuffers()), 11.f);
+	XCTAssertEqual(unit.mRenders, 1u);
+
+	// a new time with null buffers renders into the caches
+	XCTAssertEqual(pull(0, kFrameCount, nullBuffers()), 20.f);
+	XCTAssertNotEqual(
+		nullList.GetBufferList().mBuffers[0].mData, static_cast<void*>(callerBuffers[0].data()));
+	XCTAssertEqual(pull(0, kFrameCount, nullBuffers()), 20.f);
+	XCTAssertEqual(pull(1, kFrameCount, nullBuffers()), 21.f);
+
+	XCTAssertEqual(pull(1, 2 * kFrameCount, callerABL), 31.f);
+	XCTAssertEqual(pull(0, 2 * kFrameCount, nullBuffers()), 30.f);
+	XCTAssertEqual(unit.mRenders, 3u);
+	XCTAssertEqual(unit.GetOutputCopyStatistics().mZeroCopyBusRenders, 2u);
+	unit.DoPreDestructor();
+}
+
+- (void)testNullBufferPullOfSilentOutput
+{
+	SilentUnit unit;
+	unit.DoPostConstructor();
+	XCTAssertEqual(unit.DoInitialize(), noErr);
+
+	constexpr UInt32 kFrameCount = 64;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(44100.0, 2);
+	ausdk::AUBufferList pulled;
+	pulled.Allocate(asbd, kFrameCount);
+	AudioTimeStamp timeStamp{};
+	timeStamp.mFlags = kAudioTimeStampSampleTimeValid;
+
+	// as a connection pulls: with null buffers, receiving the output's own, which a downstream
+	// unit processing in place then writes
+	for (int render = 0; render < 3; ++render) {
+		auto& abl = pulled.PrepareNullBuffer(asbd, kFrameCount);
+		AudioUnitRenderActionFlags flags = 0;
+		XCTAssertEqual(unit.DoRender(flags, timeStamp, 0, kFrameCount, abl), noErr);
+		XCTAssertNotEqual((flags & kAudioUnitRenderAction_OutputIsSilence), 0u);
+		for (UInt32 i = 0; i < abl.mNumberBuffers; ++i) {
+			auto* const samples = static_cast<float*>(abl.mBuffers[i].mData);
+			XCTAssertNotEqual(samples, nullptr);
+			XCTAssertEqual(samples[0], 0.f, @"render %d", render);
+			XCTAssertEqual(samples[kFrameCount - 1], 0.f, @"render %d", render);
+			std::fill_n(samples, kFrameCount, 1.f);
+		}
+		timeStamp.mSampleTime += kFrameCount;
+	}
+	unit.DoPreDestructor();
+}
+
+- (void)testPooledBufferAllocator
+{
+	constexpr unsigned kFrameCount = 512;
+	ausdk::PooledBufferAllocator pool;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(44100.0, 2);
+
+	{
+		ausdk::AUBufferList uut;
+		uut.Allocate(asbd, kFrameCount, &pool);
+		auto& abl = uut.PrepareBuffer(asbd, kFrameCount);
+		static_cast<float*>(abl.mBuffers[1].mData)[kFrameCount - 1] = 1.0f;
+
+		const auto stats = pool.GetStatistics();
+		XCTAssertEqual(stats.mAllocations, 1u);
+		XCTAssertEqual(stats.mBlocksInUse, 1u);
+		XCTAssertGreaterThanOrEqual(stats.mBytesInUse, stats.mBytesRequested);
+	}
+	XCTAssertEqual(pool.GetStatistics().mBlocksCached, 1u);
+
+	// The same size class is recycled, and handed out zeroed.
+	ausdk::AUBufferList uut;
+	uut.Allocate(asbd, kFrameCount, &pool);
+	auto& abl = uut.PrepareBuffer(asbd, kFrameCount);
+	XCTAssertEqual(static_cast<float*>(abl.mBuffers[1].mData)[kFrameCount - 1], 0.0f);
+	XCTAssertTrue(uut.IsAligned(ausdk::BufferAllocator::kDefaultBufferAlignment));
+	XCTAssertEqual(pool.GetStatistics().mPoolHits, 1u);
+	XCTAssertEqual(pool.GetStatistics().mBlocksCached, 0u);
+
+	uut.Deallocate();
+	pool.Trim();
+	XCTAssertEqual(pool.GetStatistics().mBlocksCached, 0u);
+	XCTAssertEqual(pool.GetStatistics().mBytesInUse, 0u);
+}
+
+- (void)testLargePageFallback
+{
+	using Policy = ausdk::BufferAllocator::EPageTouchPolicy;
+	constexpr unsigned kLargeFrameCount = 16384; // 64 KB per channel
+	constexpr unsigned kSmallFrameCount = 64;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(44100.0, 2);
+	const auto check = [&](ausdk::AUBufferList& list, unsigned frames) {
+		auto& abl = list.PrepareBuffer(asbd, frames);
+		XCTAssertTrue(list.IsAligned(ausdk::BufferAllocator::kDefaultBufferAlignment));
+		auto* const last = static_cast<float*>(abl.mBuffers[1].mData) + frames - 1;
+		XCTAssertEqual(*last, 0.f);
+		*last = 1.f;
+	};
+
+	for (const Policy policy : { Policy::EagerZero, Policy::LazyFirstTouch }) {
+		NoLargePagesAllocator allocator;
+		allocator.SetPageTouchPolicy(policy);
+		allocator.SetLargePageThreshold(64 * 1024);
+
+		// large regions fall back to ordinary pages, small ones to the heap; freeing them out of
+		// order finds each mapped region by address
+		std::array<ausdk::AUBufferList, 4> lists;
+		const std::array<unsigned, 4> frames{ kLargeFrameCount, kSmallFrameCount,
+			kLargeFrameCount, kLargeFrameCount };
+		for (size_t i = 0; i < lists.size(); ++i) {
+			lists[i].Allocate(asbd, frames[i], &allocator);
+			check(lists[i], frames[i]);
+		}
+		XCTAssertEqual(allocator.mLargePageRequests, 3u);
+		for (const size_t i : { 2u, 0u, 3u, 1u }) {
+			lists[i].Deallocate();
+		}
+
+		// the addresses are reused, and the memory comes back zeroed
+		lists[0].Allocate(asbd, kLargeFrameCount, &allocator);
+		check(lists[0], kLargeFrameCount);
+		XCTAssertEqual(allocator.mLargePageRequests, 4u);
+	}
+
+	// where the system does provide large pages, bound to the render thread's node
+	ausdk::BufferAllocator allocator;
+	allocator.SetLargePageThreshold(64 * 1024);
+	allocator.SetPreferredNUMANode(ausdk::BufferAllocator::CurrentThreadNUMANode());
+	ausdk::AUBufferList list;
+	list.Allocate(asbd, kLargeFrameCount, &allocator);
+	check(list, kLargeFrameCount);
+}
+
+- (void)testScratchArena
+{
+	XCTAssertEqual(ausdk::AUScratchArena::Current(), nullptr);
+	ausdk::AUScratchArena::Reserve(4096, 1);
+	XCTAssertGreaterThanOrEqual(ausdk::AUScratchArena::Capacity(), 4096u);
+
+	const ausdk::AUScratchArena::Scope outer;
+	auto* const arena = ausdk::AUScratchArena::Current();
+	XCTAssertNotEqual(arena, nullptr);
+	void* const first = arena->Allocate(100);
+	XCTAssertEqual(reinterpret_cast<uintptr_t>(first) % ausdk::AUScratchArena::kAlignment, 0u);
+
+	void* nested = nullptr;
+	{
+		// a nested render shares the thread's arena and releases its allocations on exit
+		const ausdk::AUScratchArena::Scope inner;
+		XCTAssertEqual(ausdk::AUScratchArena::Current(), arena);
+		nested = arena->Allocate(100);
+		XCTAssertNotEqual(nested, first);
+	}
+	XCTAssertEqual(arena->Allocate(100), nested);
+	XCTAssertEqual(arena->Allocate(ausdk::AUScratchArena::Capacity()), nullptr);
+}
+
+- (void)testSharedScratchInput
+{
+	ausdk::AUScratchArena::Reserve(4096, 1);
+	FixedGain unit;
+	unit.DoPostConstructor();
+	unit.Input(0).SetBufferAllocation(ausdk::AUIOElement::EBufferAllocation::SharedScratch);
+	RecordingSource source;
+	AURenderCallbackStruct callback{ .inputProc = RenderRecording, .inputProcRefCon = &source };
+	XCTAssertEqual(unit.DispatchSetProperty(kAudioUnitProperty_SetRenderCallback,
+					   kAudioUnitScope_Input, 0, &callback, sizeof(callback)),
+		noErr);
+	XCTAssertEqual(unit.DoInitialize(), noErr);
+	XCTAssertTrue(unit.Input(0).UsesSharedScratch());
+
+	constexpr UInt32 kFrameCount = 64;
+	const auto asbd = ausdk::ASBD::CreateCommonFloat32(44100.0, 2);
+	ausdk::AUBufferList output;
+	output.Allocate(asbd, kFrameCount);
+	auto& outputABL = output.PrepareBuffer(asbd, kFrameCount);
+	const auto* const left = static_cast<const float*>(outputABL.mBuffers[0].mData);
+	AudioTimeStamp timeStamp{};
+	timeStamp.mFlags = kAudioTimeStampSampleTimeValid;
+	const auto render = [&] {
+		AudioUnitRenderActionFlags flags = 0;
+		XCTAssertEqual(unit.DoRender(flags, timeStamp, 0, kFrameCount, outputABL), noErr);
+		timeStamp.mSampleTime += kFrameCount;
+	};
+
+	// the input is pulled into the render thread's arena
+	render();
+	XCTAssertEqual(left[0], 0.5f);
+	XCTAssertEqual(unit.Input(0).GetScratchFallbackCount(), 0u);
+	const void* const scratch = source.mData;
+
+	// with the arena exhausted by an enclosing render, the element's own buffer is used
+	{
+		const ausdk::AUScratchArena::Scope enclosing;
+		if (auto* const arena = ausdk::AUScratchArena::Current(); arena != nullptr) {
+			XCTAssertNotEqual(arena->Allocate(ausdk::AUScratchArena::Capacity()), nullptr);
+		}
+		source.mLevel = 2.f;
+		render();
+	}
+	XCTAssertEqual(left[0], 1.f);
+	XCTAssertEqual(unit.Input(0).GetScratchFallbackCount(), 1u);
+	XCTAssertNotEqual(source.mData, scratch);
+
+	// and the arena again once it is free
+	render();
+	XCTAssertEqual(unit.Input(0).GetScratchFallbackCount(), 1u);
+	XCTAssertEqual(source.mData, scratch);
+	unit.DoPreDestructor();
+}
+
 - (void)testExtractBigUInt32AndAdvance
 {
 	const std::array<UInt32, 5> data{ CFSwapInt32HostToBig(1), CFSwapInt32HostToBig(11),